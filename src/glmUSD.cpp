@@ -7,6 +7,7 @@
 #include "glmUSD.h"
 #include "glmUSDLogger.h"
 #include "glmUSDPluginProductInformation.h"
+#include "glmUSDTrace.h"
 
 #include <glmCore.h>
 #include <glmStringOperators.h>
@@ -68,6 +69,9 @@ namespace glm
             --s_initCount;
             if (s_initCount == 0)
             {
+#ifndef TRACY_ENABLE
+                ChromeTrace::flush();
+#endif
                 glm::crowdio::finish();
                 glm::Singleton<USDLogger>::destroy();
                 glm::finishCore();
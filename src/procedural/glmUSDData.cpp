@@ -6,6 +6,7 @@
 
 #include "glmUSDData.h"
 #include "glmUSDDataImpl.h"
+#include "glmUSDDataImplRegistry.h"
 
 USD_INCLUDES_START
 #include <pxr/pxr.h>
@@ -128,6 +129,55 @@ namespace glm
             return args;
         }
 
+        //-----------------------------------------------------------------------------
+        VtDictionary GolaemUSD_DataParams::ToDict() const
+        {
+            VtDictionary dict;
+
+// Same as ToArgs, but values are stored with their type in a VtDictionary.
+#define xx(UNUSED_1, NAME, UNUSED_2) \
+    dict[GolaemUSD_DataParamsTokens->NAME] = VtValue(NAME);
+            GOLAEM_USD_DATA_PARAMS_X_FIELDS
+#undef xx
+            return dict;
+        }
+
+        /*static*/
+        //-----------------------------------------------------------------------------
+        bool GolaemUSD_DataParams::IsIdentityParam(const TfToken& paramName)
+        {
+            return paramName == GolaemUSD_DataParamsTokens->glmCacheLibFile ||
+                   paramName == GolaemUSD_DataParamsTokens->glmCacheLibItem ||
+                   paramName == GolaemUSD_DataParamsTokens->glmCrowdFields ||
+                   paramName == GolaemUSD_DataParamsTokens->glmCacheName ||
+                   paramName == GolaemUSD_DataParamsTokens->glmCacheDir ||
+                   paramName == GolaemUSD_DataParamsTokens->glmCharacterFiles ||
+                   paramName == GolaemUSD_DataParamsTokens->glmUsdCharacterFiles ||
+                   paramName == GolaemUSD_DataParamsTokens->glmEnableLayout ||
+                   paramName == GolaemUSD_DataParamsTokens->glmLayoutFiles ||
+                   paramName == GolaemUSD_DataParamsTokens->glmTerrainFile ||
+                   paramName == GolaemUSD_DataParamsTokens->glmDirmap ||
+                   paramName == GolaemUSD_DataParamsTokens->glmSyntheticCrowd;
+        }
+
+        //-----------------------------------------------------------------------------
+        SdfFileFormat::FileFormatArguments GolaemUSD_DataParams::ToIdentityArgs() const
+        {
+            SdfFileFormat::FileFormatArguments args = ToArgs();
+            for (auto itArg = args.begin(); itArg != args.end();)
+            {
+                if (IsIdentityParam(TfToken(itArg->first)))
+                {
+                    ++itArg;
+                }
+                else
+                {
+                    itArg = args.erase(itArg);
+                }
+            }
+            return args;
+        }
+
         /*static*/
         //-----------------------------------------------------------------------------
         GolaemUSD_DataRefPtr GolaemUSD_Data::New(const GolaemUSD_DataParams& params)
@@ -137,7 +187,7 @@ namespace glm
 
         //-----------------------------------------------------------------------------
         GolaemUSD_Data::GolaemUSD_Data(const GolaemUSD_DataParams& params)
-            : _impl(new GolaemUSD_DataImpl(params))
+            : _impl(GolaemUSD_DataImplRegistry::acquire(params))
         {
             TfWeakPtr<GolaemUSD_Data> me(this);
             TfNotice::Register(me, &GolaemUSD_Data::_HandleNotice);
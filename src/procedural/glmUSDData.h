@@ -43,6 +43,13 @@ namespace glm
     xx(TfToken, glmLayoutFiles, "")                 \
 	xx(TfToken, glmTerrainFile, "")                 \
     xx(float, glmRenderPercent, 100.f)              \
+    xx(short, glmRenderPercentMode, 0)              \
+    xx(TfToken, glmEntitySelection, "")             \
+    xx(int, glmShardIndex, 0)                       \
+    xx(int, glmShardCount, 1)                       \
+    xx(short, glmGroupBy, 0)                        \
+    xx(TfToken, glmGroupFilter, "")                 \
+    xx(bool, glmEntityPayloads, false)              \
     xx(short, glmDisplayMode, 2)                    \
     xx(short, glmGeometryTag, 0)                    \
     xx(TfToken, glmDirmap, "")                      \
@@ -51,7 +58,11 @@ namespace glm
     xx(TfToken, glmAttributeNamespace, "")          \
     xx(short, glmLodMode, 0)                        \
     xx(GfVec3f, glmCameraPos, 0)                    \
-    xx(TfToken, glmProceduralFile, "")
+    xx(TfToken, glmProceduralFile, "")              \
+    xx(TfToken, glmSyntheticCrowd, "")              \
+    xx(bool, glmCrowdFieldAttributes, false)        \
+    xx(TfToken, glmPPAttributeFilter, "")           \
+    xx(TfToken, glmShaderAttributeFilter, "")
         // clang-format on
 
         // A token of the same name must be defined for each parameter in the macro
@@ -70,6 +81,13 @@ namespace glm
     (glmLayoutFiles)                    \
 	(glmTerrainFile)                    \
     (glmRenderPercent)                  \
+    (glmRenderPercentMode)              \
+    (glmEntitySelection)                \
+    (glmShardIndex)                     \
+    (glmShardCount)                     \
+    (glmGroupBy)                        \
+    (glmGroupFilter)                    \
+    (glmEntityPayloads)                 \
     (glmDisplayMode)                    \
     (glmGeometryTag)                    \
     (glmDirmap)                         \
@@ -78,7 +96,11 @@ namespace glm
     (glmAttributeNamespace)             \
     (glmLodMode)                        \
     (glmCameraPos)                      \
-    (glmProceduralFile)
+    (glmProceduralFile)                 \
+    (glmSyntheticCrowd)                 \
+    (glmCrowdFieldAttributes)           \
+    (glmPPAttributeFilter)              \
+    (glmShaderAttributeFilter)
         // clang-format on
 
 #ifdef _MSC_VER
@@ -111,13 +133,23 @@ namespace glm
             // Converts this params structure into the file format arguments that could
             // be used to recreate these parameters.
             SdfFileFormat::FileFormatArguments ToArgs() const;
+
+            // Converts this params structure into a VtDictionary, as read by FromDict
+            VtDictionary ToDict() const;
+
+            // Identity params define the crowd (caches, characters, layouts, terrains), the other ones are
+            // view params selecting how it is displayed (render percent, lod, materials...)
+            static bool IsIdentityParam(const TfToken& paramName);
+
+            // Same as ToArgs, restricted to the identity params
+            SdfFileFormat::FileFormatArguments ToIdentityArgs() const;
         };
 
         class GolaemUSD_Data : public SdfAbstractData
         {
         private:
             // Pointer to the actual implementation
-            std::unique_ptr<GolaemUSD_DataImpl> _impl;
+            std::shared_ptr<GolaemUSD_DataImpl> _impl; // from GolaemUSD_DataImplRegistry
 
         public:
             /// Factory New. We always create this data with an explicit params object.
@@ -5,11 +5,20 @@
  ***************************************************************************/
 
 #include "glmUSDDataImpl.h"
+#include "glmUSDAssetRegistry.h"
 #include "glmUSDFileFormat.h"
+#include "glmUSDDebugCodes.h"
+#include "glmUSDPluginProductInformation.h"
 
 USD_INCLUDES_START
 #include <pxr/pxr.h>
+#include <pxr/base/tf/envSetting.h>
+#include <pxr/base/tf/patternMatcher.h>
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/usd/sdf/fileFormat.h>
+#include <pxr/usd/sdf/layer.h>
 #include <pxr/usd/sdf/schema.h>
+#include <pxr/usd/sdf/payload.h>
 #include <pxr/usd/sdf/reference.h>
 #include <pxr/usd/usd/prim.h>
 #include <pxr/usd/usd/attribute.h>
@@ -28,14 +37,16 @@ USD_INCLUDES_END
 #include <glmCrowdFBXCharacter.h>
 #include <glmCrowdGcgCharacter.h>
 #include <glmCrowdIOUtils.h>
-
-#ifdef TRACY_ENABLE
-#include <glmTracy.h>
-#endif
+#include <glmProductInformation.h>
 
 #include <glmDistance.h>
 
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
 #include <fstream>
+#include <map>
+#include <set>
 
 namespace glm
 {
@@ -274,10 +285,123 @@ namespace glm
             }
         }
 
+        // Read-only statistics published as attributes on the root prim, next to the usd params.
+        // They are computed when queried.
+        struct _RootStatsInfo
+        {
+            enum Kind
+            {
+                LAYER_MEMORY,
+                PROCESS_MEMORY,
+                PERF_COUNTER,
+                PERF_CACHE_HIT_RATIO,
+                PERF_SLOWEST_QUERY,
+                PERF_SLOWEST_QUERY_PER_FRAME
+            };
+            Kind kind = LAYER_MEMORY;
+            int index = 0;
+            TfToken typeName;
+        };
+
+        using _RootStatsMap =
+            std::map<TfToken, _RootStatsInfo, TfTokenFastArbitraryLessThan>;
+
+        TF_MAKE_STATIC_DATA(
+            (_RootStatsMap), _rootStatsAttributes)
+        {
+            TfToken int64TypeName = SdfSchema::GetInstance().FindType(VtValue(int64_t(0))).GetAsToken();
+            // one attribute per category and one for the total (MemoryCategory::END)
+            for (int iCategory = 0; iCategory <= MemoryCategory::END; ++iCategory)
+            {
+                const char* categoryName = MemoryCategory::getName((MemoryCategory::Value)iCategory);
+
+                _RootStatsInfo& layerInfo = (*_rootStatsAttributes)[TfToken(TfStringPrintf("glmMemory:layer:%s", categoryName))];
+                layerInfo.kind = _RootStatsInfo::LAYER_MEMORY;
+                layerInfo.index = iCategory;
+                layerInfo.typeName = int64TypeName;
+
+                _RootStatsInfo& processInfo = (*_rootStatsAttributes)[TfToken(TfStringPrintf("glmMemory:process:%s", categoryName))];
+                processInfo.kind = _RootStatsInfo::PROCESS_MEMORY;
+                processInfo.index = iCategory;
+                processInfo.typeName = int64TypeName;
+            }
+
+            // performance counters
+            for (int iCounter = 0; iCounter < PerfCounter::END; ++iCounter)
+            {
+                _RootStatsInfo& counterInfo = (*_rootStatsAttributes)[TfToken(TfStringPrintf("glmStats:%s", PerfCounter::getName((PerfCounter::Value)iCounter)))];
+                counterInfo.kind = _RootStatsInfo::PERF_COUNTER;
+                counterInfo.index = iCounter;
+                counterInfo.typeName = int64TypeName;
+            }
+            {
+                _RootStatsInfo& statsInfo = (*_rootStatsAttributes)[TfToken("glmStats:cacheHitRatio")];
+                statsInfo.kind = _RootStatsInfo::PERF_CACHE_HIT_RATIO;
+                statsInfo.typeName = SdfSchema::GetInstance().FindType(VtValue(double(0))).GetAsToken();
+            }
+            {
+                _RootStatsInfo& statsInfo = (*_rootStatsAttributes)[TfToken("glmStats:slowestQueryNs")];
+                statsInfo.kind = _RootStatsInfo::PERF_SLOWEST_QUERY;
+                statsInfo.typeName = int64TypeName;
+            }
+            {
+                // indexed by frame - first frame of the caches
+                _RootStatsInfo& statsInfo = (*_rootStatsAttributes)[TfToken("glmStats:slowestQueryNsPerFrame")];
+                statsInfo.kind = _RootStatsInfo::PERF_SLOWEST_QUERY_PER_FRAME;
+                statsInfo.typeName = SdfSchema::GetInstance().FindType(VtValue(VtInt64Array())).GetAsToken();
+            }
+        }
+
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif
 
+        TF_DEFINE_ENV_SETTING(GLMUSD_MEMORY_REPORT, false, "Print the memory report of each Golaem layer after loading and when it closes.");
+        TF_DEFINE_ENV_SETTING(GLMUSD_PERF_REPORT, false, "Print the performance counters of each Golaem layer when it closes.");
+        TF_DEFINE_ENV_SETTING(GLMUSD_DISK_CACHE_DIR, "", "Directory of the persistent deformed geometry cache, shared by all the processes opening a layer with the same params and input files.");
+        TF_DEFINE_ENV_SETTING(GLMUSD_SHM_CACHE_SIZE_MB, 0, "Size of the node-local shared memory geometry cache in MB (0 disables it), shared by the render processes opening a layer with the same params and input files.");
+
+        // all the layers alive in the process, used for the process-wide reports
+        static glm::Mutex s_liveImplsLock;
+        static std::set<const GolaemUSD_DataImpl*> s_liveImpls;
+
+        //-----------------------------------------------------------------------------
+        static bool _IsMemoryReportEnabled()
+        {
+            return TfDebug::IsEnabled(GLMUSD_MEMORY) || TfGetEnvSetting(GLMUSD_MEMORY_REPORT);
+        }
+
+        //-----------------------------------------------------------------------------
+        static void _PrintMemoryReports(const MemoryReport& layerReport, const GlmString& layerDescription)
+        {
+            MemoryReport processReport;
+            GolaemUSD_DataImpl::ComputeProcessMemoryReport(processReport);
+            GlmString report = layerReport.toString("[GolaemUSD] Memory report for " + layerDescription);
+            report += processReport.toString("[GolaemUSD] Memory report for the process");
+            printf("%s", report.c_str());
+        }
+
+        // Records the latency of a QueryTimeSample call, whatever the return path
+        class _QueryLatencyRecorder
+        {
+        public:
+            _QueryLatencyRecorder(PerfCounters& counters, double frame)
+                : _counters(counters)
+                , _frame(frame)
+                , _start(PerfCounters::now())
+            {
+            }
+            ~_QueryLatencyRecorder()
+            {
+                _counters.recordQuery(_frame, PerfCounters::now() - _start);
+            }
+
+        private:
+            PerfCounters& _counters;
+            double _frame;
+            uint64_t _start;
+        };
+
         // Helper function for getting the root prim path.
         static const SdfPath& _GetRootPrimPath()
         {
@@ -294,12 +418,12 @@ namespace glm
     }                                        \
     return true;
 
-        static glm::Mutex _fbxMutex;
+        static TraceMutex _fbxMutex{GLMUSD_MUTEX_DESC("FbxMutex")};
 
         //-----------------------------------------------------------------------------
         glm::crowdio::CrowdFBXStorage& getFbxStorage()
         {
-            glm::ScopedLock<glm::Mutex> lock(_fbxMutex);
+            glm::ScopedLock<TraceMutex> lock(_fbxMutex);
             static glm::crowdio::CrowdFBXStorage fbxStorage;
             return fbxStorage;
         }
@@ -308,7 +432,7 @@ namespace glm
         glm::crowdio::CrowdFBXBaker& getFbxBaker()
         {
             glm::crowdio::CrowdFBXStorage& fbxStorage = getFbxStorage();
-            glm::ScopedLock<glm::Mutex> lock(_fbxMutex);
+            glm::ScopedLock<TraceMutex> lock(_fbxMutex);
             static glm::crowdio::CrowdFBXBaker fbxBaker(fbxStorage.touchFbxSdkManager());
             return fbxBaker;
         }
@@ -323,13 +447,19 @@ namespace glm
         void GolaemUSD_DataImpl::EntityData::initEntityLock()
         {
             GLM_DEBUG_ASSERT(entityComputeLock == NULL);
-            entityComputeLock = new glm::Mutex();
+            entityComputeLock = new TraceMutex(GLMUSD_MUTEX_DESC("EntityData::entityComputeLock"));
+        }
+
+        //-----------------------------------------------------------------------------
+        GolaemUSD_DataImpl::CrowdFieldAttrData::~CrowdFieldAttrData()
+        {
+            delete computeLock;
         }
 
         //-----------------------------------------------------------------------------
         GolaemUSD_DataImpl::GolaemUSD_DataImpl(const GolaemUSD_DataParams& params)
             : _params(params)
-            , _factory(new crowdio::SimulationCacheFactory())
+            , _source(SimulationSource::create(params))
         {
             _rootNodeIdInFinalStage = usdplugin::init();
             _usdParams[_golaemTokens->__glmNodeId__] = _rootNodeIdInFinalStage;
@@ -383,18 +513,53 @@ namespace glm
                 _ppAttrTypes[attrTypeIdx] = SdfSchema::GetInstance().FindType(value).GetAsToken();
                 _ppAttrDefaultValues[attrTypeIdx] = value;
             }
+            std::shared_ptr<UsdParamsSnapshot> defaultUsdParams = std::make_shared<UsdParamsSnapshot>();
+            defaultUsdParams->values = _usdParams;
+            _defaultUsdParams = defaultUsdParams;
             _InitFromParams();
+            _perfCounters.setFrameRange(_startFrame, _endFrame);
+
+            {
+                glm::ScopedLock<glm::Mutex> liveImplsLock(s_liveImplsLock);
+                s_liveImpls.insert(this);
+            }
+            if (_IsMemoryReportEnabled())
+            {
+                MemoryReport layerReport;
+                ComputeMemoryReport(layerReport);
+                _PrintMemoryReports(layerReport, "loaded layer '" + GlmString(_params.glmProceduralFile.GetText()) + "'");
+            }
         }
 
         //-----------------------------------------------------------------------------
         GolaemUSD_DataImpl::~GolaemUSD_DataImpl()
         {
-            delete _factory;
-            for (glm::Mutex* lock : _cachedSimulationLocks)
             {
-                delete lock;
+                glm::ScopedLock<glm::Mutex> liveImplsLock(s_liveImplsLock);
+                s_liveImpls.erase(this);
+            }
+            if (_IsMemoryReportEnabled())
+            {
+                MemoryReport layerReport;
+                ComputeMemoryReport(layerReport);
+                _PrintMemoryReports(layerReport, "closing layer '" + GlmString(_params.glmProceduralFile.GetText()) + "'");
+            }
+            if (TfDebug::IsEnabled(GLMUSD_PERF) || TfGetEnvSetting(GLMUSD_PERF_REPORT))
+            {
+                GlmString report = _perfCounters.toString("[GolaemUSD] Performance counters for closing layer '" + GlmString(_params.glmProceduralFile.GetText()) + "'");
+                printf("%s", report.c_str());
+            }
+
+#ifdef TRACY_ENABLE
+            for (const auto& itMesh : _skinMeshDataMap)
+            {
+                GLMUSD_FREE(&itMesh.second, "DeformedGeometry");
             }
-            _cachedSimulationLocks.clear();
+#endif
+
+            delete _diskGeometryCache; // writes the pending frames
+            delete _sharedGeometryCache;
+            delete _source;
             usdplugin::finish();
         }
 
@@ -417,6 +582,10 @@ namespace glm
                 {
                     return SdfSpecTypeAttribute;
                 }
+                if (_FindCrowdFieldAttribute(path) != NULL)
+                {
+                    return SdfSpecTypeAttribute;
+                }
 
                 // A specific set of defined properties exist on the leaf prims only
                 // as attributes. Non leaf prims have no properties.
@@ -445,8 +614,8 @@ namespace glm
                     }
                     if (const SkelEntityData* entityData = TfMapLookupPtr(_skelEntityDataMap, primPath))
                     {
-                        if (TfMapLookupPtr(entityData->ppAttrIndexes, nameToken) != NULL ||
-                            TfMapLookupPtr(entityData->shaderAttrIndexes, nameToken) != NULL)
+                        if (TfMapLookupPtr(*entityData->ppAttrIndexes, nameToken) != NULL ||
+                            TfMapLookupPtr(*entityData->shaderAttrIndexes, nameToken) != NULL)
                         {
                             return SdfSpecTypeAttribute;
                         }
@@ -484,8 +653,8 @@ namespace glm
                     }
                     if (const SkinMeshEntityData* entityData = TfMapLookupPtr(_skinMeshEntityDataMap, primPath))
                     {
-                        if (TfMapLookupPtr(entityData->ppAttrIndexes, nameToken) != NULL ||
-                            TfMapLookupPtr(entityData->shaderAttrIndexes, nameToken) != NULL)
+                        if (TfMapLookupPtr(*entityData->ppAttrIndexes, nameToken) != NULL ||
+                            TfMapLookupPtr(*entityData->shaderAttrIndexes, nameToken) != NULL)
                         {
                             return SdfSpecTypeAttribute;
                         }
@@ -694,6 +863,29 @@ namespace glm
                     }
                 }
 
+                if (field == SdfFieldKeys->Payload)
+                {
+                    if (TfMapLookupPtr(_entityPayloadIds, path) != NULL)
+                    {
+                        // the entity prim has the same path in the payload layer
+                        RETURN_TRUE_WITH_OPTIONAL_VALUE(SdfPayloadListOp::CreateExplicit({SdfPayload(_params.glmProceduralFile.GetString(), path)}));
+                    }
+                }
+
+                if (field == GolaemUSDFileFormatTokens->Params)
+                {
+                    if (const int64_t* entityId = TfMapLookupPtr(_entityPayloadIds, path))
+                    {
+                        auto _MakeEntityParams = [this, entityId]()
+                        {
+                            VtDictionary entityParams = _entityPayloadParams;
+                            entityParams[GolaemUSD_DataParamsTokens->glmEntitySelection] = VtValue(TfToken(glm::toString(*entityId).c_str()));
+                            return entityParams;
+                        };
+                        RETURN_TRUE_WITH_OPTIONAL_VALUE(_MakeEntityParams());
+                    }
+                }
+
                 if (field == SdfChildrenKeys->PrimChildren)
                 {
                     // Non-leaf prims have the prim children. The list is the same set
@@ -730,8 +922,21 @@ namespace glm
                         {
                             usdTokens.push_back(TfToken(itDict.first));
                         }
+                        for (const auto& itStats : *_rootStatsAttributes)
+                        {
+                            usdTokens.push_back(itStats.first);
+                        }
                         RETURN_TRUE_WITH_OPTIONAL_VALUE(usdTokens);
                     }
+                    if (const CrowdFieldAttrData* cfAttrData = TfMapLookupPtr(_crowdFieldAttrDataMap, path))
+                    {
+                        std::vector<TfToken> cfTokens;
+                        for (const auto& itAttr : cfAttrData->attrIndexes)
+                        {
+                            cfTokens.push_back(itAttr.first);
+                        }
+                        RETURN_TRUE_WITH_OPTIONAL_VALUE(cfTokens);
+                    }
                     // Leaf prims have the same specified set of property children.
                     if (_params.glmDisplayMode == GolaemDisplayMode::SKELETON)
                     {
@@ -740,12 +945,12 @@ namespace glm
                             std::vector<TfToken> entityTokens = _skelEntityPropertyTokens->allTokens;
                             entityTokens.insert(entityTokens.end(), _skelEntityRelationshipTokens->allTokens.begin(), _skelEntityRelationshipTokens->allTokens.end());
                             // add pp attributes
-                            for (const auto& itAttr : entityData->ppAttrIndexes)
+                            for (const auto& itAttr : *entityData->ppAttrIndexes)
                             {
                                 entityTokens.push_back(itAttr.first);
                             }
                             // add shader attributes
-                            for (const auto& itAttr : entityData->shaderAttrIndexes)
+                            for (const auto& itAttr : *entityData->shaderAttrIndexes)
                             {
                                 entityTokens.push_back(itAttr.first);
                             }
@@ -762,12 +967,12 @@ namespace glm
                         {
                             std::vector<TfToken> entityTokens = _skinMeshEntityPropertyTokens->allTokens;
                             // add pp attributes
-                            for (const auto& itAttr : entityData->ppAttrIndexes)
+                            for (const auto& itAttr : *entityData->ppAttrIndexes)
                             {
                                 entityTokens.push_back(itAttr.first);
                             }
                             // add shader attributes
-                            for (const auto& itAttr : entityData->shaderAttrIndexes)
+                            for (const auto& itAttr : *entityData->shaderAttrIndexes)
                             {
                                 entityTokens.push_back(itAttr.first);
                             }
@@ -805,6 +1010,14 @@ namespace glm
                     return;
                 }
             }
+            // Visit the read-only stats.
+            for (const auto& itStats : *_rootStatsAttributes)
+            {
+                if (!visitor->VisitSpec(data, _GetRootPrimPath().AppendProperty(itStats.first)))
+                {
+                    return;
+                }
+            }
 
             // Visit all the cached prim spec paths.
             for (const auto& path : _primSpecPaths)
@@ -814,6 +1027,17 @@ namespace glm
                     return;
                 }
             }
+            // Visit the attribute arrays of the crowd field prims.
+            for (const auto& it : _crowdFieldAttrDataMap)
+            {
+                for (const auto& itAttr : it.second.attrIndexes)
+                {
+                    if (!visitor->VisitSpec(data, it.first.AppendProperty(itAttr.first)))
+                    {
+                        return;
+                    }
+                }
+            }
             if (_params.glmDisplayMode == GolaemDisplayMode::SKELETON)
             {
                 // Visit the property specs which exist only on entity prims.
@@ -834,7 +1058,7 @@ namespace glm
                         }
                     }
 
-                    for (const auto& itAttr : it.second.ppAttrIndexes)
+                    for (const auto& itAttr : *it.second.ppAttrIndexes)
                     {
                         if (!visitor->VisitSpec(data, it.first.AppendProperty(itAttr.first)))
                         {
@@ -842,7 +1066,7 @@ namespace glm
                         }
                     }
 
-                    for (const auto& itAttr : it.second.shaderAttrIndexes)
+                    for (const auto& itAttr : *it.second.shaderAttrIndexes)
                     {
                         if (!visitor->VisitSpec(data, it.first.AppendProperty(itAttr.first)))
                         {
@@ -874,7 +1098,7 @@ namespace glm
                         }
                     }
 
-                    for (const auto& itAttr : it.second.ppAttrIndexes)
+                    for (const auto& itAttr : *it.second.ppAttrIndexes)
                     {
                         if (!visitor->VisitSpec(data, it.first.AppendProperty(itAttr.first)))
                         {
@@ -882,7 +1106,7 @@ namespace glm
                         }
                     }
 
-                    for (const auto& itAttr : it.second.shaderAttrIndexes)
+                    for (const auto& itAttr : *it.second.shaderAttrIndexes)
                     {
                         if (!visitor->VisitSpec(data, it.first.AppendProperty(itAttr.first)))
                         {
@@ -953,6 +1177,10 @@ namespace glm
                     {
                         return nonAnimPropFields;
                     }
+                    if (const CrowdFieldAttrData::Attribute* cfAttribute = _FindCrowdFieldAttribute(path))
+                    {
+                        return cfAttribute->kind == CrowdFieldAttrData::AttrKind::ENTITY_ID ? nonAnimInterpPropFields : animInterpPropFields;
+                    }
                     if (_params.glmDisplayMode == GolaemDisplayMode::SKELETON)
                     {
                         if (const _PrimPropertyInfo* propInfo = TfMapLookupPtr(*_skelEntityProperties, nameToken))
@@ -999,8 +1227,8 @@ namespace glm
                         }
                         if (const SkelEntityData* entityData = TfMapLookupPtr(_skelEntityDataMap, primPath))
                         {
-                            if (TfMapLookupPtr(entityData->ppAttrIndexes, nameToken) != NULL ||
-                                TfMapLookupPtr(entityData->shaderAttrIndexes, nameToken) != NULL)
+                            if (TfMapLookupPtr(*entityData->ppAttrIndexes, nameToken) != NULL ||
+                                TfMapLookupPtr(*entityData->shaderAttrIndexes, nameToken) != NULL)
                             {
                                 // pp or shader attributes are animated
                                 return animPropFields;
@@ -1071,8 +1299,8 @@ namespace glm
                         }
                         if (const SkinMeshEntityData* entityData = TfMapLookupPtr(_skinMeshEntityDataMap, primPath))
                         {
-                            if (TfMapLookupPtr(entityData->ppAttrIndexes, nameToken) != NULL ||
-                                TfMapLookupPtr(entityData->shaderAttrIndexes, nameToken) != NULL)
+                            if (TfMapLookupPtr(*entityData->ppAttrIndexes, nameToken) != NULL ||
+                                TfMapLookupPtr(*entityData->shaderAttrIndexes, nameToken) != NULL)
                             {
                                 // pp or shader attributes are animated
                                 return animPropFields;
@@ -1103,6 +1331,15 @@ namespace glm
             }
             else if (_primSpecPaths.find(path) != _primSpecPaths.end())
             {
+                if (TfMapLookupPtr(_entityPayloadIds, path) != NULL)
+                {
+                    static std::vector<TfToken> entityPayloadPrimFields(
+                        {SdfFieldKeys->Specifier,
+                         SdfFieldKeys->Payload,
+                         GolaemUSDFileFormatTokens->Params});
+                    return entityPayloadPrimFields;
+                }
+
                 // Prim spec. Different fields for leaf and non-leaf prims.
                 if (_params.glmDisplayMode == GolaemDisplayMode::SKELETON)
                 {
@@ -1257,9 +1494,9 @@ namespace glm
         }
 
         //-----------------------------------------------------------------------------
-        bool GolaemUSD_DataImpl::_QueryEntityAttributes(const EntityData* genericEntityData, const TfToken& nameToken, const double& frame, VtValue* value)
+        bool GolaemUSD_DataImpl::_QueryEntityAttributes(const EntityData* genericEntityData, const TfToken& nameToken, VtValue* value)
         {
-            if (const size_t* ppAttrIdx = TfMapLookupPtr(genericEntityData->ppAttrIndexes, nameToken))
+            if (const size_t* ppAttrIdx = TfMapLookupPtr(*genericEntityData->ppAttrIndexes, nameToken))
             {
                 if (value)
                 {
@@ -1278,67 +1515,364 @@ namespace glm
                 }
                 return true;
             }
-            if (const size_t* shaderAttrIdx = TfMapLookupPtr(genericEntityData->shaderAttrIndexes, nameToken))
+            if (const size_t* shaderAttrIdx = TfMapLookupPtr(*genericEntityData->shaderAttrIndexes, nameToken))
             {
                 if (value)
                 {
-                    const glm::ShaderAttribute& shaderAttr = genericEntityData->inputGeoData._character->_shaderAttributes[*shaderAttrIdx];
-                    const glm::ShaderAssetDataContainer* shaderDataContainer = NULL;
+                    // the values were copied by _ComputeEntity: no need to access the crowd field source
+                    const ShaderAttrInfo& shaderAttrInfo = _shaderAttrsPerChar[genericEntityData->inputGeoData._characterIdx].attributes[*shaderAttrIdx];
+                    switch (shaderAttrInfo.type)
+                    {
+                    case glm::ShaderAttributeType::INT:
+                    {
+                        if (shaderAttrInfo.isBool)
+                        {
+                            *value = VtValue(genericEntityData->intShaderAttrValues[shaderAttrInfo.valueIdx] != 0);
+                        }
+                        else
+                        {
+                            *value = VtValue(genericEntityData->intShaderAttrValues[shaderAttrInfo.valueIdx]);
+                        }
+                    }
+                    break;
+                    case glm::ShaderAttributeType::FLOAT:
+                    {
+                        *value = VtValue(genericEntityData->floatShaderAttrValues[shaderAttrInfo.valueIdx]);
+                    }
+                    break;
+                    case glm::ShaderAttributeType::STRING:
+                    {
+                        *value = VtValue(genericEntityData->stringShaderAttrValues[shaderAttrInfo.valueIdx]);
+                    }
+                    break;
+                    case glm::ShaderAttributeType::VECTOR:
+                    {
+                        *value = VtValue(genericEntityData->vectorShaderAttrValues[shaderAttrInfo.valueIdx]);
+                    }
+                    break;
+                    default:
+                        break;
+                    }
+                }
+                return true;
+            }
+            return false;
+        }
+
+        //-----------------------------------------------------------------------------
+        void GolaemUSD_DataImpl::_InitCrowdFieldAttributes(CrowdFieldAttrData& cfAttrData, const glm::crowdio::GlmSimulationData* simuData, const PPAttrTable& ppAttrTable)
+        {
+            GLMUSD_ZONE("InitFromParams::CrowdFieldAttributes");
+            typedef CrowdFieldAttrData::AttrKind AttrKind;
+            auto addAttribute = [&cfAttrData](const glm::GlmString& attrName, AttrKind::Value kind, const VtValue& defaultValue) -> CrowdFieldAttrData::Attribute*
+            {
+                TfToken attrNameToken(("primvars:" + attrName).c_str());
+                if (cfAttrData.attrIndexes.find(attrNameToken) != cfAttrData.attrIndexes.end())
+                {
+                    return NULL;
+                }
+                cfAttrData.attrIndexes[attrNameToken] = cfAttrData.attributes.size();
+                cfAttrData.attributes.push_back(CrowdFieldAttrData::Attribute());
+                CrowdFieldAttrData::Attribute& attribute = cfAttrData.attributes[cfAttrData.attributes.size() - 1];
+                attribute.kind = kind;
+                attribute.typeName = SdfSchema::GetInstance().FindType(defaultValue).GetAsToken();
+                attribute.values = defaultValue;
+                return &attribute;
+            };
+
+            // entity id of each array element
+            size_t entityCount = cfAttrData.entityIndices.size();
+            VtInt64Array entityIds(entityCount);
+            for (size_t iElement = 0; iElement < entityCount; ++iElement)
+            {
+                entityIds[iElement] = simuData->_entityIds[cfAttrData.entityIndices[iElement]];
+            }
+            addAttribute("entityId", AttrKind::ENTITY_ID, VtValue(entityIds));
+
+            for (const auto& itPPAttr : ppAttrTable.indexes)
+            {
+                size_t iPPAttr = itPPAttr.second;
+                if (iPPAttr < ppAttrTable.floatAttrs.size())
+                {
+                    if (CrowdFieldAttrData::Attribute* attribute = addAttribute(itPPAttr.first.GetText(), AttrKind::PP_FLOAT, VtValue(VtFloatArray())))
+                    {
+                        attribute->ppAttrIdx = ppAttrTable.floatAttrs[iPPAttr];
+                    }
+                }
+                else if (CrowdFieldAttrData::Attribute* attribute = addAttribute(itPPAttr.first.GetText(), AttrKind::PP_VECTOR, VtValue(VtVec3fArray())))
+                {
+                    attribute->ppAttrIdx = ppAttrTable.vectorAttrs[iPPAttr - ppAttrTable.floatAttrs.size()];
+                }
+            }
+
+            // union of the shader attributes of the characters used in the crowd field
+            glm::PODArray<bool> isCharacterUsed;
+            isCharacterUsed.resize(_shaderAttrsPerChar.size(), false);
+            for (size_t iElement = 0; iElement < entityCount; ++iElement)
+            {
+                isCharacterUsed[simuData->_characterIdx[cfAttrData.entityIndices[iElement]]] = true;
+            }
+            for (size_t iChar = 0, charCount = _shaderAttrsPerChar.size(); iChar < charCount; ++iChar)
+            {
+                if (!isCharacterUsed[iChar])
+                {
+                    continue;
+                }
+                const glm::Array<ShaderAttrInfo>& shaderAttrInfos = _shaderAttrsPerChar[iChar].attributes;
+                for (size_t iShAttr = 0, shAttrCount = shaderAttrInfos.size(); iShAttr < shAttrCount; ++iShAttr)
+                {
+                    const ShaderAttrInfo& shAttrInfo = shaderAttrInfos[iShAttr];
+                    VtValue defaultValue;
+                    switch (shAttrInfo.type)
+                    {
+                    case glm::ShaderAttributeType::INT:
+                        defaultValue = shAttrInfo.isBool ? VtValue(VtBoolArray()) : VtValue(VtIntArray());
+                        break;
+                    case glm::ShaderAttributeType::FLOAT:
+                        defaultValue = VtValue(VtFloatArray());
+                        break;
+                    case glm::ShaderAttributeType::STRING:
+                        defaultValue = VtValue(VtTokenArray());
+                        break;
+                    case glm::ShaderAttributeType::VECTOR:
+                        defaultValue = VtValue(VtVec3fArray());
+                        break;
+                    default:
+                        continue;
+                    }
+
+                    const GlmString attrName = shAttrInfo.name.GetText();
+                    CrowdFieldAttrData::Attribute* attribute = addAttribute(attrName, AttrKind::SHADER, defaultValue);
+                    if (attribute != NULL)
                     {
-                        glm::ScopedLock<glm::Mutex> cachedSimuLock(*genericEntityData->cachedSimulationLock);
-                        shaderDataContainer = genericEntityData->cachedSimulation->getFinalShaderData(frame, UINT32_MAX, true);
+                        attribute->shaderType = shAttrInfo.type;
+                        attribute->isBool = shAttrInfo.isBool;
+                        attribute->shaderAttrIdxPerChar.resize(_shaderAttrsPerChar.size(), -1);
                     }
-                    if (shaderDataContainer != NULL)
+                    else
                     {
-                        size_t specificAttrIdx = shaderDataContainer->globalToSpecificShaderAttrIdxPerChar[genericEntityData->inputGeoData._characterIdx][*shaderAttrIdx];
-                        switch (shaderAttr._type)
+                        // already added by another character
+                        attribute = &cfAttrData.attributes[cfAttrData.attrIndexes[TfToken(("primvars:" + attrName).c_str())]];
+                        if (attribute->kind != AttrKind::SHADER || attribute->shaderType != shAttrInfo.type || attribute->isBool != shAttrInfo.isBool)
                         {
-                        case glm::ShaderAttributeType::INT:
+                            GLM_CROWD_TRACE_WARNING_LIMIT("The shader attribute '" << attrName << "' has different types in the characters of the crowd field. Skipping it for character '" << iChar << "'.");
+                            continue;
+                        }
+                    }
+                    attribute->shaderAttrIdxPerChar[iChar] = (int)iShAttr;
+                }
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        const GolaemUSD_DataImpl::CrowdFieldAttrData::Attribute* GolaemUSD_DataImpl::_FindCrowdFieldAttribute(const SdfPath& path) const
+        {
+            if (_crowdFieldAttrDataMap.empty() || !path.IsPrimPropertyPath())
+            {
+                return NULL;
+            }
+            const CrowdFieldAttrData* cfAttrData = TfMapLookupPtr(_crowdFieldAttrDataMap, path.GetAbsoluteRootOrPrimPath());
+            if (cfAttrData == NULL)
+            {
+                return NULL;
+            }
+            const size_t* cfAttrIdx = TfMapLookupPtr(cfAttrData->attrIndexes, path.GetNameToken());
+            return cfAttrIdx != NULL ? &cfAttrData->attributes[*cfAttrIdx] : NULL;
+        }
+
+        //-----------------------------------------------------------------------------
+        void GolaemUSD_DataImpl::_ComputeCrowdFieldAttributes(CrowdFieldAttrData& cfAttrData, double frame)
+        {
+            if (cfAttrData.computed && !glm::approxDiff(cfAttrData.computedTimeSample, frame, static_cast<double>(GLM_NUMERICAL_PRECISION)))
+            {
+                return;
+            }
+            GLMUSD_ZONE("ComputeCrowdFieldAttributes");
+            cfAttrData.computedTimeSample = frame;
+            cfAttrData.computed = true;
+
+            // the frame data is read until the end of the compute
+            CrowdFieldSource::FramePin framePin(cfAttrData.crowdFieldSource, frame);
+            const glm::crowdio::GlmSimulationData* simuData = NULL;
+            const glm::crowdio::GlmFrameData* frameData = NULL;
+            const glm::ShaderAssetDataContainer* shaderDataContainer = NULL;
+            {
+                uint64_t lockStart = PerfCounters::now();
+                glm::ScopedLock<TraceMutex> cachedSimuLock(cfAttrData.crowdFieldSource->getLock());
+                _perfCounters.add(PerfCounter::CACHED_SIMULATION_LOCK_WAIT_NS, PerfCounters::now() - lockStart);
+                simuData = cfAttrData.crowdFieldSource->getSimulationData();
+                frameData = cfAttrData.crowdFieldSource->getFrameData(frame);
+                shaderDataContainer = cfAttrData.crowdFieldSource->getShaderData(frame);
+            }
+
+            // one pass per attribute over all the entities of the crowd field
+            size_t entityCount = cfAttrData.entityIndices.size();
+            for (CrowdFieldAttrData::Attribute& attribute : cfAttrData.attributes)
+            {
+                if (attribute.kind == CrowdFieldAttrData::AttrKind::ENTITY_ID)
+                {
+                    continue;
+                }
+                if (simuData == NULL || frameData == NULL || shaderDataContainer == NULL)
+                {
+                    // keep the type of the array
+                    attribute.values = SdfSchema::GetInstance().FindType(attribute.typeName).GetDefaultValue();
+                    continue;
+                }
+
+                switch (attribute.kind)
+                {
+                case CrowdFieldAttrData::AttrKind::PP_FLOAT:
+                {
+                    VtFloatArray values(entityCount);
+                    for (size_t iElement = 0; iElement < entityCount; ++iElement)
+                    {
+                        values[iElement] = frameData->_ppFloatAttributeData[attribute.ppAttrIdx][simuData->_entityToBakeIndex[cfAttrData.entityIndices[iElement]]];
+                    }
+                    attribute.values.Swap(values);
+                }
+                break;
+                case CrowdFieldAttrData::AttrKind::PP_VECTOR:
+                {
+                    VtVec3fArray values(entityCount);
+                    for (size_t iElement = 0; iElement < entityCount; ++iElement)
+                    {
+                        values[iElement].Set(frameData->_ppVectorAttributeData[attribute.ppAttrIdx][simuData->_entityToBakeIndex[cfAttrData.entityIndices[iElement]]]);
+                    }
+                    attribute.values.Swap(values);
+                }
+                break;
+                case CrowdFieldAttrData::AttrKind::SHADER:
+                {
+                    // returns the index of the value in the type specific shader data of the entity, -1 if its character does not have the attribute
+                    auto getSpecificAttrIdx = [&](uint32_t entityIdx) -> int
+                    {
+                        int characterIdx = simuData->_characterIdx[entityIdx];
+                        int shaderAttrIdx = attribute.shaderAttrIdxPerChar[characterIdx];
+                        return shaderAttrIdx < 0 ? -1 : (int)shaderDataContainer->globalToSpecificShaderAttrIdxPerChar[characterIdx][shaderAttrIdx];
+                    };
+                    switch (attribute.shaderType)
+                    {
+                    case glm::ShaderAttributeType::INT:
+                    {
+                        if (attribute.isBool)
                         {
-							glm::GlmString attrName, subAttrName;
-							glm::crowdio::RendererAttributeType::Value overrideType(glm::crowdio::RendererAttributeType::END);
-							glm::crowdio::parseRendererAttribute("arnold", shaderAttr._name, attrName, subAttrName, overrideType);
-							if(overrideType == glm::crowdio::RendererAttributeType::BOOL)
+                            VtBoolArray values(entityCount, false);
+                            for (size_t iElement = 0; iElement < entityCount; ++iElement)
                             {
-                                *value = VtValue(genericEntityData->intShaderAttrValues[specificAttrIdx] != 0);
+                                uint32_t entityIdx = cfAttrData.entityIndices[iElement];
+                                int specificAttrIdx = getSpecificAttrIdx(entityIdx);
+                                if (specificAttrIdx >= 0)
+                                {
+                                    values[iElement] = shaderDataContainer->intData[entityIdx][specificAttrIdx] != 0;
+                                }
                             }
-                            else
+                            attribute.values.Swap(values);
+                        }
+                        else
+                        {
+                            VtIntArray values(entityCount, 0);
+                            for (size_t iElement = 0; iElement < entityCount; ++iElement)
                             {
-                                *value = VtValue(genericEntityData->intShaderAttrValues[specificAttrIdx]);
+                                uint32_t entityIdx = cfAttrData.entityIndices[iElement];
+                                int specificAttrIdx = getSpecificAttrIdx(entityIdx);
+                                if (specificAttrIdx >= 0)
+                                {
+                                    values[iElement] = shaderDataContainer->intData[entityIdx][specificAttrIdx];
+                                }
                             }
+                            attribute.values.Swap(values);
                         }
-                        break;
-                        case glm::ShaderAttributeType::FLOAT:
+                    }
+                    break;
+                    case glm::ShaderAttributeType::FLOAT:
+                    {
+                        VtFloatArray values(entityCount, 0.f);
+                        for (size_t iElement = 0; iElement < entityCount; ++iElement)
                         {
-                            *value = VtValue(genericEntityData->floatShaderAttrValues[specificAttrIdx]);
+                            uint32_t entityIdx = cfAttrData.entityIndices[iElement];
+                            int specificAttrIdx = getSpecificAttrIdx(entityIdx);
+                            if (specificAttrIdx >= 0)
+                            {
+                                values[iElement] = shaderDataContainer->floatData[entityIdx][specificAttrIdx];
+                            }
                         }
-                        break;
-                        case glm::ShaderAttributeType::STRING:
+                        attribute.values.Swap(values);
+                    }
+                    break;
+                    case glm::ShaderAttributeType::STRING:
+                    {
+                        // keep the previous tokens when the values did not change
+                        VtTokenArray values = attribute.values.IsHolding<VtTokenArray>() ? attribute.values.UncheckedGet<VtTokenArray>() : VtTokenArray();
+                        values.resize(entityCount);
+                        for (size_t iElement = 0; iElement < entityCount; ++iElement)
                         {
-                            *value = VtValue(genericEntityData->stringShaderAttrValues[specificAttrIdx]);
+                            uint32_t entityIdx = cfAttrData.entityIndices[iElement];
+                            int specificAttrIdx = getSpecificAttrIdx(entityIdx);
+                            const char* newValue = specificAttrIdx >= 0 ? shaderDataContainer->stringData[entityIdx][specificAttrIdx].c_str() : "";
+                            if (strcmp(values[iElement].GetText(), newValue) != 0)
+                            {
+                                values[iElement] = TfToken(newValue);
+                            }
                         }
-                        break;
-                        case glm::ShaderAttributeType::VECTOR:
+                        attribute.values.Swap(values);
+                    }
+                    break;
+                    case glm::ShaderAttributeType::VECTOR:
+                    {
+                        VtVec3fArray values(entityCount, GfVec3f(0));
+                        for (size_t iElement = 0; iElement < entityCount; ++iElement)
                         {
-                            *value = VtValue(genericEntityData->vectorShaderAttrValues[specificAttrIdx]);
+                            uint32_t entityIdx = cfAttrData.entityIndices[iElement];
+                            int specificAttrIdx = getSpecificAttrIdx(entityIdx);
+                            if (specificAttrIdx >= 0)
+                            {
+                                values[iElement].Set(shaderDataContainer->vectorData[entityIdx][specificAttrIdx].getFloatValues());
+                            }
                         }
+                        attribute.values.Swap(values);
+                    }
+                    break;
+                    default:
                         break;
-                        default:
-                            break;
-                        }
                     }
                 }
-                return true;
+                break;
+                default:
+                    break;
+                }
             }
-            return false;
         }
 
         //-----------------------------------------------------------------------------
         bool GolaemUSD_DataImpl::QueryTimeSample(const SdfPath& path, double frame, VtValue* value)
         {
+            _QueryLatencyRecorder latencyRecorder(_perfCounters, frame);
+
+            double lastQueriedFrame = _lastQueriedFrame.load(std::memory_order_relaxed);
+            if (glm::approxDiff(lastQueriedFrame, frame, static_cast<double>(GLM_NUMERICAL_PRECISION)) && _lastQueriedFrame.compare_exchange_strong(lastQueriedFrame, frame))
+            {
+                GLMUSD_FRAME_MARK(frame);
+            }
+
             SdfPath primPath = path.GetAbsoluteRootOrPrimPath();
             const TfToken& nameToken = path.GetNameToken();
 
+            if (CrowdFieldAttrData* cfAttrData = TfMapLookupPtr(_crowdFieldAttrDataMap, primPath))
+            {
+                const size_t* cfAttrIdx = TfMapLookupPtr(cfAttrData->attrIndexes, nameToken);
+                if (cfAttrIdx == NULL)
+                {
+                    return false;
+                }
+                // need to lock the crowd field until the array is retrieved
+                uint64_t lockStart = PerfCounters::now();
+                glm::ScopedLock<TraceMutex> cfComputeLock(*cfAttrData->computeLock);
+                _perfCounters.add(PerfCounter::ENTITY_COMPUTE_LOCK_WAIT_NS, PerfCounters::now() - lockStart);
+                _ComputeCrowdFieldAttributes(*cfAttrData, frame);
+                RETURN_TRUE_WITH_OPTIONAL_VALUE(cfAttrData->attributes[*cfAttrIdx].values);
+            }
+
             bool isEntityPath = true;
             const EntityData* genericEntityData = NULL;
             if (_params.glmDisplayMode == GolaemDisplayMode::SKELETON)
@@ -1359,12 +1893,10 @@ namespace glm
                     return false;
                 }
 
-                // need to lock the wrapper until all the data is retrieved
-                glm::ScopedLockActivable<glm::Mutex> wrapperLock(_usdWrapper._updateLock);
-                _usdWrapper.update(frame, wrapperLock);
-
                 // need to lock the entity until all the data is retrieved
-                glm::ScopedLock<glm::Mutex> entityComputeLock(*entityData->entityComputeLock);
+                uint64_t lockStart = PerfCounters::now();
+                glm::ScopedLock<TraceMutex> entityComputeLock(*entityData->entityComputeLock);
+                _perfCounters.add(PerfCounter::ENTITY_COMPUTE_LOCK_WAIT_NS, PerfCounters::now() - lockStart);
                 _ComputeSkelEntity(entityData, frame);
                 genericEntityData = entityData;
 
@@ -1375,7 +1907,7 @@ namespace glm
                     {
                         RETURN_TRUE_WITH_OPTIONAL_VALUE(entityData->enabled ? UsdGeomTokens->inherited : UsdGeomTokens->invisible);
                     }
-                    return _QueryEntityAttributes(genericEntityData, nameToken, frame, value);
+                    return _QueryEntityAttributes(genericEntityData, nameToken, value);
                 }
                 else
                 {
@@ -1438,12 +1970,10 @@ namespace glm
                     return false;
                 }
 
-                // need to lock the wrapper until all the data is retrieved
-                glm::ScopedLockActivable<glm::Mutex> wrapperLock(_usdWrapper._updateLock);
-                _usdWrapper.update(frame, wrapperLock);
-
                 // need to lock the entity until all the data is retrieved
-                glm::ScopedLock<glm::Mutex> entityComputeLock(*entityData->entityComputeLock);
+                uint64_t lockStart = PerfCounters::now();
+                glm::ScopedLock<TraceMutex> entityComputeLock(*entityData->entityComputeLock);
+                _perfCounters.add(PerfCounter::ENTITY_COMPUTE_LOCK_WAIT_NS, PerfCounters::now() - lockStart);
                 _ComputeSkinMeshEntity(entityData, frame);
                 genericEntityData = entityData;
 
@@ -1459,7 +1989,7 @@ namespace glm
                     {
                         RETURN_TRUE_WITH_OPTIONAL_VALUE(entityData->enabled ? UsdGeomTokens->inherited : UsdGeomTokens->invisible);
                     }
-                    return _QueryEntityAttributes(genericEntityData, nameToken, frame, value);
+                    return _QueryEntityAttributes(genericEntityData, nameToken, value);
                 }
                 else if (isMeshPath)
                 {
@@ -1488,6 +2018,7 @@ namespace glm
         //-----------------------------------------------------------------------------
         void loadSimulationCacheLib(glm::crowdio::SimulationCacheLibrary& simuCacheLibrary, const glm::GlmString& cacheLibPath)
         {
+            GLMUSD_ZONE("LoadSimulationCacheLib");
             if (!cacheLibPath.empty() && glm::FileDir::exist(cacheLibPath.c_str()))
             {
                 std::ifstream inFile(cacheLibPath.c_str());
@@ -1508,12 +2039,330 @@ namespace glm
             }
         }
 
-        //-----------------------------------------------------------------------------
+        // Simulation cache library item read by the layers, shared through the asset registry
+        struct CacheLibItem
+        {
+            bool found = false;      // false if the library has no item
+            bool isFallback = false; // the requested item was not found, the first item of the library is used
+            glm::GlmString crowdFields;
+            glm::GlmString cacheName;
+            glm::GlmString cacheDir;
+            glm::GlmString characterFiles;
+            glm::GlmString destTerrain;
+            bool enableLayout = false;
+            glm::GlmString layoutFile;
+        };
+
+        //-----------------------------------------------------------------------------
+        std::shared_ptr<const CacheLibItem> loadCacheLibItem(const glm::GlmString& cacheLibPath, const glm::GlmString& itemName)
+        {
+            std::shared_ptr<CacheLibItem> cacheLibItem = std::make_shared<CacheLibItem>();
+            glm::crowdio::SimulationCacheLibrary simuCacheLibrary;
+            loadSimulationCacheLib(simuCacheLibrary, cacheLibPath);
+            glm::crowdio::SimulationCacheInformation* cacheInfo = simuCacheLibrary.getCacheInformationByItemName(itemName.c_str());
+            if (cacheInfo == NULL && simuCacheLibrary.getCacheInformationCount() > 0)
+            {
+                cacheLibItem->isFallback = true;
+                cacheInfo = &simuCacheLibrary.getCacheInformation(0);
+            }
+            if (cacheInfo != NULL)
+            {
+                cacheLibItem->found = true;
+                cacheLibItem->crowdFields = cacheInfo->_crowdFields;
+                cacheLibItem->cacheName = cacheInfo->_cacheName;
+                cacheLibItem->cacheDir = cacheInfo->_cacheDir;
+                cacheLibItem->characterFiles = cacheInfo->_characterFiles;
+                cacheLibItem->destTerrain = cacheInfo->_destTerrain;
+                cacheLibItem->enableLayout = cacheInfo->_enableLayout;
+                cacheLibItem->layoutFile = cacheInfo->_layoutFile;
+            }
+            return cacheLibItem;
+        }
+
+        // Glob patterns selecting attribute or group names: "pattern1 pattern2 -excludedPattern".
+        // All the names are included when there is no include pattern.
+        class NameFilter
+        {
+        public:
+            NameFilter(const std::string& filter)
+            {
+                for (const std::string& pattern : TfStringTokenize(filter, " ,;"))
+                {
+                    if (pattern[0] == '-')
+                    {
+                        _excludes.push_back(TfPatternMatcher(pattern.substr(1), true, true));
+                    }
+                    else
+                    {
+                        _includes.push_back(TfPatternMatcher(pattern, true, true));
+                    }
+                }
+            }
+
+            bool isIncluded(const std::string& name) const
+            {
+                bool isIncluded = _includes.empty();
+                for (size_t iPattern = 0; iPattern < _includes.size() && !isIncluded; ++iPattern)
+                {
+                    isIncluded = _includes[iPattern].Match(name);
+                }
+                for (size_t iPattern = 0; iPattern < _excludes.size() && isIncluded; ++iPattern)
+                {
+                    isIncluded = !_excludes[iPattern].Match(name);
+                }
+                return isIncluded;
+            }
+
+        private:
+            std::vector<TfPatternMatcher> _includes;
+            std::vector<TfPatternMatcher> _excludes;
+        };
+
+        // Entity ids and id ranges selecting the loaded entities: "1001 1005-1050 !1010".
+        // All the entities are selected when there is no include item.
+        class EntityIdSelection
+        {
+        public:
+            typedef std::pair<int64_t, int64_t> IdRange;
+
+            EntityIdSelection(const std::string& selection)
+            {
+                for (const std::string& item : TfStringTokenize(selection, " ,;"))
+                {
+                    bool isExcluded = item[0] == '!';
+                    const char* rangeStart = item.c_str() + (isExcluded ? 1 : 0);
+                    char* rangeEnd = NULL;
+                    IdRange range;
+                    range.first = strtoll(rangeStart, &rangeEnd, 10);
+                    range.second = range.first;
+                    if (rangeEnd != rangeStart && *rangeEnd == '-')
+                    {
+                        rangeStart = rangeEnd + 1;
+                        range.second = strtoll(rangeStart, &rangeEnd, 10);
+                    }
+                    if (rangeEnd == rangeStart || *rangeEnd != '\0' || range.second < range.first)
+                    {
+                        GLM_CROWD_TRACE_WARNING("Invalid item '" << item << "' in glmEntitySelection '" << selection << "'. Expected an entity id or an id range like '1001-1050', with '!' to exclude them.");
+                        continue;
+                    }
+                    (isExcluded ? _excludes : _includes).push_back(range);
+                }
+                _mergeRanges(_includes);
+                _mergeRanges(_excludes);
+            }
+
+            bool isSelected(int64_t entityId) const
+            {
+                return (_includes.empty() || _isInRanges(_includes, entityId)) && !_isInRanges(_excludes, entityId);
+            }
+
+        private:
+            static void _mergeRanges(std::vector<IdRange>& ranges)
+            {
+                std::sort(ranges.begin(), ranges.end());
+                size_t mergedCount = 0;
+                for (size_t iRange = 0; iRange < ranges.size(); ++iRange)
+                {
+                    if (mergedCount > 0 && ranges[iRange].first <= ranges[mergedCount - 1].second + 1)
+                    {
+                        ranges[mergedCount - 1].second = std::max(ranges[mergedCount - 1].second, ranges[iRange].second);
+                    }
+                    else
+                    {
+                        ranges[mergedCount++] = ranges[iRange];
+                    }
+                }
+                ranges.resize(mergedCount);
+            }
+
+            static bool _isInRanges(const std::vector<IdRange>& ranges, int64_t entityId)
+            {
+                // first range starting after the id, the previous one is the only one which can contain it
+                auto itRange = std::upper_bound(ranges.begin(), ranges.end(), IdRange(entityId, INT64_MAX));
+                return itRange != ranges.begin() && entityId <= (itRange - 1)->second;
+            }
+
+            std::vector<IdRange> _includes;
+            std::vector<IdRange> _excludes;
+        };
+
+        //-----------------------------------------------------------------------------
+        // Stamps of the geometry files (fbx, gcg) of a character: they change when the geometry is exported again
+        static glm::GlmString getCharacterGeometryStamps(const glm::GolaemCharacter* character, const glm::Array<glm::GlmString>& dirmapRules)
+        {
+            glm::GlmString geometryStamps;
+            glm::GlmString geometryFile;
+            for (size_t iGeoAsset = 0, geoAssetCount = character->_geometryAssets.size(); iGeoAsset < geoAssetCount; ++iGeoAsset)
+            {
+                findDirmappedFile(geometryFile, character->_geometryAssets[iGeoAsset]._fileName, dirmapRules);
+                geometryStamps += geometryFile + "|" + AssetRegistry::getFileStamp(geometryFile.c_str()).c_str() + "\n";
+            }
+            return geometryStamps;
+        }
+
+        //-----------------------------------------------------------------------------
+        // Deterministic value in [0, 1) per entity id: the entities kept at a render percent are also kept at any higher render percent
+        static float getEntitySelectionRank(int64_t entityId)
+        {
+            uint64_t hash = (uint64_t)entityId + 0x9E3779B97F4A7C15ull;
+            hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+            hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+            hash ^= hash >> 31;
+            return (float)(hash >> 40) / (float)(1 << 24);
+        }
+
+        //-----------------------------------------------------------------------------
+        // Selects the entities of a crowd field to materialize from the candidates (entity indices passing the id and group selections),
+        // the shard and the render percent
+        static void selectEntities(
+            const glm::crowdio::GlmSimulationData* simuData,
+            const glm::crowdio::GlmFrameData* firstFrameData,
+            glm::PODArray<uint32_t>& candidates,
+            int shardIndex,
+            int shardCount,
+            float renderPercent,
+            GolaemRenderPercentMode::Value renderPercentMode,
+            glm::PODArray<bool>& isEntitySelected)
+        {
+            isEntitySelected.resize(simuData->_entityCount, false);
+            if (shardIndex < 0 || shardIndex >= shardCount)
+            {
+                return;
+            }
+
+            if (shardCount > 1)
+            {
+                // contiguous slice of the selected entities, the shards of a crowd field do not overlap
+                size_t shardStart = candidates.size() * (size_t)shardIndex / (size_t)shardCount;
+                size_t shardEnd = candidates.size() * (size_t)(shardIndex + 1) / (size_t)shardCount;
+                for (size_t iCandidate = shardStart; iCandidate < shardEnd; ++iCandidate)
+                {
+                    candidates[iCandidate - shardStart] = candidates[iCandidate];
+                }
+                candidates.resize(shardEnd - shardStart);
+            }
+            renderPercent = std::min(std::max(renderPercent, 0.f), 1.f);
+            size_t selectedCount = (size_t)floor(candidates.size() * (double)renderPercent);
+            if (selectedCount == 0)
+            {
+                return;
+            }
+            if (selectedCount == candidates.size())
+            {
+                renderPercentMode = GolaemRenderPercentMode::FIRST;
+            }
+            if (renderPercentMode == GolaemRenderPercentMode::STRATIFIED && firstFrameData == NULL)
+            {
+                renderPercentMode = GolaemRenderPercentMode::RANDOM;
+            }
+
+            switch (renderPercentMode)
+            {
+            case GolaemRenderPercentMode::RANDOM:
+            {
+                for (size_t iCandidate = 0, candidateCount = candidates.size(); iCandidate < candidateCount; ++iCandidate)
+                {
+                    uint32_t iEntity = candidates[iCandidate];
+                    isEntitySelected[iEntity] = getEntitySelectionRank(simuData->_entityIds[iEntity]) < renderPercent;
+                }
+            }
+            break;
+            case GolaemRenderPercentMode::STRATIFIED:
+            {
+                // grid on the two largest axes of the entity positions at the first frame, with about one selected entity per cell.
+                // Each cell keeps its entities of lowest rank, the selected count is spread over the cells by error diffusion
+                size_t candidateCount = candidates.size();
+                std::vector<GfVec3f> positions(candidateCount);
+                GfVec3f minPos(FLT_MAX), maxPos(-FLT_MAX);
+                for (size_t iCandidate = 0; iCandidate < candidateCount; ++iCandidate)
+                {
+                    uint32_t iEntity = candidates[iCandidate];
+                    uint16_t entityType = simuData->_entityTypes[iEntity];
+                    uint32_t bonePositionOffset = simuData->_iBoneOffsetPerEntityType[entityType] + simuData->_indexInEntityType[iEntity] * simuData->_boneCount[entityType];
+                    positions[iCandidate].Set(firstFrameData->_bonePositions[bonePositionOffset]);
+                    for (int iAxis = 0; iAxis < 3; ++iAxis)
+                    {
+                        minPos[iAxis] = std::min(minPos[iAxis], positions[iCandidate][iAxis]);
+                        maxPos[iAxis] = std::max(maxPos[iAxis], positions[iCandidate][iAxis]);
+                    }
+                }
+                GfVec3f extent = maxPos - minPos;
+                int axes[3] = {0, 1, 2};
+                std::sort(axes, axes + 3, [&extent](int axisA, int axisB) { return extent[axisA] > extent[axisB]; });
+                size_t resolutions[2] = {1, 1};
+                if (extent[axes[1]] > 0)
+                {
+                    float cellSize = sqrtf(extent[axes[0]] * extent[axes[1]] / selectedCount);
+                    resolutions[0] = (size_t)ceilf(extent[axes[0]] / cellSize);
+                    resolutions[1] = (size_t)ceilf(extent[axes[1]] / cellSize);
+                }
+                else if (extent[axes[0]] > 0)
+                {
+                    resolutions[0] = selectedCount;
+                }
+
+                struct StratifiedEntity
+                {
+                    size_t cellIdx;
+                    float rank;
+                    uint32_t iEntity;
+                    bool operator<(const StratifiedEntity& other) const { return cellIdx < other.cellIdx || (cellIdx == other.cellIdx && rank < other.rank); }
+                };
+                std::vector<StratifiedEntity> stratifiedEntities(candidateCount);
+                for (size_t iCandidate = 0; iCandidate < candidateCount; ++iCandidate)
+                {
+                    size_t cellCoords[2] = {0, 0};
+                    for (int iGridAxis = 0; iGridAxis < 2; ++iGridAxis)
+                    {
+                        int axis = axes[iGridAxis];
+                        if (resolutions[iGridAxis] > 1)
+                        {
+                            size_t cellCoord = (size_t)((positions[iCandidate][axis] - minPos[axis]) / extent[axis] * resolutions[iGridAxis]);
+                            cellCoords[iGridAxis] = std::min(cellCoord, resolutions[iGridAxis] - 1);
+                        }
+                    }
+                    StratifiedEntity& stratifiedEntity = stratifiedEntities[iCandidate];
+                    stratifiedEntity.cellIdx = cellCoords[1] * resolutions[0] + cellCoords[0];
+                    stratifiedEntity.iEntity = candidates[iCandidate];
+                    stratifiedEntity.rank = getEntitySelectionRank(simuData->_entityIds[stratifiedEntity.iEntity]);
+                }
+                std::sort(stratifiedEntities.begin(), stratifiedEntities.end());
+
+                size_t processedCount = 0;
+                size_t keptCount = 0;
+                for (size_t iCellStart = 0; iCellStart < candidateCount;)
+                {
+                    size_t iCellEnd = iCellStart;
+                    while (iCellEnd < candidateCount && stratifiedEntities[iCellEnd].cellIdx == stratifiedEntities[iCellStart].cellIdx)
+                    {
+                        ++iCellEnd;
+                    }
+                    processedCount += iCellEnd - iCellStart;
+                    size_t cellKeptCount = (size_t)floor(processedCount * (double)renderPercent) - keptCount;
+                    for (size_t iKept = 0; iKept < cellKeptCount; ++iKept)
+                    {
+                        isEntitySelected[stratifiedEntities[iCellStart + iKept].iEntity] = true;
+                    }
+                    keptCount += cellKeptCount;
+                    iCellStart = iCellEnd;
+                }
+            }
+            break;
+            default:
+            {
+                for (size_t iCandidate = 0; iCandidate < selectedCount; ++iCandidate)
+                {
+                    isEntitySelected[candidates[iCandidate]] = true;
+                }
+            }
+            break;
+            }
+        }
+
+        //-----------------------------------------------------------------------------
         void GolaemUSD_DataImpl::_InitFromParams()
         {
-#ifdef TRACY_ENABLE
-            ZoneScopedNC("InitFromParams", GLM_COLOR_CACHE);
-#endif
+            GLMUSD_ZONE("InitFromParams");
 
             _startFrame = INT_MAX;
             _endFrame = INT_MIN;
@@ -1522,9 +2371,15 @@ namespace glm
             glm::GlmString correctedFilePath;
             glm::Array<glm::GlmString> dirmapRules = glm::stringToStringArray(_params.glmDirmap.GetText(), ";");
 
-            glm::crowdio::SimulationCacheLibrary simuCacheLibrary;
+            // input files of the disk geometry cache key
+            glm::Array<glm::GlmString> dependencyFiles;
+
             findDirmappedFile(correctedFilePath, _params.glmCacheLibFile.GetText(), dirmapRules);
-            loadSimulationCacheLib(simuCacheLibrary, correctedFilePath);
+            glm::GlmString cacheLibPath = correctedFilePath;
+            glm::GlmString cacheLibItemName = _params.glmCacheLibItem.GetText();
+            std::shared_ptr<const CacheLibItem> cacheLibItem = AssetRegistry::get<CacheLibItem>(
+                std::string(cacheLibPath.c_str()) + "|" + cacheLibItemName.c_str(), cacheLibPath.c_str(), [&]() { return loadCacheLibItem(cacheLibPath, cacheLibItemName); });
+            dependencyFiles.push_back(correctedFilePath);
 
             glm::GlmString cfNames;
             glm::GlmString cacheName;
@@ -1537,22 +2392,20 @@ namespace glm
 
             glm::GlmString usdCharacterFiles;
 
-            glm::crowdio::SimulationCacheInformation* cacheInfo = simuCacheLibrary.getCacheInformationByItemName(_params.glmCacheLibItem.GetText());
-            if (cacheInfo == NULL && simuCacheLibrary.getCacheInformationCount() > 0)
+            if (cacheLibItem->isFallback)
             {
                 GLM_CROWD_TRACE_WARNING("Could not find simulation cache item '" << _params.glmCacheLibItem.GetText() << "' in library file '" << _params.glmCacheLibFile.GetText() << "'");
-                cacheInfo = &simuCacheLibrary.getCacheInformation(0);
             }
 
-            if (cacheInfo != NULL)
+            if (cacheLibItem->found)
             {
-                cfNames = cacheInfo->_crowdFields;
-                cacheName = cacheInfo->_cacheName;
-                cacheDir = cacheInfo->_cacheDir;
-                characterFiles = cacheInfo->_characterFiles;
-                dstTerrainFile = cacheInfo->_destTerrain;
-                enableLayout = cacheInfo->_enableLayout;
-                layoutFiles = cacheInfo->_layoutFile;
+                cfNames = cacheLibItem->crowdFields;
+                cacheName = cacheLibItem->cacheName;
+                cacheDir = cacheLibItem->cacheDir;
+                characterFiles = cacheLibItem->characterFiles;
+                dstTerrainFile = cacheLibItem->destTerrain;
+                enableLayout = cacheLibItem->enableLayout;
+                layoutFiles = cacheLibItem->layoutFile;
                 layoutFiles.trim(";");
             }
             // override cacheInfo params if neeeded
@@ -1588,13 +2441,73 @@ namespace glm
             }
 
             float renderPercent = _params.glmRenderPercent * 0.01f;
+            GolaemRenderPercentMode::Value renderPercentMode = (GolaemRenderPercentMode::Value)_params.glmRenderPercentMode;
+            if (renderPercentMode < 0 || renderPercentMode >= GolaemRenderPercentMode::END)
+            {
+                GLM_CROWD_TRACE_WARNING("Invalid glmRenderPercentMode: '" << _params.glmRenderPercentMode << "'. Using the first entities.");
+                renderPercentMode = GolaemRenderPercentMode::FIRST;
+            }
+            EntityIdSelection entityIdSelection(_params.glmEntitySelection.GetString());
+            int shardCount = _params.glmShardCount;
+            int shardIndex = _params.glmShardIndex;
+            if (shardCount < 1)
+            {
+                GLM_CROWD_TRACE_WARNING("Invalid glmShardCount: '" << shardCount << "'. Loading all the entities.");
+                shardCount = 1;
+                shardIndex = 0;
+            }
+            else if (shardIndex < 0 || shardIndex >= shardCount)
+            {
+                // no fallback to the whole crowd field: the other shards would be loaded twice
+                GLM_CROWD_TRACE_WARNING("Invalid glmShardIndex: '" << shardIndex << "' for glmShardCount '" << shardCount << "'. No entity will be loaded.");
+            }
+
+            // entity payloads: the entities are only prims with a payload to the same procedural file, selecting them by id
+            bool entityPayloads = _params.glmEntityPayloads;
+            if (entityPayloads && _params.glmProceduralFile.IsEmpty())
+            {
+                GLM_CROWD_TRACE_WARNING("glmEntityPayloads requires a procedural file (the layer must be opened from a .glmusd file). Loading the entities in the layer.");
+                entityPayloads = false;
+            }
 
             // terrain file
             glm::Array<glm::GlmString> crowdFieldNames = glm::stringToStringArray(cfNames.c_str(), ";");
             if (crowdFieldNames.size())
                 srcTerrainFile = cacheDir + "/" + cacheName + "." + crowdFieldNames[0] + ".gtg";
+            else
+                _source->getDefaultCrowdFieldNames(crowdFieldNames);
 
             GolaemDisplayMode::Value displayMode = (GolaemDisplayMode::Value)_params.glmDisplayMode;
+            if (!_source->hasCharacterGeometry() && displayMode != GolaemDisplayMode::BOUNDING_BOX)
+            {
+                GLM_CROWD_TRACE_WARNING("The simulation source has no character geometry. Using the bounding box display mode.");
+                displayMode = GolaemDisplayMode::BOUNDING_BOX;
+                _params.glmDisplayMode = (short)displayMode;
+            }
+
+            if (entityPayloads && displayMode == GolaemDisplayMode::SKELETON)
+            {
+                // the skel animations are not under the entity prims: a payload to an entity prim would not bring its animation
+                GLM_CROWD_TRACE_WARNING("glmEntityPayloads is not supported in the skeleton display mode. Loading the entities in the layer.");
+                entityPayloads = false;
+            }
+            if (entityPayloads)
+            {
+                // the entity selection is already done here
+                GolaemUSD_DataParams entityParams = _params;
+                entityParams.glmEntityPayloads = false;
+                entityParams.glmRenderPercent = 100.f;
+                entityParams.glmRenderPercentMode = GolaemRenderPercentMode::FIRST;
+                entityParams.glmShardIndex = 0;
+                entityParams.glmShardCount = 1;
+                if (_params.glmCrowdFieldAttributes)
+                {
+                    // the crowd field prim of a payload layer is not under its entity prim
+                    GLM_CROWD_TRACE_WARNING("glmCrowdFieldAttributes is disabled with glmEntityPayloads: the attributes are published on the entity prims.");
+                    entityParams.glmCrowdFieldAttributes = false;
+                }
+                _entityPayloadParams = entityParams.ToDict();
+            }
 
             GlmString attributeNamespace = _params.glmAttributeNamespace.GetText();
             attributeNamespace.rtrim(":");
@@ -1608,6 +2521,7 @@ namespace glm
                     const glm::GlmString& characterFile = characterFilesList[iCharFile];
                     findDirmappedFile(correctedFilePath, characterFile, dirmapRules);
                     characterFilesList[iCharFile] = correctedFilePath;
+                    dependencyFiles.push_back(correctedFilePath);
                 }
                 characterFiles = glm::stringArrayToString(characterFilesList, ";");
             }
@@ -1621,43 +2535,43 @@ namespace glm
                 usdCharacterFilesList[iCharFile] = correctedFilePath;
             }
 
-            _factory->loadGolaemCharacters(characterFiles.c_str());
+            {
+                GLMUSD_ZONE("InitFromParams::LoadCharacters");
+                _source->loadCharacters(characterFiles);
+            }
 
             glm::Array<glm::GlmString> layoutFilesArray = glm::stringToStringArray(layoutFiles, ";");
             size_t layoutCount = layoutFilesArray.size();
             if (enableLayout && layoutCount > 0)
             {
+                GLMUSD_ZONE("InitFromParams::LoadLayouts");
                 for (size_t iLayout = 0; iLayout < layoutCount; ++iLayout)
                 {
-                    const glm::GlmString& layoutFile = layoutFilesArray[iLayout];
                     // dirmap layout file
-                    findDirmappedFile(correctedFilePath, layoutFile, dirmapRules);
-                    if (correctedFilePath.length() > 0)
-                    {
-                        _factory->loadLayoutHistoryFile(_factory->getLayoutHistoryCount(), correctedFilePath.c_str());
-                    }
+                    findDirmappedFile(correctedFilePath, layoutFilesArray[iLayout], dirmapRules);
+                    layoutFilesArray[iLayout] = correctedFilePath;
+                    dependencyFiles.push_back(correctedFilePath);
                 }
+                _source->loadLayouts(layoutFilesArray);
             }
 
-            glm::crowdio::crowdTerrain::TerrainMesh* sourceTerrain = NULL;
-            glm::crowdio::crowdTerrain::TerrainMesh* destTerrain = NULL;
-            if (!srcTerrainFile.empty())
-            {
-                // dirmap terrain file
-                findDirmappedFile(correctedFilePath, srcTerrainFile, dirmapRules);
-                sourceTerrain = glm::crowdio::crowdTerrain::loadTerrainAsset(correctedFilePath.c_str());
-            }
-            if (!dstTerrainFile.empty())
             {
-                // dirmap terrain file
-                findDirmappedFile(correctedFilePath, dstTerrainFile, dirmapRules);
-                destTerrain = glm::crowdio::crowdTerrain::loadTerrainAsset(correctedFilePath.c_str());
-            }
-            if (destTerrain == NULL)
-            {
-                destTerrain = sourceTerrain;
+                GLMUSD_ZONE("InitFromParams::LoadTerrains");
+                // dirmap terrain files
+                if (!srcTerrainFile.empty())
+                {
+                    findDirmappedFile(correctedFilePath, srcTerrainFile, dirmapRules);
+                    srcTerrainFile = correctedFilePath;
+                }
+                if (!dstTerrainFile.empty())
+                {
+                    findDirmappedFile(correctedFilePath, dstTerrainFile, dirmapRules);
+                    dstTerrainFile = correctedFilePath;
+                }
+                _source->loadTerrains(srcTerrainFile, dstTerrainFile);
+                dependencyFiles.push_back(srcTerrainFile);
+                dependencyFiles.push_back(dstTerrainFile);
             }
-            _factory->setTerrainMeshes(sourceTerrain, destTerrain);
 
             // dirmap cache dir
             findDirmappedFile(correctedFilePath, cacheDir, dirmapRules);
@@ -1672,25 +2586,128 @@ namespace glm
                     continue;
                 }
 
-                glm::crowdio::CachedSimulation& cachedSimulation = _factory->getCachedSimulation(cacheDir.c_str(), cacheName.c_str(), glmCfName.c_str());
-                cachedSimulation.getFinalSimulationData();
+                GLMUSD_ZONE("InitFromParams::LoadSimulationData");
+                CrowdFieldSource* crowdFieldSource = _source->getCrowdField(cacheDir, cacheName, glmCfName);
+                glm::ScopedLock<TraceMutex> cachedSimuLock(crowdFieldSource->getLock());
+                crowdFieldSource->getSimulationData();
+                // the simulation cache header is rewritten each time the crowd field is cached again
+                dependencyFiles.push_back(cacheDir + "/" + cacheName + "." + glmCfName + ".gscs");
+            }
+
+            int characterCount = _source->getCharacterCount();
+
+            // entity groups: the group filter matches the character names when the entities are not grouped
+            GolaemGroupBy::Value groupBy = (GolaemGroupBy::Value)_params.glmGroupBy;
+            if (groupBy < 0 || groupBy >= GolaemGroupBy::END)
+            {
+                GLM_CROWD_TRACE_WARNING("Invalid glmGroupBy: '" << _params.glmGroupBy << "'. The entities will not be grouped.");
+                groupBy = GolaemGroupBy::NONE;
+            }
+            NameFilter groupFilter(_params.glmGroupFilter.GetString());
+            struct EntityGroup
+            {
+                TfToken name;
+                bool isIncluded = true;
+            };
+            std::map<std::pair<int32_t, int32_t>, EntityGroup> entityGroups; // by character and rendering type indices
+            auto getEntityGroup = [&](const glm::crowdio::GlmSimulationData* simuData, uint32_t iEntity) -> const EntityGroup&
+            {
+                int32_t characterIdx = simuData->_characterIdx[iEntity];
+                int32_t renderingTypeIdx = groupBy == GolaemGroupBy::RENDERING_TYPE ? simuData->_renderingTypeIdx[iEntity] : -1;
+                auto itGroup = entityGroups.find(std::make_pair(characterIdx, renderingTypeIdx));
+                if (itGroup != entityGroups.end())
+                {
+                    return itGroup->second;
+                }
+                EntityGroup& entityGroup = entityGroups[std::make_pair(characterIdx, renderingTypeIdx)];
+                const glm::GolaemCharacter* character = _source->getCharacter(characterIdx);
+                glm::GlmString groupName = character != NULL ? character->_name : glm::GlmString("InvalidCharacter");
+                if (groupBy == GolaemGroupBy::RENDERING_TYPE)
+                {
+                    if (character != NULL && renderingTypeIdx >= 0 && renderingTypeIdx < character->_renderingTypes.sizeInt())
+                    {
+                        groupName += "_" + character->_renderingTypes[renderingTypeIdx]._name;
+                    }
+                    else
+                    {
+                        groupName += "_DefaultRenderingType";
+                    }
+                }
+                entityGroup.name = TfToken(TfMakeValidIdentifier(groupName.c_str()));
+                entityGroup.isIncluded = groupFilter.isIncluded(entityGroup.name.GetString());
+                return entityGroup;
+            };
+
+            // entities to materialize in each crowd field and characters they use: the other characters are not prepared
+            glm::Array<glm::PODArray<bool>> isEntitySelectedPerCf;
+            isEntitySelectedPerCf.resize(crowdFieldNames.size());
+            glm::PODArray<bool> isCharacterUsed;
+            isCharacterUsed.resize(characterCount, false);
+            for (size_t iCf = 0, cfCount = crowdFieldNames.size(); iCf < cfCount; ++iCf)
+            {
+                const glm::GlmString& glmCfName = crowdFieldNames[iCf];
+                if (glmCfName.empty())
+                {
+                    continue;
+                }
+
+                GLMUSD_ZONE("InitFromParams::SelectEntities");
+                CrowdFieldSource* crowdFieldSource = _source->getCrowdField(cacheDir, cacheName, glmCfName);
+                const glm::crowdio::GlmSimulationData* simuData = NULL;
+                int firstFrameInCache, lastFrameInCache;
+                {
+                    glm::ScopedLock<TraceMutex> cachedSimuLock(crowdFieldSource->getLock());
+                    simuData = crowdFieldSource->getSimulationData();
+                    crowdFieldSource->getFrameRange(firstFrameInCache, lastFrameInCache);
+                }
+                if (simuData == NULL)
+                {
+                    continue;
+                }
+
+                glm::PODArray<uint32_t> candidates;
+                for (uint32_t iEntity = 0; iEntity < simuData->_entityCount; ++iEntity)
+                {
+                    int64_t entityId = simuData->_entityIds[iEntity];
+                    if (entityId >= 0 && entityIdSelection.isSelected(entityId) && getEntityGroup(simuData, iEntity).isIncluded) // negative ids are killed entities
+                    {
+                        candidates.push_back(iEntity);
+                    }
+                }
+                glm::PODArray<bool>& isEntitySelected = isEntitySelectedPerCf[iCf];
+                {
+                    CrowdFieldSource::FramePin framePin(crowdFieldSource, firstFrameInCache);
+                    glm::ScopedLock<TraceMutex> cachedSimuLock(crowdFieldSource->getLock());
+                    selectEntities(simuData, crowdFieldSource->getFrameData(firstFrameInCache), candidates, shardIndex, shardCount, renderPercent, renderPercentMode, isEntitySelected);
+                }
+                for (uint32_t iEntity = 0; iEntity < simuData->_entityCount; ++iEntity)
+                {
+                    int32_t characterIdx = simuData->_characterIdx[iEntity];
+                    if (isEntitySelected[iEntity] && !entityPayloads && characterIdx >= 0 && characterIdx < characterCount)
+                    {
+                        isCharacterUsed[characterIdx] = true;
+                    }
+                }
             }
 
             // Layer always has a root spec that is the default prim of the layer.
             _primSpecPaths.insert(_GetRootPrimPath());
             std::vector<TfToken>& rootChildNames = _primChildNames[_GetRootPrimPath()];
 
-            _sgToSsPerChar.resize(_factory->getGolaemCharacters().size());
-            _snsIndicesPerChar.resize(_factory->getGolaemCharacters().size());
-            glm::Array<VtTokenArray> jointsPerChar(_factory->getGolaemCharacters().size());
-            for (int iChar = 0, charCount = _factory->getGolaemCharacters().sizeInt(); iChar < charCount; ++iChar)
+            _sgToSsPerChar.resize(characterCount);
+            _snsIndicesPerChar.resize(characterCount);
+            _shaderAttrsPerChar.resize(characterCount);
+            NameFilter shaderAttrFilter(_params.glmShaderAttributeFilter.GetString());
+            glm::Array<VtTokenArray> jointsPerChar(characterCount);
+            for (int iChar = 0; iChar < characterCount; ++iChar)
             {
-                const glm::GolaemCharacter* character = _factory->getGolaemCharacter(iChar);
-                if (character == NULL)
+                const glm::GolaemCharacter* character = _source->getCharacter(iChar);
+                if (character == NULL || !isCharacterUsed[iChar])
                 {
                     continue;
                 }
 
+                GLMUSD_ZONE("InitFromParams::CharacterTables");
                 glm::PODArray<int>& shadingGroupToSurfaceShader = _sgToSsPerChar[iChar];
                 shadingGroupToSurfaceShader.resize(character->_shadingGroups.size(), -1);
                 for (size_t iSg = 0, sgCount = character->_shadingGroups.size(); iSg < sgCount; ++iSg)
@@ -1703,6 +2720,48 @@ namespace glm
                     }
                 }
 
+                // shader attribute names and types, shared by all the entities of the character
+                CharacterShaderAttrs& characterShaderAttrs = _shaderAttrsPerChar[iChar];
+                characterShaderAttrs.attributes.resize(character->_shaderAttributes.size());
+                glm::GlmString attrName, subAttrName;
+                for (size_t iShAttr = 0, shAttrCount = character->_shaderAttributes.size(); iShAttr < shAttrCount; ++iShAttr)
+                {
+                    const glm::ShaderAttribute& shAttr = character->_shaderAttributes[iShAttr];
+                    if (!shaderAttrFilter.isIncluded(shAttr._name.c_str()))
+                    {
+                        continue;
+                    }
+                    ShaderAttrInfo& shAttrInfo = characterShaderAttrs.attributes[iShAttr];
+                    glm::crowdio::RendererAttributeType::Value overrideType(glm::crowdio::RendererAttributeType::END);
+                    attrName = shAttr._name.c_str();
+                    if (glm::crowdio::parseRendererAttribute("arnold", shAttr._name, attrName, subAttrName, overrideType))
+                    {
+                        attrName = "arnold:" + PXR_NS::TfMakeValidIdentifier(attrName.c_str());
+                    }
+                    else
+                    {
+                        attrName = PXR_NS::TfMakeValidIdentifier(attrName.c_str());
+                    }
+                    if (!attributeNamespace.empty())
+                    {
+                        attrName = attributeNamespace + ":" + attrName;
+                    }
+                    shAttrInfo.name = TfToken(attrName.c_str());
+                    shAttrInfo.type = (glm::ShaderAttributeType::Value)shAttr._type;
+                    shAttrInfo.isBool = shAttrInfo.type == glm::ShaderAttributeType::INT && overrideType == glm::crowdio::RendererAttributeType::BOOL;
+                    if (shAttrInfo.type < glm::ShaderAttributeType::END)
+                    {
+                        shAttrInfo.valueIdx = characterShaderAttrs.valueCounts[shAttrInfo.type]++;
+                        characterShaderAttrs.indexes[shAttrInfo.name] = iShAttr;
+                    }
+                }
+
+                if (character->_converterMapping._skeletonDescription == NULL)
+                {
+                    // no skeleton (synthetic characters)
+                    continue;
+                }
+
                 PODArray<int>& characterSnsIndices = _snsIndicesPerChar[iChar];
                 VtTokenArray& characterJoints = jointsPerChar[iChar];
                 characterJoints.resize(character->_converterMapping._skeletonDescription->getBones().size());
@@ -1726,99 +2785,148 @@ namespace glm
                 }
             }
 
+            glm::GlmString usedGeometryStamps; // geometry files of the used characters, part of the geometry caches key
             if (displayMode == GolaemDisplayMode::SKINMESH)
             {
-                _skinMeshTemplateDataPerCharPerLod.resize(_factory->getGolaemCharacters().size());
+                GLMUSD_ZONE("InitFromParams::SkinMeshTemplates");
+                _skinMeshTemplateDataPerChar.resize(characterCount);
+                _materialPathsPerChar.resize(characterCount);
+
+                // everything the templates depend on besides the character index (the simulation can create characters)
+                glm::GlmString templateKeyPrefix = characterFiles + "\n" + cacheDir + "/" + cacheName + "." + glm::stringArrayToString(crowdFieldNames, ";") + "\n" + _params.glmDirmap.GetText() + "\n" + glm::toString(_params.glmGeometryTag) + "\n" + glm::toString(_params.glmLodMode != 0 ? 1 : 0) + "\n";
+
+                // templates sidecar files are keyed by the plugin version, the template key, the character files and their geometry files
+                const std::string& cacheRootDir = TfGetEnvSetting(GLMUSD_DISK_CACHE_DIR);
+                uint64_t templateFileKeyPrefix = 0;
+                if (!cacheRootDir.empty())
+                {
+                    templateFileKeyPrefix = DiskGeometryCache::hash(usdplugin::getProductInformation().getCString());
+                    templateFileKeyPrefix = DiskGeometryCache::hash(templateKeyPrefix.c_str(), templateFileKeyPrefix);
+                    glm::Array<glm::GlmString> characterFilesArray = glm::stringToStringArray(characterFiles, ";");
+                    for (const glm::GlmString& characterFile : characterFilesArray)
+                    {
+                        double modificationTime = 0;
+                        ArchGetModificationTime(characterFile.c_str(), &modificationTime);
+                        int64_t fileSize = ArchGetFileLength(characterFile.c_str());
+                        templateFileKeyPrefix = DiskGeometryCache::hash(&modificationTime, sizeof(modificationTime), templateFileKeyPrefix);
+                        templateFileKeyPrefix = DiskGeometryCache::hash(&fileSize, sizeof(fileSize), templateFileKeyPrefix);
+                    }
+                }
 
                 PODArray<int> meshAssets;
 
-                for (int iChar = 0, charCount = _factory->getGolaemCharacters().sizeInt(); iChar < charCount; ++iChar)
+                for (int iChar = 0; iChar < characterCount; ++iChar)
                 {
-                    const glm::GolaemCharacter* character = _factory->getGolaemCharacter(iChar);
-                    if (character == NULL)
+                    const glm::GolaemCharacter* character = _source->getCharacter(iChar);
+                    if (character == NULL || !isCharacterUsed[iChar])
                     {
+                        _skinMeshTemplateDataPerChar[iChar] = std::make_shared<SkinMeshCharacterTemplateData>();
                         continue;
                     }
+                    _ComputeMaterialPaths(iChar, character);
 
-                    glm::crowdio::InputEntityGeoData inputGeoData;
-                    inputGeoData._fbxStorage = &getFbxStorage();
-                    inputGeoData._fbxBaker = &getFbxBaker();
-                    inputGeoData._geometryTag = _params.glmGeometryTag;
-                    inputGeoData._enableLOD = _params.glmLodMode != 0 ? 1 : 0;
-
-                    inputGeoData._dirMapRules = dirmapRules;
-                    inputGeoData._entityId = -1;
-                    inputGeoData._simuData = NULL;
-                    inputGeoData._entityToBakeIndex = -1;
-                    inputGeoData._character = character;
-                    inputGeoData._characterIdx = iChar;
+                    // the template point counts come from the geometry files: templates of a previous export must not be reused
+                    glm::GlmString geometryStamps = getCharacterGeometryStamps(character, dirmapRules);
+                    usedGeometryStamps += geometryStamps;
 
-                    // add all assets
-                    meshAssets.resize(character->_meshAssets.size());
-                    for (int iMeshAsset = 0, meshAssetCount = character->_meshAssets.sizeInt(); iMeshAsset < meshAssetCount; ++iMeshAsset)
+                    std::string templateFile;
+                    uint64_t templateFileKey = 0;
+                    if (!cacheRootDir.empty())
                     {
-                        meshAssets[iMeshAsset] = iMeshAsset;
+                        templateFileKey = DiskGeometryCache::hash(&iChar, sizeof(iChar), templateFileKeyPrefix);
+                        templateFileKey = DiskGeometryCache::hash(geometryStamps.c_str(), templateFileKey);
+                        templateFile = TfStringPrintf("%s/templates/%016llx.glmtpl", TfStringTrimRight(cacheRootDir, "/\\").c_str(), (unsigned long long)templateFileKey);
                     }
-                    inputGeoData._assets = &meshAssets;
 
-                    auto& characterTemplateData = _skinMeshTemplateDataPerCharPerLod[iChar];
-                    glm::crowdio::OutputEntityGeoData outputData; // TODO: see if storage is better
-                    glm::crowdio::GlmGeometryGenerationStatus geoStatus = glm::crowdio::glmPrepareEntityGeometry(&inputGeoData, &outputData);
-                    if (geoStatus == glm::crowdio::GIO_SUCCESS)
+                    _skinMeshTemplateDataPerChar[iChar] = SkinMeshTemplateCache::acquire(templateKeyPrefix + glm::toString(iChar) + "\n" + geometryStamps, templateFile, templateFileKey, [&](SkinMeshCharacterTemplateData& characterTemplateData)
                     {
-                        _ComputeSkinMeshTemplateData(characterTemplateData, inputGeoData, outputData);
-                    }
+                        glm::crowdio::InputEntityGeoData inputGeoData;
+                        inputGeoData._fbxStorage = &getFbxStorage();
+                        inputGeoData._fbxBaker = &getFbxBaker();
+                        inputGeoData._geometryTag = _params.glmGeometryTag;
+                        inputGeoData._enableLOD = _params.glmLodMode != 0 ? 1 : 0;
+
+                        inputGeoData._dirMapRules = dirmapRules;
+                        inputGeoData._entityId = -1;
+                        inputGeoData._simuData = NULL;
+                        inputGeoData._entityToBakeIndex = -1;
+                        inputGeoData._character = character;
+                        inputGeoData._characterIdx = iChar;
+
+                        // add all assets
+                        meshAssets.resize(character->_meshAssets.size());
+                        for (int iMeshAsset = 0, meshAssetCount = character->_meshAssets.sizeInt(); iMeshAsset < meshAssetCount; ++iMeshAsset)
+                        {
+                            meshAssets[iMeshAsset] = iMeshAsset;
+                        }
+                        inputGeoData._assets = &meshAssets;
+
+                        glm::crowdio::OutputEntityGeoData outputData; // TODO: see if storage is better
+                        if (_source->prepareEntityGeometry(&inputGeoData, &outputData))
+                        {
+                            _ComputeSkinMeshTemplateData(characterTemplateData, inputGeoData, outputData);
+                        }
+                    });
                 }
             }
             else if (displayMode == GolaemDisplayMode::BOUNDING_BOX)
             {
                 _params.glmLodMode = 0; // no lod in bounding box mode
-                _skinMeshTemplateDataPerCharPerLod.resize(1);
-                auto& characterTemplateData = _skinMeshTemplateDataPerCharPerLod[0];
-                characterTemplateData.resize(1);
-                auto& lodTemplateData = characterTemplateData[0];
+                std::shared_ptr<SkinMeshCharacterTemplateData> characterTemplateData = std::make_shared<SkinMeshCharacterTemplateData>();
+                _skinMeshTemplateDataPerChar.push_back(characterTemplateData);
+                characterTemplateData->resize(1);
+                auto& lodTemplateData = (*characterTemplateData)[0];
                 SkinMeshTemplateData& templateData = lodTemplateData[{0, 0}];
-                templateData.faceVertexCounts.resize(6);
-                for (size_t iFace = 0; iFace < 6; ++iFace)
+                size_t proxyPointsCount = 0;
+                if (_source->getProxyMeshTopology(templateData.faceVertexCounts, templateData.faceVertexIndices, proxyPointsCount))
                 {
-                    templateData.faceVertexCounts[iFace] = 4;
+                    templateData.pointsCount = (int)proxyPointsCount;
+                    _hasProxyMesh = true;
+                }
+                else
+                {
+                    templateData.faceVertexCounts.resize(6);
+                    for (size_t iFace = 0; iFace < 6; ++iFace)
+                    {
+                        templateData.faceVertexCounts[iFace] = 4;
+                    }
+
+                    // face 0
+                    templateData.faceVertexIndices.push_back(0);
+                    templateData.faceVertexIndices.push_back(1);
+                    templateData.faceVertexIndices.push_back(2);
+                    templateData.faceVertexIndices.push_back(3);
+
+                    // face 1
+                    templateData.faceVertexIndices.push_back(1);
+                    templateData.faceVertexIndices.push_back(5);
+                    templateData.faceVertexIndices.push_back(6);
+                    templateData.faceVertexIndices.push_back(2);
+
+                    // face 2
+                    templateData.faceVertexIndices.push_back(2);
+                    templateData.faceVertexIndices.push_back(6);
+                    templateData.faceVertexIndices.push_back(7);
+                    templateData.faceVertexIndices.push_back(3);
+
+                    // face 3
+                    templateData.faceVertexIndices.push_back(3);
+                    templateData.faceVertexIndices.push_back(7);
+                    templateData.faceVertexIndices.push_back(4);
+                    templateData.faceVertexIndices.push_back(0);
+
+                    // face 4
+                    templateData.faceVertexIndices.push_back(0);
+                    templateData.faceVertexIndices.push_back(4);
+                    templateData.faceVertexIndices.push_back(5);
+                    templateData.faceVertexIndices.push_back(1);
+
+                    // face 5
+                    templateData.faceVertexIndices.push_back(4);
+                    templateData.faceVertexIndices.push_back(7);
+                    templateData.faceVertexIndices.push_back(6);
+                    templateData.faceVertexIndices.push_back(5);
                 }
-
-                // face 0
-                templateData.faceVertexIndices.push_back(0);
-                templateData.faceVertexIndices.push_back(1);
-                templateData.faceVertexIndices.push_back(2);
-                templateData.faceVertexIndices.push_back(3);
-
-                // face 1
-                templateData.faceVertexIndices.push_back(1);
-                templateData.faceVertexIndices.push_back(5);
-                templateData.faceVertexIndices.push_back(6);
-                templateData.faceVertexIndices.push_back(2);
-
-                // face 2
-                templateData.faceVertexIndices.push_back(2);
-                templateData.faceVertexIndices.push_back(6);
-                templateData.faceVertexIndices.push_back(7);
-                templateData.faceVertexIndices.push_back(3);
-
-                // face 3
-                templateData.faceVertexIndices.push_back(3);
-                templateData.faceVertexIndices.push_back(7);
-                templateData.faceVertexIndices.push_back(4);
-                templateData.faceVertexIndices.push_back(0);
-
-                // face 4
-                templateData.faceVertexIndices.push_back(0);
-                templateData.faceVertexIndices.push_back(4);
-                templateData.faceVertexIndices.push_back(5);
-                templateData.faceVertexIndices.push_back(1);
-
-                // face 5
-                templateData.faceVertexIndices.push_back(4);
-                templateData.faceVertexIndices.push_back(7);
-                templateData.faceVertexIndices.push_back(6);
-                templateData.faceVertexIndices.push_back(5);
             }
 
             TfToken skelAnimName("SkelAnim");
@@ -1828,9 +2936,10 @@ namespace glm
             GlmString lodVariantSetName = "LevelOfDetail";
             GlmString lodName;
             glm::Array<glm::GlmString> entityMeshNames;
+            NameFilter ppAttrFilter(_params.glmPPAttributeFilter.GetString());
             SdfPath animationsGroupPath;
             std::vector<TfToken>* animationsChildNames = NULL;
-            _cachedSimulationLocks.resize(crowdFieldNames.size(), nullptr);
+            glm::PODArray<SkinMeshEntityData*> staticLodEntities;
             for (size_t iCf = 0, cfCount = crowdFieldNames.size(); iCf < cfCount; ++iCf)
             {
                 const glm::GlmString& glmCfName = crowdFieldNames[iCf];
@@ -1839,6 +2948,7 @@ namespace glm
                     continue;
                 }
 
+                GLMUSD_ZONE("InitFromParams::CrowdFieldEntities");
                 TfToken cfName(TfMakeValidIdentifier(glmCfName.c_str()));
 
                 SdfPath cfPath = _GetRootPrimPath().AppendChild(cfName);
@@ -1846,7 +2956,7 @@ namespace glm
                 rootChildNames.push_back(cfName);
                 std::vector<TfToken>& cfChildNames = _primChildNames[cfPath];
 
-                if (displayMode == GolaemDisplayMode::SKELETON)
+                if (displayMode == GolaemDisplayMode::SKELETON && !entityPayloads)
                 {
                     animationsGroupPath = cfPath.AppendChild(animationsGroupName);
                     _primSpecPaths.insert(animationsGroupPath);
@@ -1854,20 +2964,63 @@ namespace glm
                     animationsChildNames = &_primChildNames[animationsGroupPath];
                 }
 
-                glm::crowdio::CachedSimulation& cachedSimulation = _factory->getCachedSimulation(cacheDir.c_str(), cacheName.c_str(), glmCfName.c_str());
+                CrowdFieldSource* crowdFieldSource = _source->getCrowdField(cacheDir, cacheName, glmCfName);
 
                 int firstFrameInCache, lastFrameInCache;
-                cachedSimulation.getSrcFrameRangeAvailableOnDisk(firstFrameInCache, lastFrameInCache);
+                const glm::crowdio::GlmSimulationData* simuData = NULL;
+                {
+                    glm::ScopedLock<TraceMutex> cachedSimuLock(crowdFieldSource->getLock());
+                    crowdFieldSource->getFrameRange(firstFrameInCache, lastFrameInCache);
+                    simuData = crowdFieldSource->getSimulationData();
+                }
 
                 _startFrame = min(_startFrame, firstFrameInCache);
                 _endFrame = max(_endFrame, lastFrameInCache);
 
-                const glm::crowdio::GlmSimulationData* simuData = cachedSimulation.getFinalSimulationData();
                 if (simuData == NULL)
                 {
                     continue;
                 }
 
+                // the entities read the first frame while they are initialized
+                CrowdFieldSource::FramePin framePin(crowdFieldSource, firstFrameInCache);
+                glm::ScopedLock<TraceMutex> cachedSimuLock(crowdFieldSource->getLock());
+
+                // pp attribute names, shared by all the entities of the crowd field
+                PPAttrTable& ppAttrTable = _ppAttrTables[cfPath];
+                for (uint8_t iFloatPPAttr = 0; iFloatPPAttr < simuData->_ppFloatAttributeCount; ++iFloatPPAttr)
+                {
+                    if (ppAttrFilter.isIncluded(simuData->_ppFloatAttributeNames[iFloatPPAttr]))
+                    {
+                        ppAttrTable.floatAttrs.push_back(iFloatPPAttr);
+                    }
+                }
+                for (uint8_t iVectPPAttr = 0; iVectPPAttr < simuData->_ppVectorAttributeCount; ++iVectPPAttr)
+                {
+                    if (ppAttrFilter.isIncluded(simuData->_ppVectorAttributeNames[iVectPPAttr]))
+                    {
+                        ppAttrTable.vectorAttrs.push_back(iVectPPAttr);
+                    }
+                }
+                for (size_t iPPAttr = 0, ppAttrCount = ppAttrTable.floatAttrs.size() + ppAttrTable.vectorAttrs.size(); iPPAttr < ppAttrCount; ++iPPAttr)
+                {
+                    bool isFloatAttr = iPPAttr < ppAttrTable.floatAttrs.size();
+                    GlmString attrName = TfMakeValidIdentifier(isFloatAttr ? simuData->_ppFloatAttributeNames[ppAttrTable.floatAttrs[iPPAttr]] : simuData->_ppVectorAttributeNames[ppAttrTable.vectorAttrs[iPPAttr - ppAttrTable.floatAttrs.size()]]);
+                    if (!attributeNamespace.empty())
+                    {
+                        attrName = attributeNamespace + ":" + attrName;
+                    }
+                    ppAttrTable.indexes[TfToken(attrName.c_str())] = iPPAttr;
+                }
+
+                CrowdFieldAttrData* cfAttrData = NULL;
+                if (_params.glmCrowdFieldAttributes && !entityPayloads)
+                {
+                    cfAttrData = &_crowdFieldAttrDataMap[cfPath];
+                    cfAttrData->computeLock = new TraceMutex(GLMUSD_MUTEX_DESC("CrowdFieldAttrData::computeLock"));
+                    cfAttrData->crowdFieldSource = crowdFieldSource;
+                }
+
                 if (_fps < 0)
                 {
                     _fps = simuData->_framerate;
@@ -1879,28 +3032,40 @@ namespace glm
                 }
 
                 // compute assets if needed
-                const glm::Array<glm::PODArray<int>>& entityAssets = cachedSimulation.getFinalEntityAssets(firstFrameInCache);
-                const glm::ShaderAssetDataContainer* shaderDataContainer = cachedSimulation.getFinalShaderData(firstFrameInCache, UINT32_MAX, true);
-
-                // create lock for cached simulation
-                glm::Mutex* cachedSimulationLock = new glm::Mutex();
-                _cachedSimulationLocks[iCf] = cachedSimulationLock;
+                const glm::Array<glm::PODArray<int>>& entityAssets = crowdFieldSource->getEntityAssets(firstFrameInCache);
 
-                size_t maxEntities = (size_t)floorf(simuData->_entityCount * renderPercent);
+                const glm::PODArray<bool>& isEntitySelected = isEntitySelectedPerCf[iCf];
                 for (uint32_t iEntity = 0; iEntity < simuData->_entityCount; ++iEntity)
                 {
-                    int64_t entityId = simuData->_entityIds[iEntity];
-                    if (entityId < 0)
+                    if (!isEntitySelected[iEntity])
                     {
-                        // entity was probably killed
+                        // killed entity, or not selected: not materialized
                         continue;
                     }
+                    int64_t entityId = simuData->_entityIds[iEntity];
 
                     glm::GlmString entityName = "Entity_" + glm::toString(entityId);
                     TfToken entityNameToken = TfToken(entityName.c_str());
-                    SdfPath entityPath = cfPath.AppendChild(entityNameToken);
+                    SdfPath entityParentPath = cfPath;
+                    if (groupBy != GolaemGroupBy::NONE)
+                    {
+                        const TfToken& groupName = getEntityGroup(simuData, iEntity).name;
+                        entityParentPath = cfPath.AppendChild(groupName);
+                        if (_primSpecPaths.insert(entityParentPath).second)
+                        {
+                            cfChildNames.push_back(groupName);
+                        }
+                    }
+                    SdfPath entityPath = entityParentPath.AppendChild(entityNameToken);
                     _primSpecPaths.insert(entityPath);
-                    cfChildNames.push_back(entityNameToken);
+                    _primChildNames[entityParentPath].push_back(entityNameToken);
+
+                    if (entityPayloads)
+                    {
+                        // no entity data: the entity is computed by the payload layer once loaded
+                        _entityPayloadIds[entityPath] = entityId;
+                        continue;
+                    }
 
                     EntityData* entityData = NULL;
                     SkinMeshEntityData* skinMeshEntityData = NULL;
@@ -1931,27 +3096,25 @@ namespace glm
                     entityData->inputGeoData._frames.resize(1);
                     entityData->inputGeoData._frames[0] = firstFrameInCache;
                     entityData->inputGeoData._frameDatas.resize(1);
-                    entityData->inputGeoData._frameDatas[0] = cachedSimulation.getFinalFrameData(firstFrameInCache, UINT32_MAX, true);
+                    entityData->inputGeoData._frameDatas[0] = crowdFieldSource->getFrameData(firstFrameInCache);
 
                     entityData->computedTimeSample = firstFrameInCache - 1; // ensure there will be a compute in QueryTimeSample
 
-                    entityData->cachedSimulationLock = cachedSimulationLock;
-
-                    entityData->floatPPAttrValues.resize(simuData->_ppFloatAttributeCount, 0);
-                    entityData->vectorPPAttrValues.resize(simuData->_ppVectorAttributeCount, GfVec3f(0));
+                    entityData->ppAttrIndexes = &_emptyAttrIndexes;
+                    entityData->shaderAttrIndexes = &_emptyAttrIndexes;
+                    if (cfAttrData == NULL)
+                    {
+                        entityData->ppAttrTable = &ppAttrTable;
+                        entityData->floatPPAttrValues.resize(ppAttrTable.floatAttrs.size(), 0);
+                        entityData->vectorPPAttrValues.resize(ppAttrTable.vectorAttrs.size(), GfVec3f(0));
+                    }
 
-                    entityData->cachedSimulation = &cachedSimulation;
+                    entityData->crowdFieldSource = crowdFieldSource;
 
-                    entityData->excluded = iEntity >= maxEntities;
                     entityData->entityPath = entityPath;
 
-                    if (entityData->excluded)
-                    {
-                        continue;
-                    }
-
                     int32_t characterIdx = simuData->_characterIdx[iEntity];
-                    const glm::GolaemCharacter* character = _factory->getGolaemCharacter(characterIdx);
+                    const glm::GolaemCharacter* character = _source->getCharacter(characterIdx);
                     if (character == NULL)
                     {
                         GLM_CROWD_TRACE_ERROR_LIMIT("The entity '" << entityId << "' has an invalid character index: '" << characterIdx << "'. Skipping it. Please assign a Rendering Type from the Rendering Attributes panel");
@@ -1959,55 +3122,21 @@ namespace glm
                         continue;
                     }
 
-                    entityData->intShaderAttrValues.resize(shaderDataContainer->specificShaderAttrCountersPerChar[characterIdx][glm::ShaderAttributeType::INT], 0);
-                    entityData->floatShaderAttrValues.resize(shaderDataContainer->specificShaderAttrCountersPerChar[characterIdx][glm::ShaderAttributeType::FLOAT], 0);
-                    entityData->stringShaderAttrValues.resize(shaderDataContainer->specificShaderAttrCountersPerChar[characterIdx][glm::ShaderAttributeType::STRING]);
-                    entityData->vectorShaderAttrValues.resize(shaderDataContainer->specificShaderAttrCountersPerChar[characterIdx][glm::ShaderAttributeType::VECTOR], GfVec3f(0));
-
-                    // add pp attributes
-                    size_t ppAttrIdx = 0;
-                    for (uint8_t iFloatPPAttr = 0; iFloatPPAttr < simuData->_ppFloatAttributeCount; ++iFloatPPAttr, ++ppAttrIdx)
+                    if (cfAttrData != NULL)
                     {
-                        GlmString attrName = TfMakeValidIdentifier(simuData->_ppFloatAttributeNames[iFloatPPAttr]);
-                        if (!attributeNamespace.empty())
-                        {
-                            attrName = attributeNamespace + ":" + attrName;
-                        }
-                        TfToken attrNameToken(attrName.c_str());
-                        entityData->ppAttrIndexes[attrNameToken] = ppAttrIdx;
+                        // the pp and shader attributes are published on the crowd field prim
+                        cfAttrData->entityIndices.push_back(iEntity);
                     }
-                    for (uint8_t iVectPPAttr = 0; iVectPPAttr < simuData->_ppVectorAttributeCount; ++iVectPPAttr, ++ppAttrIdx)
+                    else
                     {
-                        GlmString attrName = TfMakeValidIdentifier(simuData->_ppVectorAttributeNames[iVectPPAttr]);
-                        if (!attributeNamespace.empty())
-                        {
-                            attrName = attributeNamespace + ":" + attrName;
-                        }
-                        TfToken attrNameToken(attrName.c_str());
-                        entityData->ppAttrIndexes[attrNameToken] = ppAttrIdx;
-                    }
+                        const CharacterShaderAttrs& characterShaderAttrs = _shaderAttrsPerChar[characterIdx];
+                        entityData->intShaderAttrValues.resize(characterShaderAttrs.valueCounts[glm::ShaderAttributeType::INT], 0);
+                        entityData->floatShaderAttrValues.resize(characterShaderAttrs.valueCounts[glm::ShaderAttributeType::FLOAT], 0);
+                        entityData->stringShaderAttrValues.resize(characterShaderAttrs.valueCounts[glm::ShaderAttributeType::STRING]);
+                        entityData->vectorShaderAttrValues.resize(characterShaderAttrs.valueCounts[glm::ShaderAttributeType::VECTOR], GfVec3f(0));
 
-                    // add shader attributes
-                    glm::GlmString attrName, subAttrName;
-                    glm::crowdio::RendererAttributeType::Value overrideType(glm::crowdio::RendererAttributeType::END);
-                    for (size_t iShAttr = 0, shAttrCount = character->_shaderAttributes.size(); iShAttr < shAttrCount; ++iShAttr)
-                    {
-                        const glm::ShaderAttribute& shAttr = character->_shaderAttributes[iShAttr];
-                        attrName = shAttr._name.c_str();
-                        if (glm::crowdio::parseRendererAttribute("arnold", shAttr._name, attrName, subAttrName, overrideType))
-                        {
-                            attrName = "arnold:" + PXR_NS::TfMakeValidIdentifier(attrName.c_str());
-                        }
-                        else
-                        {
-                            attrName = PXR_NS::TfMakeValidIdentifier(attrName.c_str());
-                        }
-                        if (!attributeNamespace.empty())
-                        {
-                            attrName = attributeNamespace + ":" + attrName;
-                        }
-                        TfToken attrNameToken(attrName.c_str());
-                        entityData->shaderAttrIndexes[attrNameToken] = iShAttr;
+                        entityData->ppAttrIndexes = &ppAttrTable.indexes;
+                        entityData->shaderAttrIndexes = &characterShaderAttrs.indexes;
                     }
 
                     entityData->inputGeoData._character = character;
@@ -2143,7 +3272,7 @@ namespace glm
                     }
                     else if (displayMode == GolaemDisplayMode::SKINMESH)
                     {
-                        auto& characterTemplateData = _skinMeshTemplateDataPerCharPerLod[skinMeshEntityData->inputGeoData._characterIdx];
+                        const SkinMeshCharacterTemplateData& characterTemplateData = *_skinMeshTemplateDataPerChar[skinMeshEntityData->inputGeoData._characterIdx];
 
                         glm::PODArray<int> gchaMeshIds;
                         glm::PODArray<int> meshAssetMaterialIndices;
@@ -2195,27 +3324,115 @@ namespace glm
 
                             if (_params.glmLodMode == 1)
                             {
-                                // force the first computation in static lod to get accurate lod activation
-                                // use _DoComputeSkinMeshEntity to avoid locks (_InitSimulation can be called from QueryTimeSample)
-                                skinMeshEntityData->computedTimeSample = _startFrame;
-                                _DoComputeSkinMeshEntity(skinMeshEntityData);
+                                // computed once the first frame of the crowd field is released
+                                staticLodEntities.push_back(skinMeshEntityData);
+                            }
+                        }
+                    }
+                }
+
+                if (cfAttrData != NULL)
+                {
+                    _InitCrowdFieldAttributes(*cfAttrData, simuData, ppAttrTable);
+                }
+            }
+
+            for (SkinMeshEntityData* skinMeshEntityData : staticLodEntities)
+            {
+                // force the first computation in static lod to get accurate lod activation
+                // use _DoComputeSkinMeshEntity to avoid locks (_InitSimulation can be called from QueryTimeSample)
+                skinMeshEntityData->computedTimeSample = _startFrame;
+                _DoComputeSkinMeshEntity(skinMeshEntityData);
+
+                // only conpute lod the first time when _params.glmLodMode == 1, keep the computed lod afterwards
+                skinMeshEntityData->inputGeoData._enableLOD = false;
+
+                // keep the same geoFileIndex
+                skinMeshEntityData->inputGeoData._geoFileIndex = (int)skinMeshEntityData->geometryFileIdx;
+            }
+
+            if (_startFrame <= _endFrame)
+            {
+                for (double currentFrame = _startFrame; currentFrame <= _endFrame; ++currentFrame)
+                {
+                    _animTimeSampleTimes.insert(currentFrame);
+                }
+            }
+
+            _dependencyFiles = dependencyFiles;
+            _InitGeometryCaches(dependencyFiles, usedGeometryStamps);
+        }
+
+        //-----------------------------------------------------------------------------
+        void GolaemUSD_DataImpl::_InitGeometryCaches(const glm::Array<glm::GlmString>& dependencyFiles, const glm::GlmString& geometryStamps)
+        {
+            const std::string& cacheRootDir = TfGetEnvSetting(GLMUSD_DISK_CACHE_DIR);
+            int sharedCacheSizeMb = TfGetEnvSetting(GLMUSD_SHM_CACHE_SIZE_MB);
+            if ((cacheRootDir.empty() && sharedCacheSizeMb <= 0) || _params.glmDisplayMode != GolaemDisplayMode::SKINMESH)
+            {
+                return;
+            }
+            if (_params.glmLodMode == 2)
+            {
+                // the camera position can be connected to an animated attribute, the geometry does not only depend on the params
+                GLM_CROWD_TRACE_WARNING("The geometry caches are not available in dynamic lod mode");
+                return;
+            }
 
-                                // only conpute lod the first time when _params.glmLodMode == 1, keep the computed lod afterwards
-                                entityData->inputGeoData._enableLOD = false;
+            size_t entityCount = 0;
+            for (const auto& itEntity : _skinMeshEntityDataMap)
+            {
+                if (!itEntity.second.excluded)
+                {
+                    ++entityCount;
+                }
+            }
+            if (entityCount == 0)
+            {
+                return;
+            }
 
-                                // keep the same geoFileIndex
-                                entityData->inputGeoData._geoFileIndex = (int)skinMeshEntityData->geometryFileIdx;
-                            }
-                        }
-                    }
+            // the key changes with the plugin version, the params and the input files
+            // view params which do not change the deformed geometry (materials, attribute namespace) are not part of it
+            SdfFileFormat::FileFormatArguments geometryArgs = _params.ToIdentityArgs();
+            SdfFileFormat::FileFormatArguments allArgs = _params.ToArgs();
+            for (const TfToken& geometryParam : {GolaemUSD_DataParamsTokens->glmRenderPercent, GolaemUSD_DataParamsTokens->glmRenderPercentMode, GolaemUSD_DataParamsTokens->glmEntitySelection, GolaemUSD_DataParamsTokens->glmShardIndex, GolaemUSD_DataParamsTokens->glmShardCount, GolaemUSD_DataParamsTokens->glmGroupBy, GolaemUSD_DataParamsTokens->glmGroupFilter, GolaemUSD_DataParamsTokens->glmDisplayMode, GolaemUSD_DataParamsTokens->glmGeometryTag, GolaemUSD_DataParamsTokens->glmLodMode, GolaemUSD_DataParamsTokens->glmCameraPos})
+            {
+                geometryArgs[geometryParam] = allArgs[geometryParam];
+            }
+            uint64_t key = DiskGeometryCache::hash(usdplugin::getProductInformation().getCString());
+            for (const auto& itArg : geometryArgs)
+            {
+                key = DiskGeometryCache::hash(itArg.first, key);
+                key = DiskGeometryCache::hash(itArg.second, key);
+            }
+            for (const glm::GlmString& dependencyFile : dependencyFiles)
+            {
+                if (dependencyFile.empty())
+                {
+                    continue;
                 }
+                double modificationTime = 0;
+                ArchGetModificationTime(dependencyFile.c_str(), &modificationTime);
+                int64_t fileSize = ArchGetFileLength(dependencyFile.c_str());
+                key = DiskGeometryCache::hash(dependencyFile.c_str(), key);
+                key = DiskGeometryCache::hash(&modificationTime, sizeof(modificationTime), key);
+                key = DiskGeometryCache::hash(&fileSize, sizeof(fileSize), key);
             }
+            // the deformed geometry also changes when the fbx or gcg files of the characters are exported again
+            key = DiskGeometryCache::hash(geometryStamps.c_str(), key);
 
-            if (_startFrame <= _endFrame)
+            if (!cacheRootDir.empty())
             {
-                for (double currentFrame = _startFrame; currentFrame <= _endFrame; ++currentFrame)
+                _diskGeometryCache = new DiskGeometryCache(cacheRootDir, key, entityCount);
+                TF_DEBUG(GLMUSD_PERF).Msg("[GolaemUSD] Disk geometry cache of '%s': %s\n", _params.glmProceduralFile.GetText(), _diskGeometryCache->getDirectory().c_str());
+            }
+            if (sharedCacheSizeMb > 0)
+            {
+                _sharedGeometryCache = SharedGeometryCache::open(key, (size_t)sharedCacheSizeMb << 20);
+                if (_sharedGeometryCache != NULL)
                 {
-                    _animTimeSampleTimes.insert(currentFrame);
+                    TF_DEBUG(GLMUSD_PERF).Msg("[GolaemUSD] Shared memory geometry cache of '%s': %s\n", _params.glmProceduralFile.GetText(), _sharedGeometryCache->getName().c_str());
                 }
             }
         }
@@ -2248,8 +3465,10 @@ namespace glm
                 meshDataArray.push_back(&meshData);
                 meshData.meshPath = lastMeshTransformPath;
                 meshData.templateData = &meshTemplateData;
+                meshData.materialPath = _GetMaterialPath(entityData->inputGeoData._characterIdx, meshTemplateData.shadingGroupIdx);
                 meshData.points.resize(meshTemplateData.pointsCount);
                 meshData.normals.resize(meshTemplateData.faceVertexIndices.size());
+                GLMUSD_ALLOC(&meshData, (meshData.points.size() + meshData.normals.size()) * sizeof(GfVec3f), "DeformedGeometry");
             }
         }
 
@@ -2267,6 +3486,10 @@ namespace glm
             {
                 return false;
             }
+            if (const CrowdFieldAttrData::Attribute* cfAttribute = _FindCrowdFieldAttribute(path))
+            {
+                return cfAttribute->kind != CrowdFieldAttrData::AttrKind::ENTITY_ID;
+            }
 
             if (_params.glmDisplayMode == GolaemDisplayMode::SKELETON)
             {
@@ -2295,8 +3518,8 @@ namespace glm
                 }
                 if (const SkelEntityData* entityData = TfMapLookupPtr(_skelEntityDataMap, primPath))
                 {
-                    if (TfMapLookupPtr(entityData->ppAttrIndexes, nameToken) != NULL ||
-                        TfMapLookupPtr(entityData->shaderAttrIndexes, nameToken) != NULL)
+                    if (TfMapLookupPtr(*entityData->ppAttrIndexes, nameToken) != NULL ||
+                        TfMapLookupPtr(*entityData->shaderAttrIndexes, nameToken) != NULL)
                     {
                         return true;
                     }
@@ -2328,8 +3551,8 @@ namespace glm
                 }
                 if (const SkinMeshEntityData* entityData = TfMapLookupPtr(_skinMeshEntityDataMap, primPath))
                 {
-                    if (TfMapLookupPtr(entityData->ppAttrIndexes, nameToken) != NULL ||
-                        TfMapLookupPtr(entityData->shaderAttrIndexes, nameToken) != NULL)
+                    if (TfMapLookupPtr(*entityData->ppAttrIndexes, nameToken) != NULL ||
+                        TfMapLookupPtr(*entityData->shaderAttrIndexes, nameToken) != NULL)
                     {
                         return true;
                     }
@@ -2358,10 +3581,30 @@ namespace glm
                 {
                     if (value)
                     {
-                        *value = *usdValue;
+                        std::shared_ptr<UsdWrapper> usdWrapper = std::atomic_load(&_activeUsdWrapper);
+                        if (usdWrapper != NULL)
+                        {
+                            // the values can be modified by the stage notices
+                            glm::ScopedLock<TraceMutex> updateLock(usdWrapper->_updateLock);
+                            *value = usdWrapper->_usdParams.find(nameToken)->second;
+                        }
+                        else
+                        {
+                            *value = *usdValue;
+                        }
                     }
                     return true;
                 }
+                return _HasRootStatsValue(nameToken, value);
+            }
+            if (const CrowdFieldAttrData::Attribute* cfAttribute = _FindCrowdFieldAttribute(path))
+            {
+                if (cfAttribute->kind == CrowdFieldAttrData::AttrKind::ENTITY_ID)
+                {
+                    RETURN_TRUE_WITH_OPTIONAL_VALUE(cfAttribute->values);
+                }
+                // the animated arrays have no default value
+                return false;
             }
 
             // Check that it belongs to a leaf prim before getting the default value
@@ -2421,7 +3664,7 @@ namespace glm
                 }
                 if (const SkelEntityData* entityData = TfMapLookupPtr(_skelEntityDataMap, primPath))
                 {
-                    if (const size_t* ppAttrIdx = TfMapLookupPtr(entityData->ppAttrIndexes, nameToken))
+                    if (const size_t* ppAttrIdx = TfMapLookupPtr(*entityData->ppAttrIndexes, nameToken))
                     {
                         if (value)
                         {
@@ -2440,7 +3683,7 @@ namespace glm
                         }
                         return true;
                     }
-                    if (const size_t* shaderAttrIdx = TfMapLookupPtr(entityData->shaderAttrIndexes, nameToken))
+                    if (const size_t* shaderAttrIdx = TfMapLookupPtr(*entityData->shaderAttrIndexes, nameToken))
                     {
                         if (value)
                         {
@@ -2540,7 +3783,7 @@ namespace glm
                 }
                 if (const SkinMeshEntityData* entityData = TfMapLookupPtr(_skinMeshEntityDataMap, primPath))
                 {
-                    if (const size_t* ppAttrIdx = TfMapLookupPtr(entityData->ppAttrIndexes, nameToken))
+                    if (const size_t* ppAttrIdx = TfMapLookupPtr(*entityData->ppAttrIndexes, nameToken))
                     {
                         if (value)
                         {
@@ -2559,7 +3802,7 @@ namespace glm
                         }
                         return true;
                     }
-                    if (const size_t* shaderAttrIdx = TfMapLookupPtr(entityData->shaderAttrIndexes, nameToken))
+                    if (const size_t* shaderAttrIdx = TfMapLookupPtr(*entityData->shaderAttrIndexes, nameToken))
                     {
                         if (value)
                         {
@@ -2623,7 +3866,7 @@ namespace glm
                         {
                             if (nameToken == _skinMeshRelationshipTokens->materialBinding)
                             {
-                                *value = VtValue(meshData->templateData->materialPath);
+                                *value = VtValue(meshData->materialPath != NULL ? *meshData->materialPath : SdfPathListOp());
                             }
                             else
                             {
@@ -2648,6 +3891,12 @@ namespace glm
                 return false;
             }
 
+            if (_FindCrowdFieldAttribute(path) != NULL)
+            {
+                // one value per entity of the crowd field
+                RETURN_TRUE_WITH_OPTIONAL_VALUE(UsdGeomTokens->constant);
+            }
+
             // Check that it is one of our property names.
             const TfToken& nameToken = path.GetNameToken();
             SdfPath primPath = path.GetAbsoluteRootOrPrimPath();
@@ -2697,6 +3946,14 @@ namespace glm
                 {
                     RETURN_TRUE_WITH_OPTIONAL_VALUE(SdfSchema::GetInstance().FindType(*usdValue).GetAsToken());
                 }
+                if (const _RootStatsInfo* statsInfo = TfMapLookupPtr(*_rootStatsAttributes, nameToken))
+                {
+                    RETURN_TRUE_WITH_OPTIONAL_VALUE(statsInfo->typeName);
+                }
+            }
+            if (const CrowdFieldAttrData::Attribute* cfAttribute = _FindCrowdFieldAttribute(path))
+            {
+                RETURN_TRUE_WITH_OPTIONAL_VALUE(cfAttribute->typeName);
             }
 
             if (_params.glmDisplayMode == GolaemDisplayMode::SKELETON)
@@ -2723,7 +3980,7 @@ namespace glm
                 }
                 if (const SkelEntityData* entityData = TfMapLookupPtr(_skelEntityDataMap, primPath))
                 {
-                    if (const size_t* ppAttrIdx = TfMapLookupPtr(entityData->ppAttrIndexes, nameToken))
+                    if (const size_t* ppAttrIdx = TfMapLookupPtr(*entityData->ppAttrIndexes, nameToken))
                     {
                         if (value)
                         {
@@ -2742,7 +3999,7 @@ namespace glm
                         }
                         return true;
                     }
-                    if (const size_t* shaderAttrIdx = TfMapLookupPtr(entityData->shaderAttrIndexes, nameToken))
+                    if (const size_t* shaderAttrIdx = TfMapLookupPtr(*entityData->shaderAttrIndexes, nameToken))
                     {
                         const glm::ShaderAttribute& shaderAttr = entityData->inputGeoData._character->_shaderAttributes[*shaderAttrIdx];
                         RETURN_TRUE_WITH_OPTIONAL_VALUE(TfToken(_shaderAttrTypes[shaderAttr._type].c_str()));
@@ -2783,7 +4040,7 @@ namespace glm
                 }
                 if (const SkinMeshEntityData* entityData = TfMapLookupPtr(_skinMeshEntityDataMap, primPath))
                 {
-                    if (const size_t* ppAttrIdx = TfMapLookupPtr(entityData->ppAttrIndexes, nameToken))
+                    if (const size_t* ppAttrIdx = TfMapLookupPtr(*entityData->ppAttrIndexes, nameToken))
                     {
                         if (value)
                         {
@@ -2802,7 +4059,7 @@ namespace glm
                         }
                         return true;
                     }
-                    if (const size_t* shaderAttrIdx = TfMapLookupPtr(entityData->shaderAttrIndexes, nameToken))
+                    if (const size_t* shaderAttrIdx = TfMapLookupPtr(*entityData->shaderAttrIndexes, nameToken))
                     {
                         const glm::ShaderAttribute& shaderAttr = entityData->inputGeoData._character->_shaderAttributes[*shaderAttrIdx];
                         RETURN_TRUE_WITH_OPTIONAL_VALUE(TfToken(_shaderAttrTypes[shaderAttr._type].c_str()));
@@ -2813,6 +4070,212 @@ namespace glm
             return false;
         }
 
+        //-----------------------------------------------------------------------------
+        bool GolaemUSD_DataImpl::_HasRootStatsValue(const TfToken& nameToken, VtValue* value) const
+        {
+            const _RootStatsInfo* statsInfo = TfMapLookupPtr(*_rootStatsAttributes, nameToken);
+            if (statsInfo == NULL)
+            {
+                return false;
+            }
+            if (value == NULL)
+            {
+                return true;
+            }
+            switch (statsInfo->kind)
+            {
+            case _RootStatsInfo::LAYER_MEMORY:
+            case _RootStatsInfo::PROCESS_MEMORY:
+            {
+                MemoryReport layerReport;
+                MemoryReport processReport;
+                _GetCachedMemoryReports(layerReport, processReport);
+                const MemoryReport& report = statsInfo->kind == _RootStatsInfo::LAYER_MEMORY ? layerReport : processReport;
+                size_t byteCount = statsInfo->index < MemoryCategory::END ? report.bytes[statsInfo->index] : report.getTotal();
+                *value = VtValue(int64_t(byteCount));
+            }
+            break;
+            case _RootStatsInfo::PERF_COUNTER:
+                *value = VtValue(int64_t(_perfCounters.get((PerfCounter::Value)statsInfo->index)));
+                break;
+            case _RootStatsInfo::PERF_CACHE_HIT_RATIO:
+                *value = VtValue(_perfCounters.getCacheHitRatio());
+                break;
+            case _RootStatsInfo::PERF_SLOWEST_QUERY:
+                *value = VtValue(int64_t(_perfCounters.getSlowestQuery()));
+                break;
+            case _RootStatsInfo::PERF_SLOWEST_QUERY_PER_FRAME:
+            {
+                VtInt64Array slowestQueries(_perfCounters.getFrameCount());
+                for (size_t iFrame = 0, frameCount = slowestQueries.size(); iFrame < frameCount; ++iFrame)
+                {
+                    slowestQueries[iFrame] = int64_t(_perfCounters.getSlowestQuery(iFrame));
+                }
+                *value = VtValue(slowestQueries);
+            }
+            break;
+            }
+            return true;
+        }
+
+        //-----------------------------------------------------------------------------
+        void GolaemUSD_DataImpl::_GetCachedMemoryReports(MemoryReport& layerReport, MemoryReport& processReport) const
+        {
+            // the reports lock every entity of every layer: computed again at most once per second
+            static const uint64_t MEMORY_REPORTS_LIFETIME_NS = 1000000000ull;
+
+            glm::ScopedLock<TraceMutex> memoryReportsLock(_memoryReportsLock);
+            uint64_t currentTime = PerfCounters::now();
+            if (_memoryReportsTime == 0 || currentTime - _memoryReportsTime > MEMORY_REPORTS_LIFETIME_NS)
+            {
+                _cachedLayerMemoryReport = MemoryReport();
+                ComputeMemoryReport(_cachedLayerMemoryReport);
+                _cachedProcessMemoryReport = MemoryReport();
+                ComputeProcessMemoryReport(_cachedProcessMemoryReport);
+                _memoryReportsTime = currentTime;
+            }
+            layerReport = _cachedLayerMemoryReport;
+            processReport = _cachedProcessMemoryReport;
+        }
+
+        //-----------------------------------------------------------------------------
+        void GolaemUSD_DataImpl::ComputeMemoryReport(MemoryReport& report) const
+        {
+            GLMUSD_ZONE("ComputeMemoryReport");
+            // node overheads of the std::map / TfHashMap containers (approximate)
+            const size_t mapNodeOverhead = 4 * sizeof(void*);
+            const size_t hashNodeOverhead = 2 * sizeof(void*);
+
+            // skin mesh templates
+            // shared with the other layers using the same characters: reported by each of them
+            for (size_t iChar = 0, charCount = _skinMeshTemplateDataPerChar.size(); iChar < charCount; ++iChar)
+            {
+                const SkinMeshCharacterTemplateData& characterTemplateData = *_skinMeshTemplateDataPerChar[iChar];
+                for (size_t iLod = 0, lodCount = characterTemplateData.size(); iLod < lodCount; ++iLod)
+                {
+                    for (const auto& itMesh : characterTemplateData[iLod])
+                    {
+                        const SkinMeshTemplateData& templateData = itMesh.second;
+                        report.add(MemoryCategory::TEMPLATE_TOPOLOGY, sizeof(itMesh) + mapNodeOverhead + templateData.meshAlias.length());
+                        report.add(MemoryCategory::TEMPLATE_TOPOLOGY, (templateData.faceVertexCounts.size() + templateData.faceVertexIndices.size()) * sizeof(int));
+                        for (size_t iUVSet = 0, uvSetCount = templateData.uvSets.size(); iUVSet < uvSetCount; ++iUVSet)
+                        {
+                            report.add(MemoryCategory::TEMPLATE_UVS, sizeof(VtVec2fArray) + templateData.uvSets[iUVSet].size() * sizeof(GfVec2f));
+                        }
+                    }
+                }
+            }
+
+            // data shared by the skin mesh and skel entities
+            // the arrays of an entity are resized by its computes: they are measured with its compute lock held
+            std::set<const glm::crowdio::GlmSimulationData*> simulationDatas;
+            auto addEntityMemory = [&](const EntityData& entityData)
+            {
+                glm::ScopedLock<TraceMutex> entityComputeLock(*entityData.entityComputeLock);
+                report.add(MemoryCategory::ENTITY_CACHES, entityData.intShaderAttrValues.size() * sizeof(int));
+                report.add(MemoryCategory::ENTITY_CACHES, entityData.floatShaderAttrValues.size() * sizeof(float));
+                report.add(MemoryCategory::ENTITY_CACHES, entityData.stringShaderAttrValues.size() * sizeof(TfToken));
+                report.add(MemoryCategory::ENTITY_CACHES, entityData.vectorShaderAttrValues.size() * sizeof(GfVec3f));
+                report.add(MemoryCategory::ENTITY_CACHES, entityData.floatPPAttrValues.size() * sizeof(float));
+                report.add(MemoryCategory::ENTITY_CACHES, entityData.vectorPPAttrValues.size() * sizeof(GfVec3f));
+                report.add(MemoryCategory::ENTITY_CACHES, entityData.inputGeoData._dirMapRules.size() * sizeof(GlmString));
+                report.add(MemoryCategory::ENTITY_CACHES, sizeof(TraceMutex));
+
+                if (entityData.inputGeoData._simuData != NULL)
+                {
+                    simulationDatas.insert(entityData.inputGeoData._simuData);
+                }
+            };
+
+            for (const auto& itEntity : _skinMeshEntityDataMap)
+            {
+                report.add(MemoryCategory::ENTITY_CACHES, sizeof(itEntity) + hashNodeOverhead);
+                report.add(MemoryCategory::ENTITY_CACHES, (itEntity.second.meshData.size() + itEntity.second.meshLodData.size()) * sizeof(void*));
+                addEntityMemory(itEntity.second);
+            }
+            for (const auto& itEntity : _skelEntityDataMap)
+            {
+                report.add(MemoryCategory::ENTITY_CACHES, sizeof(itEntity) + hashNodeOverhead);
+                report.add(MemoryCategory::ENTITY_CACHES, itEntity.second.geoVariants.size() * (2 * sizeof(std::string) + mapNodeOverhead));
+                addEntityMemory(itEntity.second);
+            }
+
+            // attribute tables, shared by the entities of a crowd field (pp) or of a character (shader)
+            const size_t attrIndexNodeSize = sizeof(std::pair<const TfToken, size_t>) + mapNodeOverhead;
+            for (const auto& itPPAttrTable : _ppAttrTables)
+            {
+                const PPAttrTable& ppAttrTable = itPPAttrTable.second;
+                report.add(MemoryCategory::ATTRIBUTE_INDEXES, sizeof(itPPAttrTable) + hashNodeOverhead + ppAttrTable.indexes.size() * attrIndexNodeSize);
+                report.add(MemoryCategory::ATTRIBUTE_INDEXES, ppAttrTable.floatAttrs.size() + ppAttrTable.vectorAttrs.size());
+            }
+            for (size_t iChar = 0, charCount = _shaderAttrsPerChar.size(); iChar < charCount; ++iChar)
+            {
+                const CharacterShaderAttrs& characterShaderAttrs = _shaderAttrsPerChar[iChar];
+                report.add(MemoryCategory::ATTRIBUTE_INDEXES, characterShaderAttrs.indexes.size() * attrIndexNodeSize + characterShaderAttrs.attributes.size() * sizeof(ShaderAttrInfo));
+            }
+
+            // deformed geometry
+            for (const auto& itMesh : _skinMeshDataMap)
+            {
+                const SkinMeshData& meshData = itMesh.second;
+                const SkinMeshEntityData* entityData = meshData.entityData != NULL ? meshData.entityData : meshData.lodData->entityData;
+                glm::ScopedLock<TraceMutex> entityComputeLock(*entityData->entityComputeLock);
+                report.add(MemoryCategory::PATH_TABLES, sizeof(itMesh) + hashNodeOverhead);
+                report.add(MemoryCategory::DEFORMED_POINTS, meshData.points.size() * sizeof(GfVec3f));
+                report.add(MemoryCategory::DEFORMED_NORMALS, meshData.normals.size() * sizeof(GfVec3f));
+            }
+            for (const auto& itLod : _skinMeshLodDataMap)
+            {
+                report.add(MemoryCategory::PATH_TABLES, sizeof(itLod) + hashNodeOverhead + itLod.second.meshData.size() * sizeof(void*));
+            }
+
+            // skel animations
+            for (const auto& itAnim : _skelAnimDataMap)
+            {
+                const SkelAnimData& animData = itAnim.second;
+                glm::ScopedLock<TraceMutex> entityComputeLock(*animData.entityData->entityComputeLock);
+                report.add(MemoryCategory::SKEL_ANIM, sizeof(itAnim) + hashNodeOverhead);
+                report.add(MemoryCategory::SKEL_ANIM, animData.joints.size() * sizeof(TfToken));
+                report.add(MemoryCategory::SKEL_ANIM, animData.rotations.size() * sizeof(GfQuatf));
+                report.add(MemoryCategory::SKEL_ANIM, animData.scales.size() * sizeof(GfVec3h));
+                report.add(MemoryCategory::SKEL_ANIM, animData.translations.size() * sizeof(GfVec3f));
+            }
+
+            // path and spec tables
+            report.add(MemoryCategory::PATH_TABLES, _primSpecPaths.size() * (sizeof(SdfPath) + hashNodeOverhead));
+            report.add(MemoryCategory::PATH_TABLES, _entityPayloadIds.size() * (sizeof(SdfPath) + sizeof(int64_t) + hashNodeOverhead));
+            for (const auto& itChildNames : _primChildNames)
+            {
+                report.add(MemoryCategory::PATH_TABLES, sizeof(itChildNames) + hashNodeOverhead + itChildNames.second.capacity() * sizeof(TfToken));
+            }
+            report.add(MemoryCategory::PATH_TABLES, _animTimeSampleTimes.size() * (sizeof(double) + mapNodeOverhead));
+
+            // devkit frame data: not directly observable, estimated for one decoded frame of each crowd field
+            for (const glm::crowdio::GlmSimulationData* simuData : simulationDatas)
+            {
+                size_t boneCount = 0;
+                for (uint32_t iEntity = 0; iEntity < simuData->_entityCount; ++iEntity)
+                {
+                    boneCount += simuData->_boneCount[simuData->_entityTypes[iEntity]];
+                }
+                size_t frameBytes = boneCount * (sizeof(float[3]) + sizeof(float[4])); // bone positions and orientations
+                frameBytes += simuData->_entityCount * sizeof(uint8_t);                // entity enabled
+                frameBytes += simuData->_entityCount * (simuData->_ppFloatAttributeCount * sizeof(float) + simuData->_ppVectorAttributeCount * sizeof(float[3]));
+                report.add(MemoryCategory::FRAME_DATA, frameBytes);
+            }
+        }
+
+        /*static*/
+        //-----------------------------------------------------------------------------
+        void GolaemUSD_DataImpl::ComputeProcessMemoryReport(MemoryReport& report)
+        {
+            glm::ScopedLock<glm::Mutex> liveImplsLock(s_liveImplsLock);
+            for (const GolaemUSD_DataImpl* impl : s_liveImpls)
+            {
+                impl->ComputeMemoryReport(report);
+            }
+        }
+
         //-----------------------------------------------------------------------------
         SdfPath GolaemUSD_DataImpl::_CreateHierarchyFor(const glm::GlmString& hierarchy, const SdfPath& parentPath, GlmMap<GlmString, SdfPath>& existingPaths)
         {
@@ -2858,11 +4321,11 @@ namespace glm
         {
             if (glm::approxDiff(entityData->computedTimeSample, frame, static_cast<double>(GLM_NUMERICAL_PRECISION)))
             {
-#ifdef TRACY_ENABLE
-                ZoneScopedNC("ComputeSkelEntity", GLM_COLOR_CACHE);
-#endif
+                GLMUSD_ZONE("ComputeSkelEntity");
+                _perfCounters.add(PerfCounter::ENTITY_COMPUTES, 1);
                 entityData->computedTimeSample = frame;
 
+                CrowdFieldSource::FramePin framePin(entityData->crowdFieldSource, frame);
                 _ComputeEntity(entityData);
                 if (!entityData->enabled)
                 {
@@ -2975,18 +4438,26 @@ namespace glm
                     animData->rotations[iBone] = GfQuatf(boneLOri.w, boneLOri.x, boneLOri.y, boneLOri.z);
                 }
             }
+            else
+            {
+                _perfCounters.add(PerfCounter::ENTITY_CACHE_HITS, 1);
+            }
         }
 
         //-----------------------------------------------------------------------------
         void GolaemUSD_DataImpl::_ComputeEntity(EntityData* entityData)
         {
+            GLMUSD_ZONE("ComputeEntity");
+            // the caller pins the frame of the entity: the frame data is read until the end of its compute
             const glm::crowdio::GlmSimulationData* simuData = entityData->inputGeoData._simuData;
             const glm::crowdio::GlmFrameData* frameData = NULL;
             const glm::ShaderAssetDataContainer* shaderDataContainer = NULL;
             {
-                glm::ScopedLock<glm::Mutex> cachedSimuLock(*entityData->cachedSimulationLock);
-                frameData = entityData->cachedSimulation->getFinalFrameData(entityData->computedTimeSample, UINT32_MAX, true);
-                shaderDataContainer = entityData->cachedSimulation->getFinalShaderData(entityData->computedTimeSample, UINT32_MAX, true);
+                uint64_t lockStart = PerfCounters::now();
+                glm::ScopedLock<TraceMutex> cachedSimuLock(entityData->crowdFieldSource->getLock());
+                _perfCounters.add(PerfCounter::CACHED_SIMULATION_LOCK_WAIT_NS, PerfCounters::now() - lockStart);
+                frameData = entityData->crowdFieldSource->getFrameData(entityData->computedTimeSample);
+                shaderDataContainer = entityData->crowdFieldSource->getShaderData(entityData->computedTimeSample);
             }
             if (simuData == NULL || frameData == NULL)
             {
@@ -3001,54 +4472,65 @@ namespace glm
                 return;
             }
 
-            const glm::PODArray<int>& entityIntShaderData = shaderDataContainer->intData[entityData->inputGeoData._entityIndex];
-            const glm::PODArray<float>& entityFloatShaderData = shaderDataContainer->floatData[entityData->inputGeoData._entityIndex];
-            const glm::Array<glm::Vector3>& entityVectorShaderData = shaderDataContainer->vectorData[entityData->inputGeoData._entityIndex];
-            const glm::Array<glm::GlmString>& entityStringShaderData = shaderDataContainer->stringData[entityData->inputGeoData._entityIndex];
+            // with glmCrowdFieldAttributes the attributes are computed by crowd field (_ComputeCrowdFieldAttributes)
+            if (!_params.glmCrowdFieldAttributes)
+            {
+                const glm::PODArray<int>& entityIntShaderData = shaderDataContainer->intData[entityData->inputGeoData._entityIndex];
+                const glm::PODArray<float>& entityFloatShaderData = shaderDataContainer->floatData[entityData->inputGeoData._entityIndex];
+                const glm::Array<glm::Vector3>& entityVectorShaderData = shaderDataContainer->vectorData[entityData->inputGeoData._entityIndex];
+                const glm::Array<glm::GlmString>& entityStringShaderData = shaderDataContainer->stringData[entityData->inputGeoData._entityIndex];
 
-            const PODArray<size_t>& globalToSpecificShaderAttrIdx = shaderDataContainer->globalToSpecificShaderAttrIdxPerChar[entityData->inputGeoData._characterIdx];
+                const PODArray<size_t>& globalToSpecificShaderAttrIdx = shaderDataContainer->globalToSpecificShaderAttrIdxPerChar[entityData->inputGeoData._characterIdx];
 
-            // compute shader data
-            glm::Vector3 vectValue;
-            for (size_t iShaderAttr = 0, shaderAttrCount = entityData->inputGeoData._character->_shaderAttributes.size(); iShaderAttr < shaderAttrCount; ++iShaderAttr)
-            {
-                const glm::ShaderAttribute& shaderAttribute = entityData->inputGeoData._character->_shaderAttributes[iShaderAttr];
-                size_t specificAttrIdx = globalToSpecificShaderAttrIdx[iShaderAttr];
-                switch (shaderAttribute._type)
+                // compute shader data
+                const glm::Array<ShaderAttrInfo>& shaderAttrInfos = _shaderAttrsPerChar[entityData->inputGeoData._characterIdx].attributes;
+                for (size_t iShaderAttr = 0, shaderAttrCount = shaderAttrInfos.size(); iShaderAttr < shaderAttrCount; ++iShaderAttr)
                 {
-                case glm::ShaderAttributeType::INT:
-                {
-                    entityData->intShaderAttrValues[specificAttrIdx] = entityIntShaderData[specificAttrIdx];
-                }
-                break;
-                case glm::ShaderAttributeType::FLOAT:
-                {
-                    entityData->floatShaderAttrValues[specificAttrIdx] = entityFloatShaderData[specificAttrIdx];
+                    const ShaderAttrInfo& shaderAttrInfo = shaderAttrInfos[iShaderAttr];
+                    size_t specificAttrIdx = globalToSpecificShaderAttrIdx[iShaderAttr];
+                    switch (shaderAttrInfo.type)
+                    {
+                    case glm::ShaderAttributeType::INT:
+                    {
+                        entityData->intShaderAttrValues[shaderAttrInfo.valueIdx] = entityIntShaderData[specificAttrIdx];
+                    }
+                    break;
+                    case glm::ShaderAttributeType::FLOAT:
+                    {
+                        entityData->floatShaderAttrValues[shaderAttrInfo.valueIdx] = entityFloatShaderData[specificAttrIdx];
+                    }
+                    break;
+                    case glm::ShaderAttributeType::STRING:
+                    {
+                        // string values rarely change between frames: only create a token (registry lookup) when it does
+                        TfToken& stringValue = entityData->stringShaderAttrValues[shaderAttrInfo.valueIdx];
+                        const glm::GlmString& newStringValue = entityStringShaderData[specificAttrIdx];
+                        if (strcmp(stringValue.GetText(), newStringValue.c_str()) != 0)
+                        {
+                            stringValue = TfToken(newStringValue.c_str());
+                        }
+                    }
+                    break;
+                    case glm::ShaderAttributeType::VECTOR:
+                    {
+                        entityData->vectorShaderAttrValues[shaderAttrInfo.valueIdx].Set(entityVectorShaderData[specificAttrIdx].getFloatValues());
+                    }
+                    break;
+                    default:
+                        break;
+                    }
                 }
-                break;
-                case glm::ShaderAttributeType::STRING:
+
+                // update pp attributes
+                const PPAttrTable* ppAttrTable = entityData->ppAttrTable;
+                for (size_t iFloatPPAttr = 0, floatPPAttrCount = ppAttrTable->floatAttrs.size(); iFloatPPAttr < floatPPAttrCount; ++iFloatPPAttr)
                 {
-                    entityData->stringShaderAttrValues[specificAttrIdx] = TfToken(entityStringShaderData[specificAttrIdx].c_str());
+                    entityData->floatPPAttrValues[iFloatPPAttr] = frameData->_ppFloatAttributeData[ppAttrTable->floatAttrs[iFloatPPAttr]][entityData->inputGeoData._entityToBakeIndex];
                 }
-                break;
-                case glm::ShaderAttributeType::VECTOR:
+                for (size_t iVectPPAttr = 0, vectPPAttrCount = ppAttrTable->vectorAttrs.size(); iVectPPAttr < vectPPAttrCount; ++iVectPPAttr)
                 {
-                    entityData->vectorShaderAttrValues[specificAttrIdx].Set(entityVectorShaderData[specificAttrIdx].getFloatValues());
+                    entityData->vectorPPAttrValues[iVectPPAttr].Set(frameData->_ppVectorAttributeData[ppAttrTable->vectorAttrs[iVectPPAttr]][entityData->inputGeoData._entityToBakeIndex]);
                 }
-                break;
-                default:
-                    break;
-                }
-            }
-
-            // update pp attributes
-            for (uint8_t iFloatPPAttr = 0; iFloatPPAttr < simuData->_ppFloatAttributeCount; ++iFloatPPAttr)
-            {
-                entityData->floatPPAttrValues[iFloatPPAttr] = frameData->_ppFloatAttributeData[iFloatPPAttr][entityData->inputGeoData._entityToBakeIndex];
-            }
-            for (uint8_t iVectPPAttr = 0; iVectPPAttr < simuData->_ppVectorAttributeCount; ++iVectPPAttr)
-            {
-                entityData->vectorPPAttrValues[iVectPPAttr].Set(frameData->_ppVectorAttributeData[iVectPPAttr][entityData->inputGeoData._entityToBakeIndex]);
             }
 
             // update frame before computing geometry
@@ -3067,32 +4549,58 @@ namespace glm
             // check if computation is needed
             if (glm::approxDiff(entityData->computedTimeSample, frame, static_cast<double>(GLM_NUMERICAL_PRECISION)))
             {
-#ifdef TRACY_ENABLE
-                ZoneScopedNC("ComputeSkinMeshEntity", GLM_COLOR_CACHE);
-#endif
+                GLMUSD_ZONE("ComputeSkinMeshEntity");
+                _perfCounters.add(PerfCounter::ENTITY_COMPUTES, 1);
 
                 entityData->computedTimeSample = frame;
                 _DoComputeSkinMeshEntity(entityData);
             }
+            else
+            {
+                _perfCounters.add(PerfCounter::ENTITY_CACHE_HITS, 1);
+            }
         }
 
         //-----------------------------------------------------------------------------
         void GolaemUSD_DataImpl::_DoComputeSkinMeshEntity(SkinMeshEntityData* entityData)
         {
-            _ComputeEntity(entityData);
+            GolaemDisplayMode::Value displayMode = (GolaemDisplayMode::Value)_params.glmDisplayMode;
+
+            {
+                // the frame is only pinned while its data is read: not during the cache lookups, which can wait for other processes
+                CrowdFieldSource::FramePin framePin(entityData->crowdFieldSource, entityData->computedTimeSample);
+                _ComputeEntity(entityData);
+                if (entityData->enabled && displayMode == GolaemDisplayMode::BOUNDING_BOX && _hasProxyMesh)
+                {
+                    GLMUSD_ZONE("DeformProxyMesh");
+                    for (SkinMeshData* meshData : entityData->meshData)
+                    {
+                        _source->deformProxyMesh(entityData->inputGeoData, entityData->bonePositionOffset, meshData->points, meshData->normals);
+                    }
+                }
+            }
             if (!entityData->enabled)
             {
+                if (_diskGeometryCache != NULL)
+                {
+                    // empty record, only used to know when all the entities of the frame are stored
+                    _diskGeometryCache->storeEntity(entityData->computedTimeSample, entityData->inputGeoData._entityId, 0, glm::PODArray<const VtVec3fArray*>(), glm::PODArray<const VtVec3fArray*>());
+                }
                 return;
             }
 
-            // update entity position
-
-            const glm::crowdio::GlmFrameData* frameData = entityData->inputGeoData._frameDatas[0];
-
-            GolaemDisplayMode::Value displayMode = (GolaemDisplayMode::Value)_params.glmDisplayMode;
-
             if (displayMode == GolaemDisplayMode::SKINMESH)
             {
+                // claimed entity frames are published to the shared cache once computed, abandoned otherwise
+                SharedGeometryCache::Claim sharedCacheClaim;
+                if (_ReadCachedGeometry(entityData, sharedCacheClaim))
+                {
+                    return;
+                }
+
+                GLMUSD_ZONE("Skinning");
+                PerfScopedTimer skinningTimer(_perfCounters, PerfCounter::SKINNING_NS);
+
                 // these variables must be available when glmPrepareEntityGeometry is called below
                 float entityPos[3] = {0, 0, 0};
                 float cameraPos[3] = {0, 0, 0};
@@ -3110,7 +4618,8 @@ namespace glm
                     else if (_params.glmLodMode == 2)
                     {
                         // in dynamic lod mode get the camera pos from the node attributes (it may be connected to another attribute - usdWrapper will do the update)
-                        const VtValue* cameraPosValue = TfMapLookupPtr(_usdParams, _golaemTokens->glmCameraPos);
+                        std::shared_ptr<const UsdParamsSnapshot> usdParams = _GetUsdParams(entityData->computedTimeSample);
+                        const VtValue* cameraPosValue = TfMapLookupPtr(usdParams->values, _golaemTokens->glmCameraPos);
                         if (cameraPosValue != NULL)
                         {
                             if (cameraPosValue->IsHolding<GfVec3f>())
@@ -3125,32 +4634,43 @@ namespace glm
                     entityData->inputGeoData._cameraWorldPosition = cameraPos;
                 }
 
-                glm::crowdio::GlmGeometryGenerationStatus geoStatus = glm::crowdio::glmPrepareEntityGeometry(&entityData->inputGeoData, &outputData);
-                if (geoStatus == glm::crowdio::GIO_SUCCESS)
+                bool isGeometryPrepared = false;
+                float geometryFrameCacheData[3] = {0, 0, 0}; // geometry behavior frame of the FBX characters
                 {
-                    entityData->geometryFileIdx = outputData._geometryFileIndexes[0];
-                    size_t meshCount = outputData._meshAssetNameIndices.size();
-
-                    glm::PODArray<SkinMeshData*>* meshDataArray = NULL;
-
-                    if (_params.glmLodMode == 0)
+                    // the frame data is read again: it may have been evicted while the frame was not pinned
+                    CrowdFieldSource::FramePin framePin(entityData->crowdFieldSource, entityData->computedTimeSample);
+                    const glm::crowdio::GlmFrameData* frameData = NULL;
                     {
-                        meshDataArray = &entityData->meshData;
+                        uint64_t lockStart = PerfCounters::now();
+                        glm::ScopedLock<TraceMutex> cachedSimuLock(entityData->crowdFieldSource->getLock());
+                        _perfCounters.add(PerfCounter::CACHED_SIMULATION_LOCK_WAIT_NS, PerfCounters::now() - lockStart);
+                        frameData = entityData->crowdFieldSource->getFrameData(entityData->computedTimeSample);
                     }
-                    else
+                    if (frameData == NULL)
                     {
-                        SkinMeshLodData* lodData = entityData->meshLodData[entityData->geometryFileIdx];
-                        // update lod visibility
-                        for (SkinMeshLodData* currentLodData : entityData->meshLodData)
-                        {
-                            currentLodData->enabled = false;
-                        }
-                        lodData->enabled = true;
-                        meshDataArray = &lodData->meshData;
+                        _InvalidateEntity(entityData);
+                        return;
+                    }
+                    entityData->inputGeoData._frameDatas[0] = frameData;
+                    isGeometryPrepared = _source->prepareEntityGeometry(&entityData->inputGeoData, &outputData);
+                    if (isGeometryPrepared && outputData._geoType == glm::crowdio::GeometryType::FBX && outputData._geoBeInfo._idGeometryFileIdx != -1)
+                    {
+                        memcpy(geometryFrameCacheData, frameData->_geoBehaviorAnimFrameInfo[outputData._geoBeInfo._geoDataIndex], sizeof(float[3]));
                     }
+                    // the deformed geometry is in outputData: the frame data is not read anymore
+                    entityData->inputGeoData._frameDatas[0] = NULL;
+                }
+
+                if (isGeometryPrepared)
+                {
+                    entityData->geometryFileIdx = outputData._geometryFileIndexes[0];
+                    size_t meshCount = outputData._meshAssetNameIndices.size();
+
+                    glm::PODArray<SkinMeshData*>* meshDataArray = &_GetSkinMeshDataArray(entityData);
 
                     glm::Array<glm::Array<glm::Vector3>>& frameDeformedVertices = outputData._deformedVertices[0];
                     glm::Array<glm::Array<glm::Vector3>>& frameDeformedNormals = outputData._deformedNormals[0];
+                    bool isGeometryValid = true; // false if a template does not match the geometry files
 
                     if (outputData._geoType == glm::crowdio::GeometryType::FBX)
                     {
@@ -3167,7 +4687,6 @@ namespace glm
                         // Extract frame
                         if (outputData._geoBeInfo._idGeometryFileIdx != -1)
                         {
-                            float(&geometryFrameCacheData)[3] = frameData->_geoBehaviorAnimFrameInfo[outputData._geoBeInfo._geoDataIndex];
                             double frameRate(FbxTime::GetFrameRate(fbxCharacter->touchFBXScene()->GetGlobalSettings().GetTimeMode()));
                             fbxTime.SetGlobalTimeMode(FbxTime::eCustom, frameRate);
                             fbxTime.SetMilliSeconds(long((double)geometryFrameCacheData[0] / frameRate * 1000.0));
@@ -3223,6 +4742,7 @@ namespace glm
                             polygonMasks.assign(fbxPolyCount, 0);
 
                             int meshMtlIdx = outputData._meshAssetMaterialIndices[iRenderMesh];
+                            size_t polygonVertexCount = 0;
 
                             // check material id and reconstruct data
                             for (unsigned int iFbxPoly = 0; iFbxPoly < fbxPolyCount; ++iFbxPoly)
@@ -3235,6 +4755,7 @@ namespace glm
                                 if (currentMtlIdx == meshMtlIdx)
                                 {
                                     polygonMasks[iFbxPoly] = 1;
+                                    polygonVertexCount += fbxMesh->GetPolygonSize(iFbxPoly);
                                     for (int iPolyVertex = 0, polyVertexCount = fbxMesh->GetPolygonSize(iFbxPoly); iPolyVertex < polyVertexCount; ++iPolyVertex)
                                     {
                                         int iFbxVertex = fbxMesh->GetPolygonVertex(iFbxPoly, iPolyVertex);
@@ -3248,15 +4769,21 @@ namespace glm
                                 }
                             }
 
-                            for (unsigned int iFbxVertex = 0, iActualVertex = 0; iFbxVertex < fbxVertexCount; ++iFbxVertex)
+                            unsigned int actualVertexCount = 0;
+                            for (unsigned int iFbxVertex = 0; iFbxVertex < fbxVertexCount; ++iFbxVertex)
                             {
                                 int& vertexMask = vertexMasks[iFbxVertex];
                                 if (vertexMask >= 0)
                                 {
-                                    vertexMask = iActualVertex;
-                                    ++iActualVertex;
+                                    vertexMask = actualVertexCount;
+                                    ++actualVertexCount;
                                 }
                             }
+                            if (!_CheckSkinMeshTemplate(entityData, meshData, actualVertexCount, polygonVertexCount))
+                            {
+                                isGeometryValid = false;
+                                continue;
+                            }
 
                             unsigned int iActualVertex = 0;
                             for (unsigned int iFbxVertex = 0; iFbxVertex < fbxVertexCount; ++iFbxVertex)
@@ -3343,6 +4870,20 @@ namespace glm
 
                             SkinMeshData* meshData = meshDataArray->at(iRenderMesh);
 
+                            glm::crowdio::GlmFileMeshTransform& assetFileMeshTransform = gcgCharacter->getGeometry()._transforms[outputData._transformIndicesInGcgFile[iRenderMesh]];
+                            glm::crowdio::GlmFileMesh& assetFileMesh = gcgCharacter->getGeometry()._meshes[assetFileMeshTransform._meshIndex];
+
+                            size_t polygonVertexCount = 0;
+                            for (uint32_t iPoly = 0; iPoly < assetFileMesh._polygonCount; ++iPoly)
+                            {
+                                polygonVertexCount += assetFileMesh._polygonsVertexCount[iPoly];
+                            }
+                            if (!_CheckSkinMeshTemplate(entityData, meshData, vertexCount, polygonVertexCount))
+                            {
+                                isGeometryValid = false;
+                                continue;
+                            }
+
                             for (size_t iVertex = 0; iVertex < vertexCount; ++iVertex)
                             {
                                 const glm::Vector3& meshVertex = meshDeformedVertices[iVertex];
@@ -3353,9 +4894,6 @@ namespace glm
 
                             const glm::Array<glm::Vector3>& meshDeformedNormals = frameDeformedNormals[iRenderMesh];
 
-                            glm::crowdio::GlmFileMeshTransform& assetFileMeshTransform = gcgCharacter->getGeometry()._transforms[outputData._transformIndicesInGcgFile[iRenderMesh]];
-                            glm::crowdio::GlmFileMesh& assetFileMesh = gcgCharacter->getGeometry()._meshes[assetFileMeshTransform._meshIndex];
-
                             // add normals
                             if (assetFileMesh._normalMode == glm::crowdio::GLM_NORMAL_PER_POLYGON_VERTEX)
                             {
@@ -3387,8 +4925,135 @@ namespace glm
                             }
                         }
                     }
+
+                    if (isGeometryValid)
+                    {
+                        _StoreCachedGeometry(entityData, sharedCacheClaim, true);
+                    }
+                }
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        bool GolaemUSD_DataImpl::_CheckSkinMeshTemplate(const EntityData* entityData, const SkinMeshData* meshData, size_t pointsCount, size_t normalsCount)
+        {
+            if (meshData->points.size() == pointsCount && meshData->normals.size() == normalsCount)
+            {
+                return true;
+            }
+            // the geometry files changed since the template was computed (or written in a sidecar file)
+            GLM_CROWD_TRACE_ERROR_LIMIT("The mesh '" << meshData->meshPath.GetText() << "' has " << pointsCount << " points and " << normalsCount << " normals but its template has "
+                                                     << meshData->points.size() << " points and " << meshData->normals.size() << " normals. The character geometry was modified: reload the layer to update its template.");
+            int characterIdx = entityData->inputGeoData._characterIdx;
+            if (characterIdx >= 0 && characterIdx < (int)_skinMeshTemplateDataPerChar.size())
+            {
+                SkinMeshTemplateCache::invalidate(_skinMeshTemplateDataPerChar[characterIdx].get());
+            }
+            return false;
+        }
+
+        //-----------------------------------------------------------------------------
+        glm::PODArray<GolaemUSD_DataImpl::SkinMeshData*>& GolaemUSD_DataImpl::_GetSkinMeshDataArray(SkinMeshEntityData* entityData)
+        {
+            if (_params.glmLodMode == 0)
+            {
+                return entityData->meshData;
+            }
+            SkinMeshLodData* lodData = entityData->meshLodData[entityData->geometryFileIdx];
+            // update lod visibility
+            for (SkinMeshLodData* currentLodData : entityData->meshLodData)
+            {
+                currentLodData->enabled = false;
+            }
+            lodData->enabled = true;
+            return lodData->meshData;
+        }
+
+        //-----------------------------------------------------------------------------
+        bool GolaemUSD_DataImpl::_ReadCachedGeometry(SkinMeshEntityData* entityData, SharedGeometryCache::Claim& sharedCacheClaim)
+        {
+            GLMUSD_ZONE("ReadCachedGeometry");
+            CachedGeometry cachedGeometry;
+            if (_sharedGeometryCache != NULL)
+            {
+                uint64_t waitNs = 0;
+                SharedGeometryCache::LookupResult::Value lookupResult = _sharedGeometryCache->findOrClaim(entityData->computedTimeSample, entityData->inputGeoData._entityId, cachedGeometry, sharedCacheClaim, waitNs);
+                _perfCounters.add(PerfCounter::SHM_CACHE_WAIT_NS, waitNs);
+                if (lookupResult == SharedGeometryCache::LookupResult::FOUND && _ApplyCachedGeometry(entityData, cachedGeometry))
+                {
+                    _perfCounters.add(PerfCounter::SHM_CACHE_HITS, 1);
+                    return true;
+                }
+                _perfCounters.add(PerfCounter::SHM_CACHE_MISSES, 1);
+            }
+            if (_diskGeometryCache != NULL)
+            {
+                if (_diskGeometryCache->findEntity(entityData->computedTimeSample, entityData->inputGeoData._entityId, cachedGeometry) && _ApplyCachedGeometry(entityData, cachedGeometry))
+                {
+                    _perfCounters.add(PerfCounter::DISK_CACHE_HITS, 1);
+                    // make it available to the other processes of the node
+                    _StoreCachedGeometry(entityData, sharedCacheClaim, false);
+                    return true;
+                }
+                _perfCounters.add(PerfCounter::DISK_CACHE_MISSES, 1);
+            }
+            return false;
+        }
+
+        //-----------------------------------------------------------------------------
+        bool GolaemUSD_DataImpl::_ApplyCachedGeometry(SkinMeshEntityData* entityData, const CachedGeometry& cachedGeometry)
+        {
+            if (_params.glmLodMode != 0 && cachedGeometry.geometryFileIdx >= entityData->meshLodData.size())
+            {
+                return false;
+            }
+
+            entityData->geometryFileIdx = cachedGeometry.geometryFileIdx;
+            glm::PODArray<SkinMeshData*>& meshDataArray = _GetSkinMeshDataArray(entityData);
+            if (cachedGeometry.meshCount != meshDataArray.size())
+            {
+                return false;
+            }
+            for (size_t iMesh = 0, meshCount = meshDataArray.size(); iMesh < meshCount; ++iMesh)
+            {
+                SkinMeshData* meshData = meshDataArray[iMesh];
+                if (!cachedGeometry.readMesh(iMesh, meshData->points, meshData->normals))
+                {
+                    // the entity is skinned again, which overwrites the partially read meshes
+                    return false;
                 }
             }
+            return true;
+        }
+
+        //-----------------------------------------------------------------------------
+        void GolaemUSD_DataImpl::_StoreCachedGeometry(SkinMeshEntityData* entityData, SharedGeometryCache::Claim& sharedCacheClaim, bool storeOnDisk)
+        {
+            storeOnDisk = storeOnDisk && _diskGeometryCache != NULL;
+            if (!sharedCacheClaim.isValid() && !storeOnDisk)
+            {
+                return;
+            }
+
+            GLMUSD_ZONE("StoreCachedGeometry");
+            const glm::PODArray<SkinMeshData*>& meshDataArray = _params.glmLodMode == 0 ? entityData->meshData : entityData->meshLodData[entityData->geometryFileIdx]->meshData;
+            glm::PODArray<const VtVec3fArray*> points;
+            glm::PODArray<const VtVec3fArray*> normals;
+            points.resize(meshDataArray.size());
+            normals.resize(meshDataArray.size());
+            for (size_t iMesh = 0, meshCount = meshDataArray.size(); iMesh < meshCount; ++iMesh)
+            {
+                points[iMesh] = &meshDataArray[iMesh]->points;
+                normals[iMesh] = &meshDataArray[iMesh]->normals;
+            }
+            if (sharedCacheClaim.isValid())
+            {
+                sharedCacheClaim.publish((uint32_t)entityData->geometryFileIdx, points, normals);
+            }
+            if (storeOnDisk)
+            {
+                _diskGeometryCache->storeEntity(entityData->computedTimeSample, entityData->inputGeoData._entityId, (uint32_t)entityData->geometryFileIdx, points, normals);
+            }
         }
 
         //-----------------------------------------------------------------------------
@@ -3415,7 +5080,15 @@ namespace glm
             meshData.entityData = entityData;
             entityData->meshData.push_back(&meshData);
             meshData.meshPath = lastMeshTransformPath;
-            meshData.templateData = &_skinMeshTemplateDataPerCharPerLod[0][0][{0, 0}];
+            meshData.templateData = &(*_skinMeshTemplateDataPerChar[0])[0].find({0, 0})->second;
+
+            if (_hasProxyMesh)
+            {
+                // points and normals are set by the simulation source at each compute
+                meshData.points.resize(meshData.templateData->pointsCount);
+                meshData.normals.resize(meshData.templateData->faceVertexIndices.size());
+                return;
+            }
 
             // compute the bounding box of the current entity
             glm::Vector3 halfExtents(1, 1, 1);
@@ -3515,13 +5188,9 @@ namespace glm
         }
 
         //-----------------------------------------------------------------------------
-        void GolaemUSD_DataImpl::_ComputeSkinMeshTemplateData(glm::Array<std::map<std::pair<int, int>, SkinMeshTemplateData>>& characterTemplateData, const glm::crowdio::InputEntityGeoData& inputGeoData, const glm::crowdio::OutputEntityGeoData& outputData)
+        void GolaemUSD_DataImpl::_ComputeSkinMeshTemplateData(SkinMeshCharacterTemplateData& characterTemplateData, const glm::crowdio::InputEntityGeoData& inputGeoData, const glm::crowdio::OutputEntityGeoData& outputData)
         {
-            glm::GlmString materialPath = _params.glmMaterialPath.GetText();
-            GolaemMaterialAssignMode::Value materialAssignMode = (GolaemMaterialAssignMode::Value)_params.glmMaterialAssignMode;
-
-            const glm::PODArray<int>& shadingGroupToSurfaceShader = _sgToSsPerChar[inputGeoData._characterIdx];
-
+            GLMUSD_ZONE("ComputeSkinMeshTemplateData");
             glm::GlmString meshName, meshAlias, materialSuffix;
             characterTemplateData.resize(outputData._geometryFileIndexes.size());
             for (size_t iLod = 0, lodCount = characterTemplateData.size(); iLod < lodCount; ++iLod)
@@ -3758,200 +5427,461 @@ namespace glm
                             }
                         }
                     }
-                    int shadingGroupIdx = outputData._meshShadingGroups[iRenderMesh];
+                    meshTemplateData.shadingGroupIdx = outputData._meshShadingGroups[iRenderMesh];
+                }
+            }
+        }
 
-                    glm::GlmString materialName = "";
-                    if (shadingGroupIdx >= 0)
-                    {
-                        const glm::ShadingGroup& shGroup = inputGeoData._character->_shadingGroups[shadingGroupIdx];
-                        materialName = materialPath;
-                        materialName.rtrim("/");
-                        materialName += "/";
-                        switch (materialAssignMode)
-                        {
-                        case GolaemMaterialAssignMode::BY_SHADING_GROUP:
-                        {
-                            materialName += TfMakeValidIdentifier(shGroup._name.c_str());
-                        }
-                        break;
-                        case GolaemMaterialAssignMode::BY_SURFACE_SHADER:
-                        {
-                            // get the surface shader
-                            int shaderAssetIdx = shadingGroupToSurfaceShader[shadingGroupIdx];
-                            if (shaderAssetIdx >= 0)
-                            {
-                                const glm::ShaderAsset& shAsset = inputGeoData._character->_shaderAssets[shaderAssetIdx];
-                                materialName += TfMakeValidIdentifier(shAsset._name.c_str());
-                            }
-                            else
-                            {
-                                materialName += "DefaultGolaemMat";
-                            }
-                        }
-                        break;
-                        default:
-                            break;
-                        }
-                    }
-                    if (!materialName.empty())
+        //-----------------------------------------------------------------------------
+        void GolaemUSD_DataImpl::_ComputeMaterialPaths(int characterIdx, const glm::GolaemCharacter* character)
+        {
+            glm::GlmString materialPath = _params.glmMaterialPath.GetText();
+            materialPath.rtrim("/");
+            materialPath += "/";
+            GolaemMaterialAssignMode::Value materialAssignMode = (GolaemMaterialAssignMode::Value)_params.glmMaterialAssignMode;
+
+            const glm::PODArray<int>& shadingGroupToSurfaceShader = _sgToSsPerChar[characterIdx];
+
+            glm::Array<SdfPathListOp>& characterMaterialPaths = _materialPathsPerChar[characterIdx];
+            characterMaterialPaths.resize(character->_shadingGroups.size());
+            for (size_t iShadingGroup = 0, shadingGroupCount = character->_shadingGroups.size(); iShadingGroup < shadingGroupCount; ++iShadingGroup)
+            {
+                const glm::ShadingGroup& shGroup = character->_shadingGroups[iShadingGroup];
+                glm::GlmString materialName = materialPath;
+                switch (materialAssignMode)
+                {
+                case GolaemMaterialAssignMode::BY_SHADING_GROUP:
+                {
+                    materialName += TfMakeValidIdentifier(shGroup._name.c_str());
+                }
+                break;
+                case GolaemMaterialAssignMode::BY_SURFACE_SHADER:
+                {
+                    // get the surface shader
+                    int shaderAssetIdx = shadingGroupToSurfaceShader[iShadingGroup];
+                    if (shaderAssetIdx >= 0)
                     {
-                        meshTemplateData.materialPath = SdfPathListOp::CreateExplicit({SdfPath(materialName.c_str())});
+                        const glm::ShaderAsset& shAsset = character->_shaderAssets[shaderAssetIdx];
+                        materialName += TfMakeValidIdentifier(shAsset._name.c_str());
                     }
                     else
                     {
-                        meshTemplateData.materialPath = (*_skinMeshRelationships)[_skinMeshRelationshipTokens->materialBinding].defaultTargetPath;
+                        materialName += "DefaultGolaemMat";
                     }
                 }
+                break;
+                default:
+                    break;
+                }
+                characterMaterialPaths[iShadingGroup] = SdfPathListOp::CreateExplicit({SdfPath(materialName.c_str())});
             }
         }
 
+        //-----------------------------------------------------------------------------
+        const SdfPathListOp* GolaemUSD_DataImpl::_GetMaterialPath(int characterIdx, int shadingGroupIdx)
+        {
+            if (shadingGroupIdx >= 0 && characterIdx >= 0 && characterIdx < _materialPathsPerChar.sizeInt())
+            {
+                const glm::Array<SdfPathListOp>& characterMaterialPaths = _materialPathsPerChar[characterIdx];
+                if (shadingGroupIdx < characterMaterialPaths.sizeInt())
+                {
+                    return &characterMaterialPaths[shadingGroupIdx];
+                }
+            }
+            return &(*_skinMeshRelationships)[_skinMeshRelationshipTokens->materialBinding].defaultTargetPath;
+        }
+
         //-----------------------------------------------------------------------------
         void GolaemUSD_DataImpl::HandleNotice(const UsdNotice::ObjectsChanged& notice)
         {
-            // check if stage has changed
-            RefreshUsdStage(notice.GetStage());
+            GLMUSD_ZONE("HandleNotice");
+            UsdStagePtr usdStage = notice.GetStage();
+            if (usdStage == NULL)
+            {
+                return;
+            }
+            std::shared_ptr<UsdWrapper> usdWrapper = _GetUsdWrapper(usdStage);
+            if (usdWrapper == NULL)
+            {
+                return;
+            }
 
-            // check if it's a gda property and change it
-            UsdNotice::ObjectsChanged::PathRange changedPaths = notice.GetChangedInfoOnlyPaths();
-            for (const SdfPath& changedPath : changedPaths)
+            // the root prim may have been moved, removed or composed (payload loaded, reference added) by this change:
+            // it can only appear under a resynced prim, only these subtrees are searched
+            bool refreshRootPath = false;
+            SdfPathVector searchRootPaths;
+            UsdNotice::ObjectsChanged::PathRange resyncedPaths = notice.GetResyncedPaths();
+            for (const SdfPath& resyncedPath : resyncedPaths)
             {
-                if (changedPath.IsPropertyPath())
+                if (resyncedPath.IsPrimPropertyPath())
                 {
-                    SdfPath primPath = changedPath.GetAbsoluteRootOrPrimPath();
-                    UsdPrim changedPrim = _usdWrapper._usdStage->GetPrimAtPath(primPath);
-                    if (!changedPrim.IsValid())
+                    // the root prim attributes may have been authored
+                    const TfToken& nameToken = resyncedPath.GetNameToken();
+                    if (usdWrapper->_rootPath.IsEmpty() && (nameToken == _golaemTokens->__glmNodeType__ || nameToken == _golaemTokens->__glmNodeId__))
                     {
-                        continue;
-                    }
-                    if (UsdAttribute typeAttribute = changedPrim.GetAttribute(_golaemTokens->__glmNodeType__))
-                    {
-                        TfToken typeValue;
-                        if (typeAttribute.Get(&typeValue) && typeValue == GolaemUSDFileFormatTokens->Id)
-                        {
-                            if (UsdAttribute nodeIdAttribute = changedPrim.GetAttribute(_golaemTokens->__glmNodeId__))
-                            {
-                                int nodeId = -1;
-                                if (nodeIdAttribute.Get(&nodeId) && nodeId == _rootNodeIdInFinalStage)
-                                {
-                                    const TfToken& nameToken = changedPath.GetNameToken();
-                                    if (VtValue* usdValue = TfMapLookupPtr(_usdParams, nameToken))
-                                    {
-                                        // get the new value
-                                        if (UsdAttribute usdAttribute = changedPrim.GetAttribute(nameToken))
-                                        {
-                                            usdAttribute.Get(usdValue);
-                                        }
-                                    }
-                                }
-                            }
-                        }
+                        searchRootPaths.push_back(resyncedPath.GetPrimPath());
+                        refreshRootPath = true;
                     }
+                    continue;
+                }
+                if (!resyncedPath.IsAbsoluteRootOrPrimPath())
+                {
+                    continue;
+                }
+                searchRootPaths.push_back(resyncedPath);
+                refreshRootPath = refreshRootPath || usdWrapper->_rootPath.IsEmpty() || usdWrapper->_rootPath.HasPrefix(resyncedPath);
+            }
+            bool refreshUsdParams = false;
+            if (refreshRootPath)
+            {
+                GLMUSD_ZONE("HandleNotice - refresh root path");
+                SdfPath::RemoveDescendentPaths(&searchRootPaths);
+                SdfPath rootPath = _FindRootPathInStage(usdStage, usdWrapper->_rootPath, searchRootPaths);
+                refreshUsdParams = rootPath != usdWrapper->_rootPath;
+                // read by _GetUsdWrapper for the other stages
+                glm::ScopedLock<TraceMutex> usdWrappersLock(_usdWrappersLock);
+                usdWrapper->_rootPath = rootPath;
+            }
+            _ActivateUsdWrapper(usdWrapper);
+            if (usdWrapper->_rootPath.IsEmpty())
+            {
+                return;
+            }
+
+            // only the changes of the usd params on the root prim are relevant: filter the paths before any stage access
+            bool invalidateUsdParams = false;
+            UsdNotice::ObjectsChanged::PathRange changedPaths = notice.GetChangedInfoOnlyPaths();
+            for (const SdfPath& changedPath : changedPaths)
+            {
+                if (refreshUsdParams)
+                {
+                    break;
+                }
+                if (!changedPath.IsPrimPropertyPath())
+                {
+                    continue;
+                }
+                if (changedPath.GetPrimPath() == usdWrapper->_rootPath && _usdParams.find(changedPath.GetNameToken()) != _usdParams.end())
+                {
+                    refreshUsdParams = true;
+                    break;
+                }
+                // the value of a connection source changed: the current frame must be evaluated again
+                for (const std::pair<TfToken, UsdAttribute>& connectedAttribute : usdWrapper->_connectedUsdAttributes)
+                {
+                    invalidateUsdParams = invalidateUsdParams || connectedAttribute.second.GetPath() == changedPath;
+                }
+            }
+            for (const SdfPath& resyncedPath : resyncedPaths)
+            {
+                if (refreshUsdParams)
+                {
+                    break;
+                }
+                if (resyncedPath.IsPrimPropertyPath() && resyncedPath.GetPrimPath() == usdWrapper->_rootPath && _usdParams.find(resyncedPath.GetNameToken()) != _usdParams.end())
+                {
+                    refreshUsdParams = true;
                 }
             }
+            if (refreshUsdParams)
+            {
+                GLMUSD_ZONE("HandleNotice - refresh usd params");
+                // also refreshes the connections, which may have been edited
+                _RefreshUsdParams(*usdWrapper);
+            }
+            else if (invalidateUsdParams)
+            {
+                glm::ScopedLock<TraceMutex> updateLock(usdWrapper->_updateLock);
+                usdWrapper->invalidate();
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        void GolaemUSD_DataImpl::OnReleased()
+        {
+            {
+                // the next layer using this implementation can be composed in other stages
+                glm::ScopedLock<TraceMutex> usdWrappersLock(_usdWrappersLock);
+                _usdWrappers.clear();
+                std::atomic_store(&_activeUsdWrapper, std::shared_ptr<UsdWrapper>());
+            }
+
+            // the process can exit during the grace period
+            if (_diskGeometryCache != NULL)
+            {
+                _diskGeometryCache->flush();
+            }
         }
 
         //-----------------------------------------------------------------------------
         void GolaemUSD_DataImpl::RefreshUsdStage(UsdStagePtr usdStage)
         {
-            if (usdStage != NULL && _usdWrapper._usdStage != usdStage)
+            if (usdStage == NULL)
+            {
+                return;
+            }
+            std::shared_ptr<UsdWrapper> usdWrapper = _GetUsdWrapper(usdStage);
+            if (usdWrapper != NULL)
             {
-                _usdWrapper._usdStage = usdStage;
+                _ActivateUsdWrapper(usdWrapper);
+            }
+        }
 
-                // find the path to in the final stage
-                SdfPathSet loadedPaths = usdStage->GetLoadSet();
-                for (const SdfPath& loadedPath : loadedPaths)
+        //-----------------------------------------------------------------------------
+        bool GolaemUSD_DataImpl::_IsRootPrimInStage(const UsdPrim& prim) const
+        {
+            if (!prim.IsValid())
+            {
+                return false;
+            }
+            if (UsdAttribute typeAttribute = prim.GetAttribute(_golaemTokens->__glmNodeType__))
+            {
+                TfToken typeValue;
+                if (typeAttribute.Get(&typeValue) && typeValue == GolaemUSDFileFormatTokens->Id)
                 {
-                    UsdPrim loadedPrim = usdStage->GetPrimAtPath(loadedPath);
-                    if (!loadedPrim.IsValid())
+                    if (UsdAttribute nodeIdAttribute = prim.GetAttribute(_golaemTokens->__glmNodeId__))
                     {
-                        continue;
+                        int nodeId = -1;
+                        return nodeIdAttribute.Get(&nodeId) && nodeId == _rootNodeIdInFinalStage;
                     }
+                }
+            }
+            return false;
+        }
+
+        //-----------------------------------------------------------------------------
+        SdfPath GolaemUSD_DataImpl::_FindRootPathInStage(const UsdStagePtr& usdStage, const SdfPath& knownRootPath, const SdfPathVector& searchRootPaths) const
+        {
+            // the node id is unique in the process: the known path is checked first, the stage is only scanned when the root prim moved
+            if (!knownRootPath.IsEmpty() && _IsRootPrimInStage(usdStage->GetPrimAtPath(knownRootPath)))
+            {
+                return knownRootPath;
+            }
 
-                    if (UsdAttribute typeAttribute = loadedPrim.GetAttribute(_golaemTokens->__glmNodeType__))
+            GLMUSD_ZONE("FindRootPathInStage");
+            for (const SdfPath& searchRootPath : searchRootPaths)
+            {
+                if (_IsRootPrimInStage(usdStage->GetPrimAtPath(searchRootPath)))
+                {
+                    return searchRootPath;
+                }
+                // only the loaded payloads of the subtree, instead of the whole load set of the stage
+                SdfPathSet loadablePaths = usdStage->FindLoadable(searchRootPath);
+                for (const SdfPath& loadablePath : loadablePaths)
+                {
+                    UsdPrim loadablePrim = usdStage->GetPrimAtPath(loadablePath);
+                    if (loadablePrim.IsLoaded() && _IsRootPrimInStage(loadablePrim))
                     {
-                        TfToken typeValue;
-                        if (typeAttribute.Get(&typeValue) && typeValue == GolaemUSDFileFormatTokens->Id)
-                        {
-                            if (UsdAttribute nodeIdAttribute = loadedPrim.GetAttribute(_golaemTokens->__glmNodeId__))
-                            {
-                                int nodeId = -1;
-                                if (nodeIdAttribute.Get(&nodeId) && nodeId == _rootNodeIdInFinalStage)
-                                {
-                                    _rootPathInFinalStage = loadedPath;
-                                    break;
-                                }
-                            }
-                        }
+                        return loadablePath;
                     }
                 }
-                if (!_rootPathInFinalStage.IsEmpty())
+            }
+            return SdfPath();
+        }
+
+        //-----------------------------------------------------------------------------
+        bool GolaemUSD_DataImpl::_UsesGolaemLayer(const UsdStagePtr& usdStage)
+        {
+            // the used layers are tracked by the composition: no prim is accessed
+            for (const SdfLayerHandle& usedLayer : usdStage->GetUsedLayers(false))
+            {
+                if (usedLayer && usedLayer->GetFileFormat()->GetFormatId() == GolaemUSDFileFormatTokens->Id)
                 {
-                    _usdWrapper._connectedUsdParams.clear();
-                    // refresh usd attributes
-                    if (UsdPrim thisPrim = usdStage->GetPrimAtPath(_rootPathInFinalStage))
-                    {
-                        for (auto& itUsdParam : _usdParams)
-                        {
-                            if (UsdAttribute usdAttribute = thisPrim.GetAttribute(itUsdParam.first))
-                            {
-                                usdAttribute.Get(&itUsdParam.second);
+                    return true;
+                }
+            }
+            return false;
+        }
 
-                                // check for connections
-                                SdfPathVector sourcePaths;
-                                usdAttribute.GetConnections(&sourcePaths);
-                                if (!sourcePaths.empty())
-                                {
-                                    _usdWrapper._connectedUsdParams.push_back({&itUsdParam.second, sourcePaths[0]});
-                                }
-                            }
-                        }
+        //-----------------------------------------------------------------------------
+        std::shared_ptr<GolaemUSD_DataImpl::UsdWrapper> GolaemUSD_DataImpl::_FindUsdWrapper(const UsdStagePtr& usdStage, SdfPath& knownRootPath)
+        {
+            glm::ScopedLock<TraceMutex> usdWrappersLock(_usdWrappersLock);
+            std::shared_ptr<UsdWrapper> usdWrapper;
+            for (size_t iWrapper = 0; iWrapper < _usdWrappers.size();)
+            {
+                if (!_usdWrappers[iWrapper]->_usdStage)
+                {
+                    // the stage was closed: the queries use the default params until another stage sends a notice
+                    if (std::atomic_load(&_activeUsdWrapper) == _usdWrappers[iWrapper])
+                    {
+                        std::atomic_store(&_activeUsdWrapper, std::shared_ptr<UsdWrapper>());
                     }
+                    _usdWrappers.erase(_usdWrappers.begin() + iWrapper);
+                    continue;
+                }
+                if (_usdWrappers[iWrapper]->_usdStage == usdStage)
+                {
+                    usdWrapper = _usdWrappers[iWrapper];
+                }
+                else if (knownRootPath.IsEmpty())
+                {
+                    // the layer is often composed at the same path in the viewport and render stages
+                    knownRootPath = _usdWrappers[iWrapper]->_rootPath;
+                }
+                ++iWrapper;
+            }
+            return usdWrapper;
+        }
+
+        //-----------------------------------------------------------------------------
+        std::shared_ptr<GolaemUSD_DataImpl::UsdWrapper> GolaemUSD_DataImpl::_GetUsdWrapper(const UsdStagePtr& usdStage)
+        {
+            SdfPath knownRootPath;
+            std::shared_ptr<UsdWrapper> usdWrapper = _FindUsdWrapper(usdStage, knownRootPath);
+            if (usdWrapper != NULL)
+            {
+                return usdWrapper;
+            }
+
+            // most stages of a LOP network do not use any Golaem layer: no wrapper, no prim access
+            if (!_UsesGolaemLayer(usdStage))
+            {
+                return NULL;
+            }
+
+            // the stage is scanned once, out of the lock: a wrapper with an empty root path then caches the negative result,
+            // only the resynced subtrees are searched again by HandleNotice
+            GLMUSD_ZONE("GetUsdWrapper - new stage");
+            std::shared_ptr<UsdWrapper> newUsdWrapper = std::make_shared<UsdWrapper>();
+            newUsdWrapper->_usdStage = usdStage;
+            newUsdWrapper->_usdParams = _usdParams;
+            newUsdWrapper->_perfCounters = &_perfCounters;
+            newUsdWrapper->_rootPath = _FindRootPathInStage(usdStage, knownRootPath, SdfPathVector(1, SdfPath::AbsoluteRootPath()));
+            _RefreshUsdParams(*newUsdWrapper);
+
+            glm::ScopedLock<TraceMutex> usdWrappersLock(_usdWrappersLock);
+            for (const std::shared_ptr<UsdWrapper>& otherUsdWrapper : _usdWrappers)
+            {
+                if (otherUsdWrapper->_usdStage == usdStage)
+                {
+                    // created meanwhile by another notice of the stage
+                    return otherUsdWrapper;
                 }
             }
+            _usdWrappers.push_back(newUsdWrapper);
+            return newUsdWrapper;
+        }
+
+        //-----------------------------------------------------------------------------
+        void GolaemUSD_DataImpl::_ActivateUsdWrapper(const std::shared_ptr<UsdWrapper>& usdWrapper)
+        {
+            // stages which do not compose the layer do not change the params used by the queries
+            glm::ScopedLock<TraceMutex> usdWrappersLock(_usdWrappersLock);
+            if (!usdWrapper->_rootPath.IsEmpty() && std::atomic_load(&_activeUsdWrapper) != usdWrapper)
+            {
+                std::atomic_store(&_activeUsdWrapper, usdWrapper);
+            }
         }
 
         //-----------------------------------------------------------------------------
-        void GolaemUSD_DataImpl::UsdWrapper::update(const double& frame, glm::ScopedLockActivable<glm::Mutex>& scopedLock)
+        void GolaemUSD_DataImpl::_RefreshUsdParams(UsdWrapper& usdWrapper)
         {
-            scopedLock.lock();
-            if (glm::approxDiff(_currentFrame, frame, static_cast<double>(GLM_NUMERICAL_PRECISION)))
+            glm::ScopedLock<TraceMutex> updateLock(usdWrapper._updateLock);
+            usdWrapper._connectedUsdAttributes.clear();
+            if (!usdWrapper._rootPath.IsEmpty())
             {
-                _currentFrame = frame;
-                if (_usdStage != NULL)
+                // refresh usd attributes
+                if (UsdPrim thisPrim = usdWrapper._usdStage->GetPrimAtPath(usdWrapper._rootPath))
                 {
-                    // update connected usd params
-                    for (std::pair<VtValue*, SdfPath>& connectedParam : _connectedUsdParams)
+                    for (auto& itUsdParam : usdWrapper._usdParams)
                     {
-                        if (connectedParam.second.IsPropertyPath())
+                        if (UsdAttribute usdAttribute = thisPrim.GetAttribute(itUsdParam.first))
                         {
-                            SdfPath primPath = connectedParam.second.GetAbsoluteRootOrPrimPath();
-                            if (UsdPrim prim = _usdStage->GetPrimAtPath(primPath))
+                            usdAttribute.Get(&itUsdParam.second);
+
+                            // check for connections, the source attributes are evaluated by the wrapper at each frame
+                            SdfPathVector sourcePaths;
+                            usdAttribute.GetConnections(&sourcePaths);
+                            if (!sourcePaths.empty() && sourcePaths[0].IsPropertyPath())
                             {
-                                const TfToken& nameToken = connectedParam.second.GetNameToken();
-                                if (UsdAttribute usdAttribute = prim.GetAttribute(nameToken))
+                                if (UsdAttribute sourceAttribute = usdWrapper._usdStage->GetAttributeAtPath(sourcePaths[0]))
                                 {
-                                    VtValue attrValue;
-                                    usdAttribute.Get(&attrValue, UsdTimeCode(_currentFrame));
-                                    const std::type_info& currentTypeInfo = connectedParam.first->GetTypeid();
-                                    if (attrValue.GetTypeid() == currentTypeInfo)
-                                    {
-                                        *connectedParam.first = attrValue;
-                                    }
-                                    else if (attrValue.CanCastToTypeid(currentTypeInfo))
-                                    {
-                                        *connectedParam.first = VtValue::CastToTypeid(attrValue, currentTypeInfo);
-                                    }
+                                    usdWrapper._connectedUsdAttributes.push_back({itUsdParam.first, sourceAttribute});
                                 }
                             }
                         }
                     }
                 }
             }
-            if (_usdStage == NULL || _connectedUsdParams.empty())
+            usdWrapper.invalidate();
+        }
+
+        //-----------------------------------------------------------------------------
+        std::shared_ptr<const GolaemUSD_DataImpl::UsdParamsSnapshot> GolaemUSD_DataImpl::_GetUsdParams(double frame) const
+        {
+            std::shared_ptr<UsdWrapper> usdWrapper = std::atomic_load(&_activeUsdWrapper);
+            if (usdWrapper == NULL || !usdWrapper->_usdStage)
+            {
+                // no stage, or its stage was closed since its last notice
+                return _defaultUsdParams;
+            }
+            return usdWrapper->update(frame);
+        }
+
+        //-----------------------------------------------------------------------------
+        void GolaemUSD_DataImpl::UsdWrapper::invalidate()
+        {
+            std::atomic_store(&_snapshot, std::shared_ptr<const UsdParamsSnapshot>());
+        }
+
+        //-----------------------------------------------------------------------------
+        std::shared_ptr<const GolaemUSD_DataImpl::UsdParamsSnapshot> GolaemUSD_DataImpl::UsdWrapper::update(double frame)
+        {
+            auto isSnapshotValid = [frame](const std::shared_ptr<const UsdParamsSnapshot>& snapshot)
+            {
+                return snapshot != NULL && (!snapshot->isAnimated || !glm::approxDiff(snapshot->frame, frame, static_cast<double>(GLM_NUMERICAL_PRECISION)));
+            };
+
+            std::shared_ptr<const UsdParamsSnapshot> snapshot = std::atomic_load(&_snapshot);
+            if (isSnapshotValid(snapshot))
+            {
+                return snapshot;
+            }
+
+            uint64_t lockStart = PerfCounters::now();
+            glm::ScopedLock<TraceMutex> updateLock(_updateLock);
+            if (_perfCounters != NULL)
+            {
+                _perfCounters->add(PerfCounter::UPDATE_LOCK_WAIT_NS, PerfCounters::now() - lockStart);
+            }
+
+            // evaluated by another thread meanwhile
+            snapshot = std::atomic_load(&_snapshot);
+            if (isSnapshotValid(snapshot))
+            {
+                return snapshot;
+            }
+
+            GLMUSD_ZONE("UsdWrapper::update");
+            std::shared_ptr<UsdParamsSnapshot> newSnapshot = std::make_shared<UsdParamsSnapshot>();
+            newSnapshot->frame = frame;
+            newSnapshot->isAnimated = !_connectedUsdAttributes.empty();
+            newSnapshot->values = _usdParams;
+
+            // update connected usd params
+            for (const std::pair<TfToken, UsdAttribute>& connectedAttribute : _connectedUsdAttributes)
             {
-                // nothing to update, no need to keep the lock
-                scopedLock.unlock();
+                VtValue* paramValue = TfMapLookupPtr(newSnapshot->values, connectedAttribute.first);
+                VtValue attrValue;
+                if (paramValue == NULL || !connectedAttribute.second.Get(&attrValue, UsdTimeCode(frame)))
+                {
+                    continue;
+                }
+                const std::type_info& currentTypeInfo = paramValue->GetTypeid();
+                if (attrValue.GetTypeid() == currentTypeInfo)
+                {
+                    paramValue->Swap(attrValue);
+                }
+                else if (attrValue.CanCastToTypeid(currentTypeInfo))
+                {
+                    *paramValue = VtValue::CastToTypeid(attrValue, currentTypeInfo);
+                }
             }
+
+            snapshot = newSnapshot;
+            std::atomic_store(&_snapshot, snapshot);
+            return snapshot;
         }
 
     } // namespace usdplugin
@@ -8,9 +8,25 @@
 
 #include "glmUSD.h"
 #include "glmUSDData.h"
+#include "glmUSDDiskGeometryCache.h"
+#include "glmUSDMemoryReport.h"
+#include "glmUSDPerfCounters.h"
+#include "glmUSDSharedGeometryCache.h"
+#include "glmUSDSimulationSource.h"
+#include "glmUSDSkinMeshTemplate.h"
+#include "glmUSDTrace.h"
+
+USD_INCLUDES_START
+#include <pxr/usd/usd/attribute.h>
+USD_INCLUDES_END
 
 #include <glmSimulationCacheFactory.h>
 
+#include <atomic>
+#include <cfloat>
+#include <memory>
+#include <vector>
+
 namespace glm
 {
     namespace usdplugin
@@ -28,6 +44,28 @@ namespace glm
             };
         };
 
+        struct GolaemRenderPercentMode
+        {
+            enum Value
+            {
+                FIRST,      // first entities of the crowd field
+                RANDOM,     // deterministic uniform subsample on the entity ids
+                STRATIFIED, // uniform subsample on a spatial grid of the entity positions
+                END
+            };
+        };
+
+        struct GolaemGroupBy
+        {
+            enum Value
+            {
+                NONE,           // entities directly under the crowd field
+                CHARACTER,      // one group prim per character
+                RENDERING_TYPE, // one group prim per character rendering type
+                END
+            };
+        };
+
         struct GolaemMaterialAssignMode
         {
             enum Value
@@ -41,11 +79,22 @@ namespace glm
         class GolaemUSD_DataImpl
         {
         private:
+            typedef std::map<TfToken, size_t, TfTokenFastArbitraryLessThan> AttrIndexMap;
+
+            // pp attributes of a crowd field, shared by its entities
+            struct PPAttrTable
+            {
+                AttrIndexMap indexes;               // float attributes first, then vector attributes
+                glm::PODArray<uint8_t> floatAttrs;  // simulation data index of the published float attributes
+                glm::PODArray<uint8_t> vectorAttrs; // simulation data index of the published vector attributes
+            };
+
             // cached data for each entity
             struct EntityData
             {
-                std::map<TfToken, size_t, TfTokenFastArbitraryLessThan> ppAttrIndexes;
-                std::map<TfToken, size_t, TfTokenFastArbitraryLessThan> shaderAttrIndexes;
+                const AttrIndexMap* ppAttrIndexes = NULL;     // from _ppAttrTables
+                const AttrIndexMap* shaderAttrIndexes = NULL; // from _shaderAttrsPerChar
+                const PPAttrTable* ppAttrTable = NULL;
 
                 SdfPath entityPath;
 
@@ -53,8 +102,7 @@ namespace glm
                 bool excluded = false; // excluded by layout - the entity will always be empty
                 bool enabled = true;   // can vary during simulation (kill, emit)
                 uint32_t bonePositionOffset = 0;
-                glm::Mutex* cachedSimulationLock = NULL;
-                glm::Mutex* entityComputeLock = NULL; // do not allow simultaneous computes of the same entity
+                TraceMutex* entityComputeLock = NULL; // do not allow simultaneous computes of the same entity
 
                 glm::PODArray<int> intShaderAttrValues;
                 glm::PODArray<float> floatShaderAttrValues;
@@ -65,7 +113,7 @@ namespace glm
                 glm::Array<GfVec3f> vectorPPAttrValues;
 
                 glm::crowdio::InputEntityGeoData inputGeoData;
-                glm::crowdio::CachedSimulation* cachedSimulation = NULL;
+                CrowdFieldSource* crowdFieldSource = NULL;
 
                 GfVec3f pos{0, 0, 0};
 
@@ -73,6 +121,59 @@ namespace glm
                 void initEntityLock();
             };
 
+            // shader attribute of a character, computed at init
+            struct ShaderAttrInfo
+            {
+                TfToken name;          // usd attribute name, with the attribute namespace
+                glm::ShaderAttributeType::Value type = glm::ShaderAttributeType::END;
+                size_t valueIdx = 0;   // index in the entity values of its type
+                bool isBool = false;   // int attribute declared as a bool for arnold
+            };
+
+            struct CharacterShaderAttrs
+            {
+                glm::Array<ShaderAttrInfo> attributes; // same order as GolaemCharacter::_shaderAttributes, type is END for the filtered attributes
+                AttrIndexMap indexes;                  // index in attributes of the published attributes, shared by the entities
+                size_t valueCounts[glm::ShaderAttributeType::END] = {};
+            };
+
+            // attributes of all the entities of a crowd field, published as array primvars on the crowd field prim (glmCrowdFieldAttributes)
+            struct CrowdFieldAttrData
+            {
+                struct AttrKind
+                {
+                    enum Value
+                    {
+                        ENTITY_ID,
+                        PP_FLOAT,
+                        PP_VECTOR,
+                        SHADER,
+                        END
+                    };
+                };
+
+                struct Attribute
+                {
+                    AttrKind::Value kind = AttrKind::END;
+                    size_t ppAttrIdx = 0;                                                         // PP_FLOAT and PP_VECTOR
+                    glm::ShaderAttributeType::Value shaderType = glm::ShaderAttributeType::END; // SHADER
+                    bool isBool = false;                                                          // SHADER
+                    glm::PODArray<int> shaderAttrIdxPerChar; // SHADER: index in the character shader attributes, -1 if the character does not have it
+                    TfToken typeName;
+                    VtValue values; // one value per entity, constant for ENTITY_ID
+                };
+
+                CrowdFieldSource* crowdFieldSource = NULL;
+                glm::PODArray<uint32_t> entityIndices; // simulation data index of the entity of each array element
+                std::map<TfToken, size_t, TfTokenFastArbitraryLessThan> attrIndexes;
+                glm::Array<Attribute> attributes;
+                double computedTimeSample = 0;
+                bool computed = false;
+                TraceMutex* computeLock = NULL; // do not allow simultaneous computes of the crowd field
+
+                ~CrowdFieldAttrData();
+            };
+
             struct SkinMeshData;
             struct SkinMeshLodData;
             struct SkinMeshEntityData : public EntityData
@@ -95,7 +196,6 @@ namespace glm
             };
 
             struct SkinMeshLodData;
-            struct SkinMeshTemplateData;
             struct SkinMeshData
             {
                 SkinMeshLodData* lodData = NULL;       // used when lod is enabled (glmLodMode > 0)
@@ -106,20 +206,10 @@ namespace glm
                 VtVec3fArray normals; // stored by polygon vertex
 
                 const SkinMeshTemplateData* templateData = NULL;
+                const SdfPathListOp* materialPath = NULL; // from _materialPathsPerChar, NULL for the bounding boxes
                 SdfPath meshPath;
             };
 
-            struct SkinMeshTemplateData
-            {
-                VtIntArray faceVertexCounts;
-                VtIntArray faceVertexIndices;
-                glm::Array<VtVec2fArray> uvSets; // stored by polygon vertex
-                GlmString meshAlias;
-                int pointsCount;
-                // int normalsCount; // not needed, = faceVertexIndices.size();
-                SdfPathListOp materialPath;
-            };
-
             struct SkinMeshLodData
             {
                 glm::PODArray<SkinMeshData*> meshData;
@@ -140,19 +230,36 @@ namespace glm
                 SkelEntityData* entityData = NULL;
             };
 
+            typedef std::map<TfToken, VtValue, TfTokenFastArbitraryLessThan> UsdParamMap;
+
+            // values of the usd params at a frame, never modified once published
+            struct UsdParamsSnapshot
+            {
+                double frame = -FLT_MAX;
+                bool isAnimated = false; // false when no param is connected: valid at all frames
+                UsdParamMap values;
+            };
+
+            // state of the layer in one of the stages it is composed in
             struct UsdWrapper
             {
             public:
-                glm::Array<std::pair<VtValue*, SdfPath>> _connectedUsdParams;
-                UsdStagePtr _usdStage = NULL; // from GolaemUSD_DataImpl
-                glm::Mutex _updateLock;
+                UsdStagePtr _usdStage = NULL;
+                SdfPath _rootPath;                                                    // path of the layer root prim in the stage, empty if not found
+                UsdParamMap _usdParams;                                               // values in the stage, modified with _updateLock held
+                glm::Array<std::pair<TfToken, UsdAttribute>> _connectedUsdAttributes; // connection source of each connected param
+                mutable TraceMutex _updateLock{GLMUSD_MUTEX_DESC("UsdWrapper::_updateLock")};
+                PerfCounters* _perfCounters = NULL; // from GolaemUSD_DataImpl
 
             protected:
-                double _currentFrame = -FLT_MAX;
+                std::shared_ptr<const UsdParamsSnapshot> _snapshot; // read and written with std::atomic_load / std::atomic_store
 
             public:
-                inline const double& getCurrentFrame() const;
-                void update(const double& frame, glm::ScopedLockActivable<glm::Mutex>& scopedLock);
+                // the params or their connections changed, call with _updateLock held
+                void invalidate();
+
+                // returns the params evaluated at the frame, without locking when they are already evaluated
+                std::shared_ptr<const UsdParamsSnapshot> update(double frame);
             };
 
         private:
@@ -160,10 +267,13 @@ namespace glm
             // layer's file format arguments.
             GolaemUSD_DataParams _params;
 
-            crowdio::SimulationCacheFactory* _factory;
+            SimulationSource* _source;
+            bool _hasProxyMesh = false; // bounding box display mode uses the source proxy mesh instead of a cube
             glm::Array<glm::PODArray<int>> _sgToSsPerChar;
             glm::Array<PODArray<int>> _snsIndicesPerChar;
-            glm::Array<glm::Array<std::map<std::pair<int, int>, SkinMeshTemplateData>>> _skinMeshTemplateDataPerCharPerLod;
+            glm::Array<CharacterShaderAttrs> _shaderAttrsPerChar;
+            glm::Array<std::shared_ptr<const SkinMeshCharacterTemplateData>> _skinMeshTemplateDataPerChar; // from SkinMeshTemplateCache
+            glm::Array<glm::Array<SdfPathListOp>> _materialPathsPerChar; // per shading group, from the material params
 
             glm::Array<GlmString> _shaderAttrTypes;
             glm::Array<VtValue> _shaderAttrDefaultValues;
@@ -189,6 +299,10 @@ namespace glm
 
             TfHashMap<SdfPath, SkinMeshEntityData, SdfPath::Hash> _skinMeshEntityDataMap;
 
+            // glmEntityPayloads: entity id of each entity prim, its geometry is in a payload to the same procedural file
+            TfHashMap<SdfPath, int64_t, SdfPath::Hash> _entityPayloadIds;
+            VtDictionary _entityPayloadParams; // params of the entity payloads, glmEntitySelection is set per entity
+
             TfHashMap<SdfPath, SkelEntityData, SdfPath::Hash> _skelEntityDataMap;
 
             TfHashMap<SdfPath, SkinMeshData, SdfPath::Hash> _skinMeshDataMap;
@@ -197,13 +311,27 @@ namespace glm
 
             TfHashMap<SdfPath, SkelAnimData, SdfPath::Hash> _skelAnimDataMap;
 
-            glm::PODArray<glm::Mutex*> _cachedSimulationLocks;
-
-            UsdWrapper _usdWrapper;
-
-            std::map<TfToken, VtValue, TfTokenFastArbitraryLessThan> _usdParams; // additional usd params and their value
+            TfHashMap<SdfPath, CrowdFieldAttrData, SdfPath::Hash> _crowdFieldAttrDataMap; // empty if glmCrowdFieldAttributes is disabled
+            TfHashMap<SdfPath, PPAttrTable, SdfPath::Hash> _ppAttrTables;                // per crowd field path
+            AttrIndexMap _emptyAttrIndexes;                                               // attributes of the entities without published attributes
+
+            std::vector<std::shared_ptr<UsdWrapper>> _usdWrappers; // one per stage using a Golaem layer, modified by the stage notices with _usdWrappersLock held
+            std::shared_ptr<UsdWrapper> _activeUsdWrapper;         // stage which sent the last notice, read with std::atomic_load, written with std::atomic_store and _usdWrappersLock held
+            TraceMutex _usdWrappersLock{GLMUSD_MUTEX_DESC("GolaemUSD_DataImpl::_usdWrappersLock")}; // the notices of several stages can be sent concurrently
+            PerfCounters _perfCounters;
+            // reports of the glmMemory attributes, computed once for all the attributes read by a flatten or a copy
+            mutable TraceMutex _memoryReportsLock{GLMUSD_MUTEX_DESC("GolaemUSD_DataImpl::_memoryReportsLock")};
+            mutable MemoryReport _cachedLayerMemoryReport;
+            mutable MemoryReport _cachedProcessMemoryReport;
+            mutable uint64_t _memoryReportsTime = 0; // PerfCounters::now() when computed, 0 if never
+            std::atomic<double> _lastQueriedFrame{-FLT_MAX}; // marks the frame changes for the profilers, independently of the usd params snapshots
+            glm::Array<glm::GlmString> _dependencyFiles;      // filled by _InitFromParams
+            DiskGeometryCache* _diskGeometryCache = NULL;     // NULL when GLMUSD_DISK_CACHE_DIR is not set
+            SharedGeometryCache* _sharedGeometryCache = NULL; // NULL when GLMUSD_SHM_CACHE_SIZE_MB is not set
+
+            UsdParamMap _usdParams; // additional usd params and their default value, the keys do not change after init
+            std::shared_ptr<const UsdParamsSnapshot> _defaultUsdParams; // used until the layer is found in a stage
 
-            SdfPath _rootPathInFinalStage;
             int _rootNodeIdInFinalStage = -1;
 
         public:
@@ -261,6 +389,21 @@ namespace glm
 
             void RefreshUsdStage(UsdStagePtr usdStage);
 
+            /// Called when the last layer using this implementation is closed and it is kept for reuse:
+            /// detaches it from its stage and flushes the geometry caches
+            void OnReleased();
+
+            /// Computes the approximate memory held by this layer, per category
+            void ComputeMemoryReport(MemoryReport& report) const;
+
+            /// Sums the memory reports of all the layers alive in the process
+            static void ComputeProcessMemoryReport(MemoryReport& report);
+
+            const PerfCounters& GetPerfCounters() const;
+
+            /// Input files of the layer (cache library, characters, layouts, terrains, caches): a released implementation is not reused when one of them changed
+            const glm::Array<glm::GlmString>& GetDependencyFiles() const;
+
         private:
             // Initializes the cached data from the params object.
             void _InitFromParams();
@@ -271,18 +414,29 @@ namespace glm
             bool _HasTargetPathValue(const SdfPath& path, VtValue* value) const;
             bool _HasPropertyTypeNameValue(const SdfPath& path, VtValue* value) const;
             bool _HasPropertyInterpolation(const SdfPath& path, VtValue* value) const;
+            bool _HasRootStatsValue(const TfToken& nameToken, VtValue* value) const;
+            void _GetCachedMemoryReports(MemoryReport& layerReport, MemoryReport& processReport) const;
 
             SdfPath _CreateHierarchyFor(const glm::GlmString& hierarchy, const SdfPath& parentPath, GlmMap<GlmString, SdfPath>& existingPaths);
             void _ComputeSkelEntity(SkelEntityData* entityData, double frame);
             void _ComputeSkinMeshEntity(SkinMeshEntityData* entityData, double frame);
             void _DoComputeSkinMeshEntity(SkinMeshEntityData* entityData);
+            glm::PODArray<SkinMeshData*>& _GetSkinMeshDataArray(SkinMeshEntityData* entityData);
+            void _InitGeometryCaches(const glm::Array<glm::GlmString>& dependencyFiles, const glm::GlmString& geometryStamps);
+            bool _ReadCachedGeometry(SkinMeshEntityData* entityData, SharedGeometryCache::Claim& sharedCacheClaim);
+            bool _ApplyCachedGeometry(SkinMeshEntityData* entityData, const CachedGeometry& cachedGeometry);
+            void _StoreCachedGeometry(SkinMeshEntityData* entityData, SharedGeometryCache::Claim& sharedCacheClaim, bool storeOnDisk);
+            // false if the deformed geometry does not match the template sizes (stale template): the template is invalidated
+            bool _CheckSkinMeshTemplate(const EntityData* entityData, const SkinMeshData* meshData, size_t pointsCount, size_t normalsCount);
             void _ComputeEntity(EntityData* entityData);
             void _InvalidateEntity(EntityData* entityData);
             void _ComputeBboxData(SkinMeshEntityData* entityData);
             void _ComputeSkinMeshTemplateData(
-                glm::Array<std::map<std::pair<int, int>, SkinMeshTemplateData>>& characterTemplateData,
+                SkinMeshCharacterTemplateData& characterTemplateData,
                 const glm::crowdio::InputEntityGeoData& inputGeoData,
                 const glm::crowdio::OutputEntityGeoData& outputData);
+            void _ComputeMaterialPaths(int characterIdx, const glm::GolaemCharacter* character);
+            const SdfPathListOp* _GetMaterialPath(int characterIdx, int shadingGroupIdx);
             void _InitSkinMeshData(
                 const SdfPath& parentPath,
                 SkinMeshEntityData* entityData,
@@ -292,13 +446,33 @@ namespace glm
                 const glm::PODArray<int>& gchaMeshIds,
                 const glm::PODArray<int>& meshAssetMaterialIndices);
 
-            bool _QueryEntityAttributes(const EntityData* genericEntityData, const TfToken& nameToken, const double& frame, VtValue* value);
+            bool _QueryEntityAttributes(const EntityData* genericEntityData, const TfToken& nameToken, VtValue* value);
+
+            void _InitCrowdFieldAttributes(CrowdFieldAttrData& cfAttrData, const glm::crowdio::GlmSimulationData* simuData, const PPAttrTable& ppAttrTable);
+            const CrowdFieldAttrData::Attribute* _FindCrowdFieldAttribute(const SdfPath& path) const;
+            void _ComputeCrowdFieldAttributes(CrowdFieldAttrData& cfAttrData, double frame);
+
+            // Stage notices helpers
+            bool _IsRootPrimInStage(const UsdPrim& prim) const;
+            SdfPath _FindRootPathInStage(const UsdStagePtr& usdStage, const SdfPath& knownRootPath, const SdfPathVector& searchRootPaths) const;
+            static bool _UsesGolaemLayer(const UsdStagePtr& usdStage);
+            std::shared_ptr<UsdWrapper> _FindUsdWrapper(const UsdStagePtr& usdStage, SdfPath& knownRootPath);
+            std::shared_ptr<UsdWrapper> _GetUsdWrapper(const UsdStagePtr& usdStage); // NULL for the stages which do not use any Golaem layer
+            void _ActivateUsdWrapper(const std::shared_ptr<UsdWrapper>& usdWrapper);
+            void _RefreshUsdParams(UsdWrapper& usdWrapper);
+            std::shared_ptr<const UsdParamsSnapshot> _GetUsdParams(double frame) const;
         };
 
         //-----------------------------------------------------------------------------
-        inline const Time& GolaemUSD_DataImpl::UsdWrapper::getCurrentFrame() const
+        inline const PerfCounters& GolaemUSD_DataImpl::GetPerfCounters() const
+        {
+            return _perfCounters;
+        }
+
+        //-----------------------------------------------------------------------------
+        inline const glm::Array<glm::GlmString>& GolaemUSD_DataImpl::GetDependencyFiles() const
         {
-            return _currentFrame;
+            return _dependencyFiles;
         }
     } // namespace usdplugin
 } // namespace glm
@@ -0,0 +1,222 @@
+/***************************************************************************
+*                                                                          *
+*  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+*                                                                          *
+***************************************************************************/
+
+#include "glmUSDDataImplRegistry.h"
+#include "glmUSDAssetRegistry.h"
+#include "glmUSDDataImpl.h"
+
+USD_INCLUDES_START
+#include <pxr/base/tf/envSetting.h>
+USD_INCLUDES_END
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <list>
+#include <mutex>
+#include <thread>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        TF_DEFINE_ENV_SETTING(GLMUSD_IMPL_GRACE_PERIOD, 30, "Seconds during which a closed Golaem layer is kept alive to be reused by a layer with the same params (0 destroys it immediately).");
+
+        namespace
+        {
+            // released implementations kept at most, the oldest ones are destroyed first
+            const size_t MAX_RELEASED_IMPLS = 4;
+
+            struct ReleasedImpl
+            {
+                std::string key;
+                std::string fileStamps; // of the dependency files when released, the implementation is stale when they changed
+                GolaemUSD_DataImpl* impl;
+                std::chrono::steady_clock::time_point deadline;
+            };
+
+            struct ImplRegistry
+            {
+                std::mutex lock;
+                std::condition_variable reaperCondition;
+                std::thread reaperThread;
+                bool isReaperRunning = false;
+                bool isShutDown = false;               // set at exit, the implementations released afterwards are destroyed immediately
+                std::list<ReleasedImpl> releasedImpls; // oldest first, all with the same grace period: sorted by deadline
+            };
+
+            //-----------------------------------------------------------------------------
+            ImplRegistry& _GetRegistry()
+            {
+                // never destroyed: implementations can still be released by the static destructors of the host
+                static ImplRegistry* registry = new ImplRegistry();
+                return *registry;
+            }
+
+            //-----------------------------------------------------------------------------
+            std::string _GetFileStamps(const glm::Array<glm::GlmString>& files)
+            {
+                std::string fileStamps;
+                for (const glm::GlmString& file : files)
+                {
+                    fileStamps += AssetRegistry::getFileStamp(file.c_str());
+                    fileStamps += '\n';
+                }
+                return fileStamps;
+            }
+
+            //-----------------------------------------------------------------------------
+            void _ShutDown()
+            {
+                // registered when the first reaper starts: called before the static destructors of crowdio, which were constructed earlier
+                ImplRegistry& registry = _GetRegistry();
+                std::thread reaperThread;
+                std::list<ReleasedImpl> releasedImpls;
+                {
+                    std::lock_guard<std::mutex> lock(registry.lock);
+                    registry.isShutDown = true;
+                    reaperThread = std::move(registry.reaperThread);
+                    releasedImpls.swap(registry.releasedImpls);
+                    registry.reaperCondition.notify_all();
+                }
+                // the reaper may be destroying an implementation
+                if (reaperThread.joinable())
+                {
+                    reaperThread.join();
+                }
+                for (const ReleasedImpl& releasedImpl : releasedImpls)
+                {
+                    delete releasedImpl.impl;
+                }
+            }
+
+            //-----------------------------------------------------------------------------
+            std::string _MakeKey(const GolaemUSD_DataParams& params)
+            {
+                std::string key;
+                for (const auto& itArg : params.ToArgs())
+                {
+                    key += itArg.first;
+                    key += '=';
+                    key += itArg.second;
+                    key += '\n';
+                }
+                return key;
+            }
+
+            //-----------------------------------------------------------------------------
+            void _ReaperLoop()
+            {
+                ImplRegistry& registry = _GetRegistry();
+                std::unique_lock<std::mutex> lock(registry.lock);
+                while (!registry.releasedImpls.empty() && !registry.isShutDown)
+                {
+                    std::chrono::steady_clock::time_point deadline = registry.releasedImpls.front().deadline;
+                    if (std::chrono::steady_clock::now() < deadline)
+                    {
+                        registry.reaperCondition.wait_until(lock, deadline);
+                        continue;
+                    }
+                    GolaemUSD_DataImpl* impl = registry.releasedImpls.front().impl;
+                    registry.releasedImpls.pop_front();
+
+                    // the last layer may tear down crowdio, do not block the other threads meanwhile
+                    lock.unlock();
+                    delete impl;
+                    lock.lock();
+                }
+                registry.isReaperRunning = false;
+            }
+
+            //-----------------------------------------------------------------------------
+            void _Release(const std::string& key, GolaemUSD_DataImpl* impl)
+            {
+                int gracePeriod = TfGetEnvSetting(GLMUSD_IMPL_GRACE_PERIOD);
+                if (gracePeriod <= 0)
+                {
+                    delete impl;
+                    return;
+                }
+
+                impl->OnReleased();
+                std::string fileStamps = _GetFileStamps(impl->GetDependencyFiles());
+
+                static std::once_flag shutDownRegistered;
+                std::call_once(shutDownRegistered, []() { std::atexit(_ShutDown); });
+
+                ImplRegistry& registry = _GetRegistry();
+                glm::PODArray<GolaemUSD_DataImpl*> evictedImpls;
+                std::thread stoppedReaperThread;
+                {
+                    std::lock_guard<std::mutex> lock(registry.lock);
+                    if (registry.isShutDown)
+                    {
+                        evictedImpls.push_back(impl);
+                    }
+                    else
+                    {
+                        registry.releasedImpls.push_back({key, fileStamps, impl, std::chrono::steady_clock::now() + std::chrono::seconds(gracePeriod)});
+                        while (registry.releasedImpls.size() > MAX_RELEASED_IMPLS)
+                        {
+                            evictedImpls.push_back(registry.releasedImpls.front().impl);
+                            registry.releasedImpls.pop_front();
+                        }
+                        if (!registry.isReaperRunning)
+                        {
+                            // the reaper stops when there are no released implementations left, the stopped thread is joined out of the lock
+                            registry.isReaperRunning = true;
+                            stoppedReaperThread = std::move(registry.reaperThread);
+                            registry.reaperThread = std::thread(_ReaperLoop);
+                        }
+                    }
+                }
+                if (stoppedReaperThread.joinable())
+                {
+                    stoppedReaperThread.join();
+                }
+                for (GolaemUSD_DataImpl* evictedImpl : evictedImpls)
+                {
+                    delete evictedImpl;
+                }
+            }
+        } // namespace
+
+        /*static*/
+        //-----------------------------------------------------------------------------
+        std::shared_ptr<GolaemUSD_DataImpl> GolaemUSD_DataImplRegistry::acquire(const GolaemUSD_DataParams& params)
+        {
+            std::string key = _MakeKey(params);
+            GolaemUSD_DataImpl* impl = NULL;
+            std::string fileStamps;
+            {
+                ImplRegistry& registry = _GetRegistry();
+                std::lock_guard<std::mutex> lock(registry.lock);
+                for (auto itReleasedImpl = registry.releasedImpls.rbegin(); itReleasedImpl != registry.releasedImpls.rend(); ++itReleasedImpl)
+                {
+                    if (itReleasedImpl->key == key)
+                    {
+                        impl = itReleasedImpl->impl;
+                        fileStamps = itReleasedImpl->fileStamps;
+                        registry.releasedImpls.erase(std::next(itReleasedImpl).base());
+                        break;
+                    }
+                }
+            }
+            // the dependency files are only known once initialized: their stamps complete the key, checked out of the registry lock
+            if (impl != NULL && _GetFileStamps(impl->GetDependencyFiles()) != fileStamps)
+            {
+                delete impl;
+                impl = NULL;
+            }
+            if (impl == NULL)
+            {
+                // not under the registry lock: other layers can be opened or released meanwhile
+                impl = new GolaemUSD_DataImpl(params);
+            }
+            return std::shared_ptr<GolaemUSD_DataImpl>(impl, [key](GolaemUSD_DataImpl* releasedImpl) { _Release(key, releasedImpl); });
+        }
+    } // namespace usdplugin
+} // namespace glm
@@ -0,0 +1,29 @@
+/***************************************************************************
+*                                                                          *
+*  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+*                                                                          *
+***************************************************************************/
+
+#pragma once
+
+#include "glmUSDData.h"
+
+#include <memory>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        /// Process-wide registry of the layer implementations, keyed by the layer params.
+        /// Released implementations (and the crowdio init they hold) are kept alive for a grace period
+        /// (GLMUSD_IMPL_GRACE_PERIOD seconds) and reused when a layer with the same params is opened again,
+        /// so that recompositions (payload toggles, variant switches, reverted param edits) do not run _InitFromParams again.
+        class GolaemUSD_DataImplRegistry
+        {
+        public:
+            /// Returns a released implementation created with the same params if any, a new one otherwise.
+            /// The implementation goes back to the registry when the last shared pointer is released
+            static std::shared_ptr<GolaemUSD_DataImpl> acquire(const GolaemUSD_DataParams& params);
+        };
+    } // namespace usdplugin
+} // namespace glm
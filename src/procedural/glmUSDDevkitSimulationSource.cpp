@@ -0,0 +1,290 @@
+/***************************************************************************
+*                                                                          *
+*  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+*                                                                          *
+***************************************************************************/
+
+#include "glmUSDDevkitSimulationSource.h"
+#include "glmUSDAssetRegistry.h"
+
+#include <glmLog.h>
+#include <glmCrowdIOUtils.h>
+#include <glmScopedLock.h>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        //-----------------------------------------------------------------------------
+        DevkitCrowdFieldSource::DevkitCrowdFieldSource(crowdio::CachedSimulation& cachedSimulation)
+            : _cachedSimulation(cachedSimulation)
+        {
+        }
+
+        //-----------------------------------------------------------------------------
+        void DevkitCrowdFieldSource::getFrameRange(int& firstFrame, int& lastFrame)
+        {
+            _cachedSimulation.getSrcFrameRangeAvailableOnDisk(firstFrame, lastFrame);
+        }
+
+        //-----------------------------------------------------------------------------
+        const crowdio::GlmSimulationData* DevkitCrowdFieldSource::getSimulationData()
+        {
+            return _cachedSimulation.getFinalSimulationData();
+        }
+
+        //-----------------------------------------------------------------------------
+        const crowdio::GlmFrameData* DevkitCrowdFieldSource::getFrameData(double frame)
+        {
+            return _cachedSimulation.getFinalFrameData(frame, UINT32_MAX, true);
+        }
+
+        //-----------------------------------------------------------------------------
+        const ShaderAssetDataContainer* DevkitCrowdFieldSource::getShaderData(double frame)
+        {
+            return _cachedSimulation.getFinalShaderData(frame, UINT32_MAX, true);
+        }
+
+        //-----------------------------------------------------------------------------
+        const glm::Array<glm::PODArray<int>>& DevkitCrowdFieldSource::getEntityAssets(int frame)
+        {
+            return _cachedSimulation.getFinalEntityAssets(frame);
+        }
+
+        // Simulation cache factory shared by the sources loading the same files, with the crowd field sources wrapping its cached simulations
+        struct DevkitSharedFactory
+        {
+            crowdio::SimulationCacheFactory* factory = NULL;
+            std::shared_ptr<const crowdio::crowdTerrain::TerrainMesh> sourceTerrain; // from AssetRegistry
+            std::shared_ptr<const crowdio::crowdTerrain::TerrainMesh> destTerrain;
+            GlmMap<crowdio::CachedSimulation*, DevkitCrowdFieldSource*> crowdFields;
+            GlmMap<glm::GlmString, std::string> cacheFileStamps; // stamp of the simulation file of each loaded crowd field, when it was loaded
+            TraceMutex crowdFieldsLock{GLMUSD_MUTEX_DESC("DevkitSharedFactory::crowdFieldsLock")};
+            glm::GlmString key;
+            int refCount = 0;
+        };
+
+        namespace
+        {
+            //-----------------------------------------------------------------------------
+            TraceMutex& _GetSharedFactoriesLock()
+            {
+                // never destroyed: sources can be released after the static destructors
+                static TraceMutex* sharedFactoriesLock = new TraceMutex{GLMUSD_MUTEX_DESC("DevkitSimulationSource::sharedFactoriesLock")};
+                return *sharedFactoriesLock;
+            }
+
+            //-----------------------------------------------------------------------------
+            GlmMap<glm::GlmString, DevkitSharedFactory*>& _GetSharedFactories()
+            {
+                static GlmMap<glm::GlmString, DevkitSharedFactory*>* sharedFactories = new GlmMap<glm::GlmString, DevkitSharedFactory*>();
+                return *sharedFactories;
+            }
+
+            //-----------------------------------------------------------------------------
+            std::shared_ptr<const crowdio::crowdTerrain::TerrainMesh> _GetTerrain(const glm::GlmString& terrainFile)
+            {
+                if (terrainFile.empty())
+                {
+                    return NULL;
+                }
+                return AssetRegistry::get<crowdio::crowdTerrain::TerrainMesh>(terrainFile.c_str(), terrainFile.c_str(), [&terrainFile]()
+                {
+                    // closed with the last factory using it: factories created before a terrain reload keep the previous one
+                    return std::shared_ptr<const crowdio::crowdTerrain::TerrainMesh>(crowdio::crowdTerrain::loadTerrainAsset(terrainFile.c_str()), [](const crowdio::crowdTerrain::TerrainMesh* terrain)
+                    {
+                        crowdio::crowdTerrain::TerrainMesh* closedTerrain = const_cast<crowdio::crowdTerrain::TerrainMesh*>(terrain);
+                        crowdio::crowdTerrain::closeTerrainAsset(closedTerrain);
+                    });
+                });
+            }
+
+            //-----------------------------------------------------------------------------
+            glm::GlmString _GetSimulationFile(const glm::GlmString& cacheDir, const glm::GlmString& cacheName, const glm::GlmString& crowdFieldName)
+            {
+                return cacheDir + "/" + cacheName + "." + crowdFieldName + ".gscs";
+            }
+
+            //-----------------------------------------------------------------------------
+            bool _AreCacheFilesUpToDate(DevkitSharedFactory& sharedFactory)
+            {
+                // the decoded simulations of the factory do not match a crowd field simulated again in place
+                glm::ScopedLock<TraceMutex> crowdFieldsLock(sharedFactory.crowdFieldsLock);
+                for (const auto& itCacheFileStamp : sharedFactory.cacheFileStamps)
+                {
+                    if (AssetRegistry::getFileStamp(itCacheFileStamp.first.c_str()) != itCacheFileStamp.second)
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            }
+        } // namespace
+
+        //-----------------------------------------------------------------------------
+        DevkitSimulationSource::DevkitSimulationSource()
+        {
+        }
+
+        //-----------------------------------------------------------------------------
+        DevkitSimulationSource::~DevkitSimulationSource()
+        {
+            DevkitSharedFactory* sharedFactory = _sharedFactory.load();
+            if (sharedFactory == NULL)
+            {
+                return;
+            }
+            glm::ScopedLock<TraceMutex> sharedFactoriesLock(_GetSharedFactoriesLock());
+            if (--sharedFactory->refCount > 0)
+            {
+                return;
+            }
+            // a factory with stale caches is already replaced by a new one with the same key
+            auto itSharedFactory = _GetSharedFactories().find(sharedFactory->key);
+            if (itSharedFactory != _GetSharedFactories().end() && itSharedFactory->second == sharedFactory)
+            {
+                _GetSharedFactories().erase(itSharedFactory);
+            }
+            for (const auto& itCrowdField : sharedFactory->crowdFields)
+            {
+                delete itCrowdField.second;
+            }
+            delete sharedFactory->factory;
+            delete sharedFactory;
+        }
+
+        //-----------------------------------------------------------------------------
+        void DevkitSimulationSource::loadCharacters(const glm::GlmString& characterFiles)
+        {
+            GLM_DEBUG_ASSERT(_sharedFactory.load() == NULL);
+            _characterFiles = characterFiles;
+        }
+
+        //-----------------------------------------------------------------------------
+        void DevkitSimulationSource::loadLayouts(const glm::Array<glm::GlmString>& layoutFiles)
+        {
+            GLM_DEBUG_ASSERT(_sharedFactory.load() == NULL);
+            for (size_t iLayout = 0, layoutCount = layoutFiles.size(); iLayout < layoutCount; ++iLayout)
+            {
+                if (layoutFiles[iLayout].length() > 0)
+                {
+                    _layoutFiles.push_back(layoutFiles[iLayout]);
+                }
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        void DevkitSimulationSource::loadTerrains(const glm::GlmString& srcTerrainFile, const glm::GlmString& dstTerrainFile)
+        {
+            GLM_DEBUG_ASSERT(_sharedFactory.load() == NULL);
+            _srcTerrainFile = srcTerrainFile;
+            _dstTerrainFile = dstTerrainFile;
+        }
+
+        //-----------------------------------------------------------------------------
+        DevkitSharedFactory& DevkitSimulationSource::_getSharedFactory() const
+        {
+            DevkitSharedFactory* acquiredFactory = _sharedFactory.load(std::memory_order_acquire);
+            if (acquiredFactory != NULL)
+            {
+                return *acquiredFactory;
+            }
+
+            // the file stamps reload the factory of the next layers when a character or a layout is modified
+            glm::GlmString key = _characterFiles + "\n" + glm::stringArrayToString(_layoutFiles, ";") + "\n" + _srcTerrainFile + "\n" + _dstTerrainFile;
+            glm::Array<glm::GlmString> characterFilesArray = glm::stringToStringArray(_characterFiles, ";");
+            for (const glm::GlmString& characterFile : characterFilesArray)
+            {
+                key += "\n";
+                key += AssetRegistry::getFileStamp(characterFile.c_str()).c_str();
+            }
+            for (const glm::GlmString& layoutFile : _layoutFiles)
+            {
+                key += "\n";
+                key += AssetRegistry::getFileStamp(layoutFile.c_str()).c_str();
+            }
+
+            // the factory is loaded under the registry lock: a layer opened meanwhile with the same files waits for it instead of loading it again
+            glm::ScopedLock<TraceMutex> sharedFactoriesLock(_GetSharedFactoriesLock());
+            // another thread of this source can have acquired it while the key was computed
+            acquiredFactory = _sharedFactory.load(std::memory_order_relaxed);
+            if (acquiredFactory != NULL)
+            {
+                return *acquiredFactory;
+            }
+            DevkitSharedFactory*& sharedFactory = _GetSharedFactories()[key];
+            if (sharedFactory != NULL && !_AreCacheFilesUpToDate(*sharedFactory))
+            {
+                // the layers still using the stale factory keep it, the next ones load the caches again
+                sharedFactory = NULL;
+            }
+            if (sharedFactory == NULL)
+            {
+                GLMUSD_ZONE("DevkitSimulationSource::LoadFactory");
+                sharedFactory = new DevkitSharedFactory();
+                sharedFactory->key = key;
+                sharedFactory->factory = new crowdio::SimulationCacheFactory();
+                crowdio::SimulationCacheFactory* factory = sharedFactory->factory;
+
+                factory->loadGolaemCharacters(_characterFiles.c_str());
+                for (size_t iLayout = 0, layoutCount = _layoutFiles.size(); iLayout < layoutCount; ++iLayout)
+                {
+                    factory->loadLayoutHistoryFile(factory->getLayoutHistoryCount(), _layoutFiles[iLayout].c_str());
+                }
+
+                sharedFactory->sourceTerrain = _GetTerrain(_srcTerrainFile);
+                sharedFactory->destTerrain = _GetTerrain(_dstTerrainFile);
+                if (sharedFactory->destTerrain == NULL)
+                {
+                    sharedFactory->destTerrain = sharedFactory->sourceTerrain;
+                }
+                // the factory only reads the terrains
+                factory->setTerrainMeshes(const_cast<crowdio::crowdTerrain::TerrainMesh*>(sharedFactory->sourceTerrain.get()), const_cast<crowdio::crowdTerrain::TerrainMesh*>(sharedFactory->destTerrain.get()));
+            }
+            ++sharedFactory->refCount;
+            _sharedFactory.store(sharedFactory, std::memory_order_release);
+            return *sharedFactory;
+        }
+
+        //-----------------------------------------------------------------------------
+        CrowdFieldSource* DevkitSimulationSource::getCrowdField(const glm::GlmString& cacheDir, const glm::GlmString& cacheName, const glm::GlmString& crowdFieldName)
+        {
+            DevkitSharedFactory& sharedFactory = _getSharedFactory();
+            // crowd field sources are shared too: their lock serializes the frame reads of all the layers
+            glm::ScopedLock<TraceMutex> crowdFieldsLock(sharedFactory.crowdFieldsLock);
+            crowdio::CachedSimulation& cachedSimulation = sharedFactory.factory->getCachedSimulation(cacheDir.c_str(), cacheName.c_str(), crowdFieldName.c_str());
+            DevkitCrowdFieldSource*& crowdField = sharedFactory.crowdFields[&cachedSimulation];
+            glm::GlmString simulationFile = _GetSimulationFile(cacheDir, cacheName, crowdFieldName);
+            std::string simulationFileStamp = AssetRegistry::getFileStamp(simulationFile.c_str());
+            if (crowdField == NULL)
+            {
+                crowdField = new DevkitCrowdFieldSource(cachedSimulation);
+                sharedFactory.cacheFileStamps[simulationFile] = simulationFileStamp;
+            }
+            else if (sharedFactory.cacheFileStamps[simulationFile] != simulationFileStamp)
+            {
+                // simulated again after this layer acquired the factory: the next layers will load it again
+                GLM_CROWD_TRACE_WARNING_LIMIT("The cache '" << simulationFile << "' changed while it was used by another layer, this layer reads the previously loaded simulation. Reload the layer to read the new one.");
+            }
+            return crowdField;
+        }
+
+        //-----------------------------------------------------------------------------
+        int DevkitSimulationSource::getCharacterCount() const
+        {
+            return _getSharedFactory().factory->getGolaemCharacters().sizeInt();
+        }
+
+        //-----------------------------------------------------------------------------
+        const GolaemCharacter* DevkitSimulationSource::getCharacter(int characterIdx) const
+        {
+            return _getSharedFactory().factory->getGolaemCharacter(characterIdx);
+        }
+
+        //-----------------------------------------------------------------------------
+        bool DevkitSimulationSource::prepareEntityGeometry(crowdio::InputEntityGeoData* inputGeoData, crowdio::OutputEntityGeoData* outputGeoData)
+        {
+            return glm::crowdio::glmPrepareEntityGeometry(inputGeoData, outputGeoData) == glm::crowdio::GIO_SUCCESS;
+        }
+    } // namespace usdplugin
+} // namespace glm
@@ -0,0 +1,66 @@
+/***************************************************************************
+*                                                                          *
+*  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+*                                                                          *
+***************************************************************************/
+
+#pragma once
+
+#include "glmUSDSimulationSource.h"
+
+#include <atomic>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        struct DevkitSharedFactory;
+
+        // Crowd field read from the Golaem simulation caches
+        class DevkitCrowdFieldSource : public CrowdFieldSource
+        {
+        public:
+            DevkitCrowdFieldSource(crowdio::CachedSimulation& cachedSimulation);
+
+            void getFrameRange(int& firstFrame, int& lastFrame) override;
+            const crowdio::GlmSimulationData* getSimulationData() override;
+            const crowdio::GlmFrameData* getFrameData(double frame) override;
+            const ShaderAssetDataContainer* getShaderData(double frame) override;
+            const glm::Array<glm::PODArray<int>>& getEntityAssets(int frame) override;
+
+        private:
+            crowdio::CachedSimulation& _cachedSimulation;
+        };
+
+        // Default source: Golaem caches, characters, layouts and terrains loaded through the devkit.
+        // Sources loading the same characters, layouts and terrains share a process-wide simulation cache factory,
+        // so layers reading the same crowd fields decode and keep each frame once. A factory is not shared anymore once one of its crowd fields is simulated again
+        class DevkitSimulationSource : public SimulationSource
+        {
+        public:
+            DevkitSimulationSource();
+            virtual ~DevkitSimulationSource();
+
+            void loadCharacters(const glm::GlmString& characterFiles) override;
+            void loadLayouts(const glm::Array<glm::GlmString>& layoutFiles) override;
+            void loadTerrains(const glm::GlmString& srcTerrainFile, const glm::GlmString& dstTerrainFile) override;
+
+            CrowdFieldSource* getCrowdField(const glm::GlmString& cacheDir, const glm::GlmString& cacheName, const glm::GlmString& crowdFieldName) override;
+
+            int getCharacterCount() const override;
+            const GolaemCharacter* getCharacter(int characterIdx) const override;
+
+            bool prepareEntityGeometry(crowdio::InputEntityGeoData* inputGeoData, crowdio::OutputEntityGeoData* outputGeoData) override;
+
+        private:
+            // acquires the shared factory matching the loaded files on first use
+            DevkitSharedFactory& _getSharedFactory() const;
+
+            glm::GlmString _characterFiles;
+            glm::Array<glm::GlmString> _layoutFiles;
+            glm::GlmString _srcTerrainFile;
+            glm::GlmString _dstTerrainFile;
+            mutable std::atomic<DevkitSharedFactory*> _sharedFactory{NULL}; // set once under the shared factories lock
+        };
+    } // namespace usdplugin
+} // namespace glm
@@ -162,10 +162,18 @@ namespace glm
                 return false;
             }
 
+            // the camera position is only read by the lod modes
+            bool isCameraPosUsed = GolaemUSD_DataParams::FromDict(oldDict).glmLodMode != 0 || GolaemUSD_DataParams::FromDict(newDict).glmLodMode != 0;
+
             // Otherwise we iterate through each possible parameter value looking for
             // any one that has a value change between the two dictionaries.
             for (const TfToken& token : GolaemUSD_DataParamsTokens->allTokens)
             {
+                if (!isCameraPosUsed && token == GolaemUSD_DataParamsTokens->glmCameraPos)
+                {
+                    continue;
+                }
+
                 auto oldIt = oldDict.find(token);
                 auto newIt = newDict.find(token);
                 const bool oldValExists = oldIt != oldDict.end();
@@ -0,0 +1,106 @@
+/***************************************************************************
+*                                                                          *
+*  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+*                                                                          *
+***************************************************************************/
+
+#include "glmUSDSimulationSource.h"
+#include "glmUSDDevkitSimulationSource.h"
+#include "glmUSDSyntheticSimulationSource.h"
+#include "glmUSDData.h"
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        //-----------------------------------------------------------------------------
+        CrowdFieldSource::FramePin::FramePin(CrowdFieldSource* source, double frame)
+            : _source(source)
+            , _frame(frame)
+        {
+            GLMUSD_ZONE("CrowdFieldSource::PinFrame");
+            std::unique_lock<std::mutex> pinLock(_source->_pinLock);
+            // pins of a frame already pinned do not overtake a frame waiting for a free pin
+            uint64_t pinTicket = _source->_nextPinTicket++;
+            size_t maxPinnedFrameCount = _source->getMaxPinnedFrameCount();
+            _source->_pinCondition.wait(pinLock, [&]() {
+                return pinTicket == _source->_servedPinTicket && (_source->_pinCounts.count(frame) > 0 || _source->_pinCounts.size() < maxPinnedFrameCount);
+            });
+            ++_source->_pinCounts[frame];
+            ++_source->_servedPinTicket;
+            if (_source->_servedPinTicket != _source->_nextPinTicket)
+            {
+                _source->_pinCondition.notify_all();
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        CrowdFieldSource::FramePin::~FramePin()
+        {
+            std::unique_lock<std::mutex> pinLock(_source->_pinLock);
+            std::map<double, int>::iterator itPinCount = _source->_pinCounts.find(_frame);
+            if (--itPinCount->second == 0)
+            {
+                _source->_pinCounts.erase(itPinCount);
+                _source->_pinCondition.notify_all();
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        CrowdFieldSource::~CrowdFieldSource()
+        {
+        }
+
+        //-----------------------------------------------------------------------------
+        bool CrowdFieldSource::isFramePinned(double frame)
+        {
+            std::unique_lock<std::mutex> pinLock(_pinLock);
+            return _pinCounts.count(frame) > 0;
+        }
+
+        //-----------------------------------------------------------------------------
+        size_t CrowdFieldSource::getMaxPinnedFrameCount() const
+        {
+            return 1;
+        }
+
+        //-----------------------------------------------------------------------------
+        SimulationSource::~SimulationSource()
+        {
+        }
+
+        /*static*/
+        //-----------------------------------------------------------------------------
+        SimulationSource* SimulationSource::create(const GolaemUSD_DataParams& params)
+        {
+            if (!params.glmSyntheticCrowd.IsEmpty())
+            {
+                return new SyntheticSimulationSource(SyntheticSimulationSource::Settings::fromString(params.glmSyntheticCrowd.GetText()));
+            }
+            return new DevkitSimulationSource();
+        }
+
+        //-----------------------------------------------------------------------------
+        void SimulationSource::getDefaultCrowdFieldNames(glm::Array<glm::GlmString>& crowdFieldNames) const
+        {
+            crowdFieldNames.clear();
+        }
+
+        //-----------------------------------------------------------------------------
+        bool SimulationSource::hasCharacterGeometry() const
+        {
+            return true;
+        }
+
+        //-----------------------------------------------------------------------------
+        bool SimulationSource::getProxyMeshTopology(VtIntArray& /*faceVertexCounts*/, VtIntArray& /*faceVertexIndices*/, size_t& /*pointsCount*/) const
+        {
+            return false;
+        }
+
+        //-----------------------------------------------------------------------------
+        void SimulationSource::deformProxyMesh(const crowdio::InputEntityGeoData& /*inputGeoData*/, uint32_t /*bonePositionOffset*/, VtVec3fArray& /*points*/, VtVec3fArray& /*normals*/) const
+        {
+        }
+    } // namespace usdplugin
+} // namespace glm
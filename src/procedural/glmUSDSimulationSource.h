@@ -0,0 +1,121 @@
+/***************************************************************************
+*                                                                          *
+*  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+*                                                                          *
+***************************************************************************/
+
+#pragma once
+
+#include "glmUSD.h"
+#include "glmUSDTrace.h"
+
+USD_INCLUDES_START
+#include <pxr/pxr.h>
+#include <pxr/base/vt/types.h>
+USD_INCLUDES_END
+
+#include <glmSimulationCacheFactory.h>
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        using namespace PXR_INTERNAL_NS;
+
+        struct GolaemUSD_DataParams;
+
+        // Simulation data, frame data and shader data of one crowd field
+        class CrowdFieldSource
+        {
+        public:
+            virtual ~CrowdFieldSource();
+
+            // Keeps the data of a frame valid while it is read. Sources can be shared by several layers and evict a frame when another one is loaded:
+            // pinning a new frame waits while getMaxPinnedFrameCount frames are pinned. Pins are served in order, a waiting frame is not starved
+            class FramePin
+            {
+            public:
+                FramePin(CrowdFieldSource* source, double frame);
+                ~FramePin();
+
+            private:
+                FramePin(const FramePin&) = delete;
+                FramePin& operator=(const FramePin&) = delete;
+
+                CrowdFieldSource* _source;
+                double _frame;
+            };
+
+            virtual void getFrameRange(int& firstFrame, int& lastFrame) = 0;
+            virtual const crowdio::GlmSimulationData* getSimulationData() = 0;
+
+            // The returned data stays valid while its frame is pinned
+            virtual const crowdio::GlmFrameData* getFrameData(double frame) = 0;
+            virtual const ShaderAssetDataContainer* getShaderData(double frame) = 0;
+            virtual const glm::Array<glm::PODArray<int>>& getEntityAssets(int frame) = 0;
+
+            // Sources are not thread safe: all the getters must be called with this lock held.
+            // Frames are pinned before taking the lock
+            TraceMutex& getLock();
+
+        protected:
+            // True while a FramePin keeps the data of the frame: it must not be overwritten
+            bool isFramePinned(double frame);
+
+            // Frames whose data can be kept valid together, 1 when loading a frame may evict any other one
+            virtual size_t getMaxPinnedFrameCount() const;
+
+            TraceMutex _lock{GLMUSD_MUTEX_DESC("CrowdFieldSource::_lock")};
+
+        private:
+            std::mutex _pinLock;
+            std::condition_variable _pinCondition;
+            std::map<double, int> _pinCounts; // pin count of each pinned frame
+            uint64_t _nextPinTicket = 0;
+            uint64_t _servedPinTicket = 0;
+        };
+
+        // Everything the layer reads from the simulation: characters, crowd fields and entity geometry
+        class SimulationSource
+        {
+        public:
+            virtual ~SimulationSource();
+
+            // Creates the source matching the params: synthetic when glmSyntheticCrowd is set, devkit caches otherwise
+            static SimulationSource* create(const GolaemUSD_DataParams& params);
+
+            virtual void loadCharacters(const glm::GlmString& characterFiles) = 0;
+            virtual void loadLayouts(const glm::Array<glm::GlmString>& layoutFiles) = 0;
+            virtual void loadTerrains(const glm::GlmString& srcTerrainFile, const glm::GlmString& dstTerrainFile) = 0;
+
+            // Crowd fields used when neither the cache library nor the params give any
+            virtual void getDefaultCrowdFieldNames(glm::Array<glm::GlmString>& crowdFieldNames) const;
+
+            // The returned source is owned by this object
+            virtual CrowdFieldSource* getCrowdField(const glm::GlmString& cacheDir, const glm::GlmString& cacheName, const glm::GlmString& crowdFieldName) = 0;
+
+            virtual int getCharacterCount() const = 0;
+            virtual const GolaemCharacter* getCharacter(int characterIdx) const = 0;
+
+            // False if the characters have no skeleton or mesh assets: only the bounding box display mode is available
+            virtual bool hasCharacterGeometry() const;
+
+            // Returns true on success
+            virtual bool prepareEntityGeometry(crowdio::InputEntityGeoData* inputGeoData, crowdio::OutputEntityGeoData* outputGeoData) = 0;
+
+            // Optional proxy mesh replacing the bounding box cube, deformed by the entity bones at each frame
+            virtual bool getProxyMeshTopology(VtIntArray& faceVertexCounts, VtIntArray& faceVertexIndices, size_t& pointsCount) const;
+            virtual void deformProxyMesh(const crowdio::InputEntityGeoData& inputGeoData, uint32_t bonePositionOffset, VtVec3fArray& points, VtVec3fArray& normals) const;
+        };
+
+        //-----------------------------------------------------------------------------
+        inline TraceMutex& CrowdFieldSource::getLock()
+        {
+            return _lock;
+        }
+    } // namespace usdplugin
+} // namespace glm
@@ -0,0 +1,354 @@
+/***************************************************************************
+*                                                                          *
+*  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+*                                                                          *
+***************************************************************************/
+
+#include "glmUSDSkinMeshTemplate.h"
+#include "glmUSDTrace.h"
+
+USD_INCLUDES_START
+#include <pxr/base/arch/fileSystem.h>
+#include <pxr/base/arch/systemInfo.h>
+#include <pxr/base/tf/fileUtils.h>
+#include <pxr/base/tf/pathUtils.h>
+#include <pxr/base/tf/stringUtils.h>
+USD_INCLUDES_END
+
+#include <glmLog.h>
+#include <glmScopedLock.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        namespace
+        {
+            const char FILE_MAGIC[8] = {'G', 'L', 'M', 'T', 'P', 'L', 'C', 'H'};
+            const uint32_t FILE_FORMAT_VERSION = 2;
+
+            struct FileHeader
+            {
+                char magic[8];
+                uint32_t formatVersion;
+                uint32_t lodCount;
+                uint64_t key;
+            };
+
+            struct MeshHeader
+            {
+                int32_t meshAssetIndex;
+                int32_t materialIndex;
+                int32_t pointsCount;
+                uint32_t faceCount;
+                uint32_t faceVertexCount;
+                uint32_t uvSetCount;
+                uint32_t aliasLength;
+                int32_t shadingGroupIndex;
+            };
+
+            // bounds checked reads of a mapped template file, all the fields are 4 bytes aligned
+            class FileReader
+            {
+            public:
+                FileReader(const char* data, size_t size)
+                    : _data(data)
+                    , _size(size)
+                {
+                }
+
+                const char* readBytes(size_t size)
+                {
+                    size_t alignedSize = (size + 3) & ~size_t(3);
+                    if (alignedSize > _size - _offset)
+                    {
+                        return NULL;
+                    }
+                    const char* data = _data + _offset;
+                    _offset += alignedSize;
+                    return data;
+                }
+
+                template <typename T>
+                bool readValue(T& value)
+                {
+                    const char* data = readBytes(sizeof(T));
+                    if (data == NULL)
+                    {
+                        return false;
+                    }
+                    memcpy(&value, data, sizeof(T));
+                    return true;
+                }
+
+            private:
+                const char* _data;
+                size_t _size;
+                size_t _offset = 0;
+            };
+
+            //-----------------------------------------------------------------------------
+            void _Write(std::string& buffer, const void* data, size_t size)
+            {
+                buffer.append(static_cast<const char*>(data), size);
+                buffer.append(((size + 3) & ~size_t(3)) - size, '\0');
+            }
+
+            struct CachedTemplate
+            {
+                std::weak_ptr<const SkinMeshCharacterTemplateData> templateData;
+                std::string templateFile;
+            };
+            typedef std::map<std::string, CachedTemplate> TemplateMap;
+
+            //-----------------------------------------------------------------------------
+            TraceMutex& _GetTemplatesLock()
+            {
+                // never destroyed: templates can be released after the static destructors
+                static TraceMutex* templatesLock = new TraceMutex{GLMUSD_MUTEX_DESC("SkinMeshTemplateCache::templatesLock")};
+                return *templatesLock;
+            }
+
+            //-----------------------------------------------------------------------------
+            TemplateMap& _GetTemplates()
+            {
+                static TemplateMap* templates = new TemplateMap();
+                return *templates;
+            }
+        } // namespace
+
+        /*static*/
+        //-----------------------------------------------------------------------------
+        std::shared_ptr<const SkinMeshCharacterTemplateData> SkinMeshTemplateCache::acquire(const glm::GlmString& key, const std::string& templateFile, uint64_t fileKey, const ComputeFunction& computeFunction)
+        {
+            {
+                glm::ScopedLock<TraceMutex> templatesLock(_GetTemplatesLock());
+                TemplateMap& templates = _GetTemplates();
+                auto itTemplate = templates.find(key.c_str());
+                if (itTemplate != templates.end())
+                {
+                    if (std::shared_ptr<const SkinMeshCharacterTemplateData> templateData = itTemplate->second.templateData.lock())
+                    {
+                        return templateData;
+                    }
+                    templates.erase(itTemplate);
+                }
+            }
+
+            // computed out of the lock: the character geometry parsing can take seconds
+            std::shared_ptr<SkinMeshCharacterTemplateData> computedTemplateData = std::make_shared<SkinMeshCharacterTemplateData>();
+            if (templateFile.empty() || !readFile(templateFile, fileKey, *computedTemplateData))
+            {
+                computedTemplateData->clear();
+                computeFunction(*computedTemplateData);
+                if (!templateFile.empty())
+                {
+                    writeFile(templateFile, fileKey, *computedTemplateData);
+                }
+            }
+
+            glm::ScopedLock<TraceMutex> templatesLock(_GetTemplatesLock());
+            CachedTemplate& cachedTemplate = _GetTemplates()[key.c_str()];
+            if (std::shared_ptr<const SkinMeshCharacterTemplateData> templateData = cachedTemplate.templateData.lock())
+            {
+                // computed meanwhile by another layer: keep a single copy
+                return templateData;
+            }
+            cachedTemplate.templateData = computedTemplateData;
+            cachedTemplate.templateFile = templateFile;
+            return computedTemplateData;
+        }
+
+        /*static*/
+        //-----------------------------------------------------------------------------
+        void SkinMeshTemplateCache::invalidate(const SkinMeshCharacterTemplateData* templateData)
+        {
+            std::string templateFile;
+            {
+                glm::ScopedLock<TraceMutex> templatesLock(_GetTemplatesLock());
+                TemplateMap& templates = _GetTemplates();
+                for (auto itTemplate = templates.begin(); itTemplate != templates.end(); ++itTemplate)
+                {
+                    std::shared_ptr<const SkinMeshCharacterTemplateData> cachedTemplateData = itTemplate->second.templateData.lock();
+                    if (cachedTemplateData.get() == templateData)
+                    {
+                        templateFile = itTemplate->second.templateFile;
+                        templates.erase(itTemplate);
+                        break;
+                    }
+                }
+            }
+            if (!templateFile.empty())
+            {
+                remove(templateFile.c_str());
+            }
+        }
+
+        /*static*/
+        //-----------------------------------------------------------------------------
+        bool SkinMeshTemplateCache::readFile(const std::string& templateFile, uint64_t fileKey, SkinMeshCharacterTemplateData& templateData)
+        {
+            if (!TfIsFile(templateFile))
+            {
+                return false;
+            }
+
+            GLMUSD_ZONE("SkinMeshTemplateCache::ReadFile");
+            std::string errorMessage;
+            ArchConstFileMapping mapping = ArchMapFileReadOnly(templateFile, &errorMessage);
+            if (!mapping)
+            {
+                GLM_CROWD_TRACE_WARNING("Could not map template cache file '" << templateFile << "': " << errorMessage);
+                return false;
+            }
+
+            FileReader reader(mapping.get(), ArchGetFileMappingLength(mapping));
+            FileHeader header;
+            if (!reader.readValue(header) ||
+                memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 ||
+                header.formatVersion != FILE_FORMAT_VERSION ||
+                header.key != fileKey)
+            {
+                GLM_CROWD_TRACE_WARNING("Ignoring invalid template cache file '" << templateFile << "'");
+                return false;
+            }
+
+            bool isValid = true;
+            templateData.resize(header.lodCount);
+            for (uint32_t iLod = 0; iLod < header.lodCount && isValid; ++iLod)
+            {
+                uint32_t meshCount = 0;
+                isValid = reader.readValue(meshCount);
+                for (uint32_t iMesh = 0; iMesh < meshCount && isValid; ++iMesh)
+                {
+                    MeshHeader meshHeader;
+                    const char* faceVertexCounts = NULL;
+                    const char* faceVertexIndices = NULL;
+                    isValid = reader.readValue(meshHeader) &&
+                              (faceVertexCounts = reader.readBytes(meshHeader.faceCount * sizeof(int))) != NULL &&
+                              (faceVertexIndices = reader.readBytes(meshHeader.faceVertexCount * sizeof(int))) != NULL;
+                    if (!isValid)
+                    {
+                        break;
+                    }
+
+                    SkinMeshTemplateData& meshTemplateData = templateData[iLod][{meshHeader.meshAssetIndex, meshHeader.materialIndex}];
+                    meshTemplateData.pointsCount = meshHeader.pointsCount;
+                    meshTemplateData.shadingGroupIdx = meshHeader.shadingGroupIndex;
+                    meshTemplateData.faceVertexCounts.resize(meshHeader.faceCount);
+                    memcpy(meshTemplateData.faceVertexCounts.data(), faceVertexCounts, meshHeader.faceCount * sizeof(int));
+                    meshTemplateData.faceVertexIndices.resize(meshHeader.faceVertexCount);
+                    memcpy(meshTemplateData.faceVertexIndices.data(), faceVertexIndices, meshHeader.faceVertexCount * sizeof(int));
+
+                    meshTemplateData.uvSets.resize(meshHeader.uvSetCount);
+                    for (uint32_t iUVSet = 0; iUVSet < meshHeader.uvSetCount && isValid; ++iUVSet)
+                    {
+                        const char* uvs = reader.readBytes(meshHeader.faceVertexCount * sizeof(GfVec2f));
+                        isValid = uvs != NULL;
+                        if (isValid)
+                        {
+                            VtVec2fArray& uvSet = meshTemplateData.uvSets[iUVSet];
+                            uvSet.resize(meshHeader.faceVertexCount);
+                            memcpy(uvSet.data(), uvs, meshHeader.faceVertexCount * sizeof(GfVec2f));
+                        }
+                    }
+
+                    const char* alias = isValid ? reader.readBytes(meshHeader.aliasLength) : NULL;
+                    isValid = alias != NULL;
+                    if (isValid)
+                    {
+                        meshTemplateData.meshAlias = std::string(alias, meshHeader.aliasLength).c_str();
+                    }
+                }
+            }
+            if (!isValid)
+            {
+                GLM_CROWD_TRACE_WARNING("Ignoring truncated template cache file '" << templateFile << "'");
+                templateData.clear();
+            }
+            return isValid;
+        }
+
+        /*static*/
+        //-----------------------------------------------------------------------------
+        bool SkinMeshTemplateCache::writeFile(const std::string& templateFile, uint64_t fileKey, const SkinMeshCharacterTemplateData& templateData)
+        {
+            GLMUSD_ZONE("SkinMeshTemplateCache::WriteFile");
+            std::string buffer;
+
+            FileHeader header;
+            memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+            header.formatVersion = FILE_FORMAT_VERSION;
+            header.lodCount = (uint32_t)templateData.size();
+            header.key = fileKey;
+            _Write(buffer, &header, sizeof(header));
+
+            for (size_t iLod = 0, lodCount = templateData.size(); iLod < lodCount; ++iLod)
+            {
+                uint32_t meshCount = (uint32_t)templateData[iLod].size();
+                _Write(buffer, &meshCount, sizeof(meshCount));
+                for (const auto& itMesh : templateData[iLod])
+                {
+                    const SkinMeshTemplateData& meshTemplateData = itMesh.second;
+
+                    MeshHeader meshHeader;
+                    meshHeader.meshAssetIndex = itMesh.first.first;
+                    meshHeader.materialIndex = itMesh.first.second;
+                    meshHeader.pointsCount = meshTemplateData.pointsCount;
+                    meshHeader.faceCount = (uint32_t)meshTemplateData.faceVertexCounts.size();
+                    meshHeader.faceVertexCount = (uint32_t)meshTemplateData.faceVertexIndices.size();
+                    meshHeader.uvSetCount = (uint32_t)meshTemplateData.uvSets.size();
+                    meshHeader.aliasLength = (uint32_t)meshTemplateData.meshAlias.length();
+                    meshHeader.shadingGroupIndex = meshTemplateData.shadingGroupIdx;
+                    _Write(buffer, &meshHeader, sizeof(meshHeader));
+
+                    _Write(buffer, meshTemplateData.faceVertexCounts.cdata(), meshHeader.faceCount * sizeof(int));
+                    _Write(buffer, meshTemplateData.faceVertexIndices.cdata(), meshHeader.faceVertexCount * sizeof(int));
+                    for (size_t iUVSet = 0; iUVSet < meshHeader.uvSetCount; ++iUVSet)
+                    {
+                        const VtVec2fArray& uvSet = meshTemplateData.uvSets[iUVSet];
+                        if (uvSet.size() != meshHeader.faceVertexCount)
+                        {
+                            return false;
+                        }
+                        _Write(buffer, uvSet.cdata(), uvSet.size() * sizeof(GfVec2f));
+                    }
+                    _Write(buffer, meshTemplateData.meshAlias.c_str(), meshHeader.aliasLength);
+                }
+            }
+
+            std::string templateDir = TfGetPathName(templateFile);
+            if (!templateDir.empty() && !TfIsDir(templateDir) && !TfMakeDirs(templateDir) && !TfIsDir(templateDir))
+            {
+                GLM_CROWD_TRACE_WARNING("Could not create template cache directory '" << templateDir << "'");
+                return false;
+            }
+
+            // write to a temporary file then rename so that other processes never map a partial file
+            static std::atomic<uint32_t> s_tempFileCounter(0);
+            std::string tempPath = TfStringPrintf("%s.%d.%u.tmp", templateFile.c_str(), ArchGetProcessId(), s_tempFileCounter.fetch_add(1));
+            {
+                std::ofstream outFile(tempPath.c_str(), std::ios::binary | std::ios::trunc);
+                outFile.write(buffer.data(), buffer.size());
+                if (!outFile.good())
+                {
+                    outFile.close();
+                    remove(tempPath.c_str());
+                    GLM_CROWD_TRACE_WARNING("Could not write template cache file '" << tempPath << "'");
+                    return false;
+                }
+            }
+            if (rename(tempPath.c_str(), templateFile.c_str()) != 0)
+            {
+                // another process wrote the same templates first
+                remove(tempPath.c_str());
+            }
+            return true;
+        }
+    } // namespace usdplugin
+} // namespace glm
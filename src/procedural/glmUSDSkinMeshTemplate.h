@@ -0,0 +1,69 @@
+/***************************************************************************
+*                                                                          *
+*  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+*                                                                          *
+***************************************************************************/
+
+#pragma once
+
+#include "glmUSD.h"
+
+USD_INCLUDES_START
+#include <pxr/pxr.h>
+#include <pxr/base/vt/types.h>
+USD_INCLUDES_END
+
+#include <glmCore.h>
+
+#include <functional>
+#include <map>
+#include <memory>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        using namespace PXR_INTERNAL_NS;
+
+        // Topology and uvs of a skin mesh, shared by all the entities of the character.
+        // Materials depend on the layer params: they are resolved by each layer from the shading group
+        struct SkinMeshTemplateData
+        {
+            VtIntArray faceVertexCounts;
+            VtIntArray faceVertexIndices;
+            glm::Array<VtVec2fArray> uvSets; // stored by polygon vertex
+            GlmString meshAlias;
+            int pointsCount;
+            // int normalsCount; // not needed, = faceVertexIndices.size();
+            int shadingGroupIdx = -1;
+        };
+
+        // Templates of a character per lod, per (mesh asset index, material index)
+        typedef glm::Array<std::map<std::pair<int, int>, SkinMeshTemplateData>> SkinMeshCharacterTemplateData;
+
+        /// Process-wide cache of the character templates, so that layers using the same character and geometry tag
+        /// parse the character geometry once and share the topology and uv arrays.
+        /// Templates are released with the last layer using them.
+        /// Templates can also be stored in a sidecar file, written on first use and mapped by the next processes
+        /// instead of parsing the character geometry:
+        ///   FileHeader, then for each lod the mesh count followed by each mesh (MeshHeader, face vertex counts,
+        ///   face vertex indices, uv sets and alias)
+        class SkinMeshTemplateCache
+        {
+        public:
+            typedef std::function<void(SkinMeshCharacterTemplateData&)> ComputeFunction;
+
+            /// Returns the templates of the key, read from templateFile (if not empty) or computed with computeFunction
+            /// if no layer holds them. Computed templates are written to templateFile, fileKey identifies its content
+            static std::shared_ptr<const SkinMeshCharacterTemplateData> acquire(const glm::GlmString& key, const std::string& templateFile, uint64_t fileKey, const ComputeFunction& computeFunction);
+
+            /// Forgets templates which do not match the character geometry anymore, and removes their sidecar file:
+            /// the next acquire computes them again. The layers holding them keep their copy
+            static void invalidate(const SkinMeshCharacterTemplateData* templateData);
+
+            /// Returns false if the file does not exist, is invalid or was written for another key
+            static bool readFile(const std::string& templateFile, uint64_t fileKey, SkinMeshCharacterTemplateData& templateData);
+            static bool writeFile(const std::string& templateFile, uint64_t fileKey, const SkinMeshCharacterTemplateData& templateData);
+        };
+    } // namespace usdplugin
+} // namespace glm
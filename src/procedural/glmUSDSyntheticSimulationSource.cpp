@@ -0,0 +1,399 @@
+/***************************************************************************
+*                                                                          *
+*  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+*                                                                          *
+***************************************************************************/
+
+#include "glmUSDSyntheticSimulationSource.h"
+
+#include <glmLog.h>
+#include <glmCrowdIOUtils.h>
+#include <glmStringOperators.h>
+
+USD_INCLUDES_START
+#include <pxr/base/gf/vec3f.h>
+USD_INCLUDES_END
+
+#include <cfloat>
+#include <cmath>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        //-----------------------------------------------------------------------------
+        static GfVec3f _RotateByQuaternion(const float (&quat)[4], const GfVec3f& vector)
+        {
+            // quaternions are stored as x, y, z, w in the frame data
+            GfVec3f quatAxis(quat[0], quat[1], quat[2]);
+            GfVec3f t = 2.f * GfCross(quatAxis, vector);
+            return vector + quat[3] * t + GfCross(quatAxis, t);
+        }
+
+        // Simulation and frame data generated on request, the frame datas are recycled in a few slots keyed by frame
+        class SyntheticCrowdFieldSource : public CrowdFieldSource
+        {
+        public:
+            SyntheticCrowdFieldSource(const SyntheticSimulationSource::Settings& settings, int crowdFieldIdx);
+            virtual ~SyntheticCrowdFieldSource();
+
+            void getFrameRange(int& firstFrame, int& lastFrame) override;
+            const crowdio::GlmSimulationData* getSimulationData() override;
+            const crowdio::GlmFrameData* getFrameData(double frame) override;
+            const ShaderAssetDataContainer* getShaderData(double frame) override;
+            const glm::Array<glm::PODArray<int>>& getEntityAssets(int frame) override;
+
+        protected:
+            size_t getMaxPinnedFrameCount() const override;
+
+        private:
+            void _generateFrame(double frame, crowdio::GlmFrameData* frameData) const;
+
+            // the devkit caches keep several frames too: frames queried again soon are not generated again
+            static const size_t FRAME_SLOT_COUNT = 8;
+
+            SyntheticSimulationSource::Settings _settings;
+            float _crowdFieldOffset;
+            crowdio::GlmSimulationData* _simuData;
+            crowdio::GlmFrameData* _frameDatas[FRAME_SLOT_COUNT];
+            double _slotFrames[FRAME_SLOT_COUNT];
+            uint64_t _slotLastUses[FRAME_SLOT_COUNT]; // the least recently used slot is recycled first
+            uint64_t _useCounter;
+            ShaderAssetDataContainer _shaderData;
+            glm::Array<glm::PODArray<int>> _entityAssets;
+        };
+
+        //-----------------------------------------------------------------------------
+        SyntheticCrowdFieldSource::SyntheticCrowdFieldSource(const SyntheticSimulationSource::Settings& settings, int crowdFieldIdx)
+            : _settings(settings)
+            , _simuData(NULL)
+            , _useCounter(0)
+        {
+            uint32_t entityCount = _settings.entityCount;
+            uint32_t gridSize = (uint32_t)ceil(sqrt((double)entityCount));
+            // crowd fields are laid out side by side along Z
+            _crowdFieldOffset = crowdFieldIdx * (gridSize + 1) * 2.f;
+
+            crowdio::glmCreateSimulationData(&_simuData, entityCount, 1, 0, 0);
+            _simuData->_framerate = 24.f;
+            _simuData->_boneCount[0] = _settings.boneCount;
+            _simuData->_entityCountPerEntityType[0] = entityCount;
+            _simuData->_iBoneOffsetPerEntityType[0] = 0;
+            _simuData->_snsCountPerEntityType[0] = 0;
+            _simuData->_snsOffsetPerEntityType[0] = 0;
+            for (uint32_t iEntity = 0; iEntity < entityCount; ++iEntity)
+            {
+                _simuData->_entityIds[iEntity] = iEntity + 1;
+                _simuData->_entityTypes[iEntity] = 0;
+                _simuData->_indexInEntityType[iEntity] = iEntity;
+                _simuData->_entityToBakeIndex[iEntity] = iEntity;
+                _simuData->_characterIdx[iEntity] = 0;
+                _simuData->_renderingTypeIdx[iEntity] = 0;
+                _simuData->_scales[iEntity] = 1.f;
+            }
+
+            for (size_t iSlot = 0; iSlot < FRAME_SLOT_COUNT; ++iSlot)
+            {
+                _frameDatas[iSlot] = NULL;
+                crowdio::glmCreateFrameData(&_frameDatas[iSlot], _simuData, 0);
+                _slotFrames[iSlot] = -FLT_MAX;
+                _slotLastUses[iSlot] = 0;
+            }
+
+            // no shader attribute on the synthetic character, no mesh asset on the entities
+            _shaderData.specificShaderAttrCountersPerChar.resize(1);
+            _shaderData.specificShaderAttrCountersPerChar[0].resize(ShaderAttributeType::END, 0);
+            _shaderData.globalToSpecificShaderAttrIdxPerChar.resize(1);
+            _shaderData.intData.resize(entityCount);
+            _shaderData.floatData.resize(entityCount);
+            _shaderData.vectorData.resize(entityCount);
+            _shaderData.stringData.resize(entityCount);
+            _entityAssets.resize(entityCount);
+        }
+
+        //-----------------------------------------------------------------------------
+        SyntheticCrowdFieldSource::~SyntheticCrowdFieldSource()
+        {
+            for (size_t iSlot = 0; iSlot < FRAME_SLOT_COUNT; ++iSlot)
+            {
+                crowdio::glmDestroyFrameData(&_frameDatas[iSlot], _simuData);
+            }
+            crowdio::glmDestroySimulationData(&_simuData);
+        }
+
+        //-----------------------------------------------------------------------------
+        void SyntheticCrowdFieldSource::getFrameRange(int& firstFrame, int& lastFrame)
+        {
+            firstFrame = 1;
+            lastFrame = _settings.frameCount;
+        }
+
+        //-----------------------------------------------------------------------------
+        const crowdio::GlmSimulationData* SyntheticCrowdFieldSource::getSimulationData()
+        {
+            return _simuData;
+        }
+
+        //-----------------------------------------------------------------------------
+        const crowdio::GlmFrameData* SyntheticCrowdFieldSource::getFrameData(double frame)
+        {
+            ++_useCounter;
+            size_t recycledSlot = FRAME_SLOT_COUNT;
+            for (size_t iSlot = 0; iSlot < FRAME_SLOT_COUNT; ++iSlot)
+            {
+                if (_slotFrames[iSlot] == frame)
+                {
+                    _slotLastUses[iSlot] = _useCounter;
+                    return _frameDatas[iSlot];
+                }
+                // the frame datas of the pinned frames are still read by the entities
+                if ((recycledSlot == FRAME_SLOT_COUNT || _slotLastUses[iSlot] < _slotLastUses[recycledSlot]) && !isFramePinned(_slotFrames[iSlot]))
+                {
+                    recycledSlot = iSlot;
+                }
+            }
+            if (recycledSlot == FRAME_SLOT_COUNT)
+            {
+                GLM_CROWD_TRACE_ERROR_LIMIT("All the synthetic frame slots are in use, cannot generate frame " << frame);
+                return NULL;
+            }
+            GLMUSD_ZONE("SyntheticCrowdFieldSource::generateFrame");
+            _generateFrame(frame, _frameDatas[recycledSlot]);
+            _slotFrames[recycledSlot] = frame;
+            _slotLastUses[recycledSlot] = _useCounter;
+            return _frameDatas[recycledSlot];
+        }
+
+        //-----------------------------------------------------------------------------
+        size_t SyntheticCrowdFieldSource::getMaxPinnedFrameCount() const
+        {
+            // the pinned slots are never recycled
+            return FRAME_SLOT_COUNT;
+        }
+
+        //-----------------------------------------------------------------------------
+        const ShaderAssetDataContainer* SyntheticCrowdFieldSource::getShaderData(double /*frame*/)
+        {
+            return &_shaderData;
+        }
+
+        //-----------------------------------------------------------------------------
+        const glm::Array<glm::PODArray<int>>& SyntheticCrowdFieldSource::getEntityAssets(int /*frame*/)
+        {
+            return _entityAssets;
+        }
+
+        //-----------------------------------------------------------------------------
+        void SyntheticCrowdFieldSource::_generateFrame(double frame, crowdio::GlmFrameData* frameData) const
+        {
+            uint32_t entityCount = _settings.entityCount;
+            uint16_t boneCount = _settings.boneCount;
+            uint32_t gridSize = (uint32_t)ceil(sqrt((double)entityCount));
+            float boneHeight = boneCount > 0 ? 1.8f / boneCount : 0.f;
+            float walkedDistance = float(frame - 1) * 0.05f;
+
+            for (uint32_t iEntity = 0; iEntity < entityCount; ++iEntity)
+            {
+                frameData->_entityEnabled[iEntity] = 1;
+
+                float rootX = (iEntity % gridSize) * 2.f + walkedDistance;
+                float rootZ = (iEntity / gridSize) * 2.f + _crowdFieldOffset;
+                // each entity sways with its own phase
+                float phase = float(frame) * 0.1f + iEntity * 0.37f;
+
+                uint32_t boneOffset = iEntity * boneCount;
+                for (uint16_t iBone = 0; iBone < boneCount; ++iBone)
+                {
+                    float(&bonePosition)[3] = frameData->_bonePositions[boneOffset + iBone];
+                    bonePosition[0] = rootX;
+                    bonePosition[1] = iBone * boneHeight;
+                    bonePosition[2] = rootZ;
+
+                    float halfAngle = 0.5f * sinf(phase + iBone * 0.2f) * 0.3f;
+                    float(&boneOrientation)[4] = frameData->_boneOrientations[boneOffset + iBone];
+                    boneOrientation[0] = 0.f;
+                    boneOrientation[1] = sinf(halfAngle);
+                    boneOrientation[2] = 0.f;
+                    boneOrientation[3] = cosf(halfAngle);
+                }
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        SyntheticSimulationSource::Settings SyntheticSimulationSource::Settings::fromString(const glm::GlmString& settings)
+        {
+            Settings result;
+            glm::Array<glm::GlmString> keyValues = glm::stringToStringArray(settings.c_str(), ";");
+            for (size_t iKeyValue = 0, keyValueCount = keyValues.size(); iKeyValue < keyValueCount; ++iKeyValue)
+            {
+                glm::Array<glm::GlmString> keyValue = glm::stringToStringArray(keyValues[iKeyValue].c_str(), "=");
+                if (keyValue.size() != 2)
+                {
+                    continue;
+                }
+                keyValue[0].trim();
+                int value = atoi(keyValue[1].c_str());
+                if (value < 0)
+                {
+                    GLM_CROWD_TRACE_WARNING("Invalid glmSyntheticCrowd value for '" << keyValue[0] << "': " << value);
+                    continue;
+                }
+                if (keyValue[0] == "entities")
+                {
+                    result.entityCount = (uint32_t)value;
+                }
+                else if (keyValue[0] == "bones")
+                {
+                    result.boneCount = (uint16_t)glm::max(1, glm::min(value, (int)UINT16_MAX));
+                }
+                else if (keyValue[0] == "vertices")
+                {
+                    result.vertexCount = (uint32_t)value;
+                }
+                else if (keyValue[0] == "frames")
+                {
+                    result.frameCount = glm::max(1, value);
+                }
+                else
+                {
+                    GLM_CROWD_TRACE_WARNING("Unknown glmSyntheticCrowd key '" << keyValue[0] << "'");
+                }
+            }
+            return result;
+        }
+
+        //-----------------------------------------------------------------------------
+        SyntheticSimulationSource::SyntheticSimulationSource(const Settings& settings)
+            : _settings(settings)
+            , _character(new GolaemCharacter())
+        {
+            // the character has no skeleton nor mesh asset, it only needs a default rendering type
+            _character->_name = "SyntheticCharacter";
+            _character->_renderingTypes.resize(1);
+
+            // the strip needs at least 2 levels
+            uint32_t levelCount = glm::max(2u, (_settings.vertexCount + 1) / 2);
+            _proxyFaceVertexCounts.assign(levelCount - 1, 4);
+            _proxyFaceVertexIndices.reserve((levelCount - 1) * 4);
+            for (uint32_t iLevel = 0; iLevel + 1 < levelCount; ++iLevel)
+            {
+                _proxyFaceVertexIndices.push_back(iLevel * 2);
+                _proxyFaceVertexIndices.push_back(iLevel * 2 + 1);
+                _proxyFaceVertexIndices.push_back(iLevel * 2 + 3);
+                _proxyFaceVertexIndices.push_back(iLevel * 2 + 2);
+            }
+            _proxyVertexBones.resize(levelCount * 2);
+            for (uint32_t iLevel = 0; iLevel < levelCount; ++iLevel)
+            {
+                uint16_t boneIdx = (uint16_t)(iLevel * _settings.boneCount / levelCount);
+                _proxyVertexBones[iLevel * 2] = boneIdx;
+                _proxyVertexBones[iLevel * 2 + 1] = boneIdx;
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        SyntheticSimulationSource::~SyntheticSimulationSource()
+        {
+            for (const auto& itCrowdField : _crowdFields)
+            {
+                delete itCrowdField.second;
+            }
+            _crowdFields.clear();
+            delete _character;
+        }
+
+        //-----------------------------------------------------------------------------
+        void SyntheticSimulationSource::loadCharacters(const glm::GlmString& /*characterFiles*/)
+        {
+        }
+
+        //-----------------------------------------------------------------------------
+        void SyntheticSimulationSource::loadLayouts(const glm::Array<glm::GlmString>& /*layoutFiles*/)
+        {
+        }
+
+        //-----------------------------------------------------------------------------
+        void SyntheticSimulationSource::loadTerrains(const glm::GlmString& /*srcTerrainFile*/, const glm::GlmString& /*dstTerrainFile*/)
+        {
+        }
+
+        //-----------------------------------------------------------------------------
+        void SyntheticSimulationSource::getDefaultCrowdFieldNames(glm::Array<glm::GlmString>& crowdFieldNames) const
+        {
+            crowdFieldNames.clear();
+            crowdFieldNames.push_back("syntheticCrowdField");
+        }
+
+        //-----------------------------------------------------------------------------
+        CrowdFieldSource* SyntheticSimulationSource::getCrowdField(const glm::GlmString& /*cacheDir*/, const glm::GlmString& /*cacheName*/, const glm::GlmString& crowdFieldName)
+        {
+            CrowdFieldSource*& crowdField = _crowdFields[crowdFieldName];
+            if (crowdField == NULL)
+            {
+                crowdField = new SyntheticCrowdFieldSource(_settings, (int)_crowdFields.size() - 1);
+            }
+            return crowdField;
+        }
+
+        //-----------------------------------------------------------------------------
+        int SyntheticSimulationSource::getCharacterCount() const
+        {
+            return 1;
+        }
+
+        //-----------------------------------------------------------------------------
+        const GolaemCharacter* SyntheticSimulationSource::getCharacter(int characterIdx) const
+        {
+            return characterIdx == 0 ? _character : NULL;
+        }
+
+        //-----------------------------------------------------------------------------
+        bool SyntheticSimulationSource::hasCharacterGeometry() const
+        {
+            return false;
+        }
+
+        //-----------------------------------------------------------------------------
+        bool SyntheticSimulationSource::prepareEntityGeometry(crowdio::InputEntityGeoData* /*inputGeoData*/, crowdio::OutputEntityGeoData* /*outputGeoData*/)
+        {
+            return false;
+        }
+
+        //-----------------------------------------------------------------------------
+        bool SyntheticSimulationSource::getProxyMeshTopology(VtIntArray& faceVertexCounts, VtIntArray& faceVertexIndices, size_t& pointsCount) const
+        {
+            faceVertexCounts = _proxyFaceVertexCounts;
+            faceVertexIndices = _proxyFaceVertexIndices;
+            pointsCount = _proxyVertexBones.size();
+            return true;
+        }
+
+        //-----------------------------------------------------------------------------
+        void SyntheticSimulationSource::deformProxyMesh(const crowdio::InputEntityGeoData& inputGeoData, uint32_t bonePositionOffset, VtVec3fArray& points, VtVec3fArray& normals) const
+        {
+            const crowdio::GlmFrameData* frameData = inputGeoData._frameDatas[0];
+            // points are relative to the entity root
+            GfVec3f rootPos(frameData->_bonePositions[bonePositionOffset]);
+
+            size_t pointsCount = _proxyVertexBones.size();
+            points.resize(pointsCount);
+            GfVec3f* pointsData = points.data();
+            for (size_t iVertex = 0; iVertex < pointsCount; ++iVertex)
+            {
+                uint32_t boneIdx = bonePositionOffset + _proxyVertexBones[iVertex];
+                GfVec3f bonePos(frameData->_bonePositions[boneIdx]);
+                GfVec3f localOffset(iVertex % 2 == 0 ? -0.2f : 0.2f, 0.f, 0.f);
+                pointsData[iVertex] = bonePos - rootPos + _RotateByQuaternion(frameData->_boneOrientations[boneIdx], localOffset);
+            }
+
+            // normals are stored by polygon vertex
+            normals.resize(_proxyFaceVertexIndices.size());
+            GfVec3f* normalsData = normals.data();
+            for (size_t iFaceVertex = 0, faceVertexCount = _proxyFaceVertexIndices.size(); iFaceVertex < faceVertexCount; ++iFaceVertex)
+            {
+                uint32_t boneIdx = bonePositionOffset + _proxyVertexBones[_proxyFaceVertexIndices[iFaceVertex]];
+                normalsData[iFaceVertex] = _RotateByQuaternion(frameData->_boneOrientations[boneIdx], GfVec3f(0.f, 0.f, 1.f));
+            }
+        }
+    } // namespace usdplugin
+} // namespace glm
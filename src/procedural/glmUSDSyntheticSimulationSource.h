@@ -0,0 +1,61 @@
+/***************************************************************************
+*                                                                          *
+*  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+*                                                                          *
+***************************************************************************/
+
+#pragma once
+
+#include "glmUSDSimulationSource.h"
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        // Procedural crowd with no external assets, used to profile and test the layer at any scale.
+        // Each entity walks along X on a grid, its bones are stacked along Y and sway around Y.
+        class SyntheticSimulationSource : public SimulationSource
+        {
+        public:
+            struct Settings
+            {
+                uint32_t entityCount = 1000;
+                uint16_t boneCount = 20;
+                uint32_t vertexCount = 64; // vertices of the proxy mesh of each entity
+                int frameCount = 100;      // frames 1 to frameCount
+
+                // Parses "entities=1000;bones=20;vertices=64;frames=100", missing keys keep their default value
+                static Settings fromString(const glm::GlmString& settings);
+            };
+
+            SyntheticSimulationSource(const Settings& settings);
+            virtual ~SyntheticSimulationSource();
+
+            void loadCharacters(const glm::GlmString& characterFiles) override;
+            void loadLayouts(const glm::Array<glm::GlmString>& layoutFiles) override;
+            void loadTerrains(const glm::GlmString& srcTerrainFile, const glm::GlmString& dstTerrainFile) override;
+
+            void getDefaultCrowdFieldNames(glm::Array<glm::GlmString>& crowdFieldNames) const override;
+            CrowdFieldSource* getCrowdField(const glm::GlmString& cacheDir, const glm::GlmString& cacheName, const glm::GlmString& crowdFieldName) override;
+
+            int getCharacterCount() const override;
+            const GolaemCharacter* getCharacter(int characterIdx) const override;
+
+            bool hasCharacterGeometry() const override;
+            bool prepareEntityGeometry(crowdio::InputEntityGeoData* inputGeoData, crowdio::OutputEntityGeoData* outputGeoData) override;
+
+            bool getProxyMeshTopology(VtIntArray& faceVertexCounts, VtIntArray& faceVertexIndices, size_t& pointsCount) const override;
+            void deformProxyMesh(const crowdio::InputEntityGeoData& inputGeoData, uint32_t bonePositionOffset, VtVec3fArray& points, VtVec3fArray& normals) const override;
+
+        private:
+            Settings _settings;
+            GolaemCharacter* _character;
+            GlmMap<glm::GlmString, CrowdFieldSource*> _crowdFields;
+
+            // proxy mesh: a vertical strip of quads, two vertices per level
+            VtIntArray _proxyFaceVertexCounts;
+            VtIntArray _proxyFaceVertexIndices;
+            glm::PODArray<uint16_t> _proxyVertexBones;
+        };
+    } // namespace usdplugin
+} // namespace glm
@@ -0,0 +1,618 @@
+/***************************************************************************
+*                                                                          *
+*  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+*                                                                          *
+***************************************************************************/
+
+// Bakes a Golaem procedural layer to a binary usdc file.
+// Frames are computed in parallel by chunks, one entity per task, then written to the output layer
+// or, with --clips, to one value clip file per chunk.
+// A single output layer keeps all the baked frames in memory until it is saved: only the clips bound the memory,
+// they are used by default for long frame ranges.
+
+#include "glmUsdToolUtils.h"
+
+USD_INCLUDES_START
+#include <pxr/base/plug/registry.h>
+#include <pxr/base/tf/pathUtils.h>
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/base/vt/dictionary.h>
+#include <pxr/usd/sdf/assetPath.h>
+#include <pxr/usd/sdf/attributeSpec.h>
+#include <pxr/usd/sdf/copyUtils.h>
+#include <pxr/usd/sdf/fileFormat.h>
+#include <pxr/usd/sdf/primSpec.h>
+#include <pxr/usd/sdf/schema.h>
+#include <pxr/usd/usd/clipsAPI.h>
+#include <pxr/usd/usd/tokens.h>
+USD_INCLUDES_END
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        namespace tools
+        {
+            // longest frame range baked to a single file by default, the memory used grows with the baked frames
+            const int MAX_SINGLE_FILE_FRAMES = 100;
+
+            struct BakeSettings
+            {
+                std::string layerPath;
+                std::string pluginPath;
+                std::string outputPath;
+                SdfLayer::FileFormatArguments args;
+                int startFrame = INT_MIN; // INT_MIN: use the layer frame range
+                int endFrame = INT_MIN;
+                EntityIdRanges entityIds; // empty: all entities
+                int threadCount = (int)std::max(1u, std::thread::hardware_concurrency());
+                int chunkSize = 0;   // frames computed before being written, 0: 10 frames, or 1 frame per clip
+                bool clips = false;  // writes value clips instead of a single file
+                bool singleFile = false; // no value clips even for long frame ranges
+                int writerCount = 2; // clip files written in parallel with the compute
+            };
+
+            //-----------------------------------------------------------------------------
+            static void printUsage()
+            {
+                std::cerr << "Usage: glmUsdBake [options] --output file.usdc [layer.glmusd]\n"
+                          << "  Without a layer file, an anonymous procedural layer is created from the --param values.\n"
+                          << "  --param name=value    Golaem USD parameter, can be repeated (e.g. --param glmCacheLibFile=/path/lib.gcl)\n"
+                          << "  --plugin-path dir     directory of the GolaemUSD plugInfo.json if not in PXR_PLUGINPATH_NAME\n"
+                          << "  --output file.usdc    output file\n"
+                          << "  --frames start:end    baked frame range (default: layer range)\n"
+                          << "  --entities ids        baked entity ids and id ranges, e.g. 1,4,10-20 (default: all)\n"
+                          << "  --threads count       compute thread count (default: hardware threads)\n"
+                          << "  --chunk-size frames   frames computed before being written, frames per clip (default: 10, 1 with --clips)\n"
+                          << "  --clips               write a root layer with value clips, a topology layer, a clip manifest and one usdc file per chunk\n"
+                          << "                        (default above " << MAX_SINGLE_FILE_FRAMES << " frames: a single file keeps all the frames in memory)\n"
+                          << "  --single-file         write a single file whatever the frame range\n"
+                          << "  --writers count       clip files written in parallel with the compute (default: 2)\n";
+            }
+
+            //-----------------------------------------------------------------------------
+            static bool parseArgs(int argc, char** argv, BakeSettings& settings)
+            {
+                for (int iArg = 1; iArg < argc; ++iArg)
+                {
+                    std::string arg = argv[iArg];
+                    bool hasValue = iArg + 1 < argc;
+                    if (arg == "--param" && hasValue)
+                    {
+                        if (!parseParamArg(argv[++iArg], settings.args))
+                        {
+                            std::cerr << "Invalid --param value '" << argv[iArg] << "', expected name=value\n";
+                            return false;
+                        }
+                    }
+                    else if (arg == "--plugin-path" && hasValue)
+                    {
+                        settings.pluginPath = argv[++iArg];
+                    }
+                    else if (arg == "--output" && hasValue)
+                    {
+                        settings.outputPath = argv[++iArg];
+                    }
+                    else if (arg == "--frames" && hasValue)
+                    {
+                        if (!parseFrameRangeArg(argv[++iArg], settings.startFrame, settings.endFrame))
+                        {
+                            std::cerr << "Invalid --frames value '" << argv[iArg] << "', expected start:end\n";
+                            return false;
+                        }
+                    }
+                    else if (arg == "--entities" && hasValue)
+                    {
+                        if (!parseEntityIdsArg(argv[++iArg], settings.entityIds))
+                        {
+                            std::cerr << "Invalid --entities value '" << argv[iArg] << "', expected ids and id ranges like 1,4,10-20\n";
+                            return false;
+                        }
+                    }
+                    else if (arg == "--threads" && hasValue)
+                    {
+                        settings.threadCount = std::max(1, atoi(argv[++iArg]));
+                    }
+                    else if (arg == "--chunk-size" && hasValue)
+                    {
+                        settings.chunkSize = std::max(1, atoi(argv[++iArg]));
+                    }
+                    else if (arg == "--clips")
+                    {
+                        settings.clips = true;
+                    }
+                    else if (arg == "--single-file")
+                    {
+                        settings.singleFile = true;
+                    }
+                    else if (arg == "--writers" && hasValue)
+                    {
+                        settings.writerCount = std::max(1, atoi(argv[++iArg]));
+                    }
+                    else if (!arg.empty() && arg[0] != '-' && settings.layerPath.empty())
+                    {
+                        settings.layerPath = arg;
+                    }
+                    else
+                    {
+                        std::cerr << "Unknown or incomplete argument '" << arg << "'\n";
+                        return false;
+                    }
+                }
+                if (settings.outputPath.empty())
+                {
+                    std::cerr << "Missing --output\n";
+                    return false;
+                }
+                if (settings.clips && settings.singleFile)
+                {
+                    std::cerr << "--clips and --single-file are exclusive\n";
+                    return false;
+                }
+                return true;
+            }
+
+            // Animated values of a chunk of frames
+            struct BakeChunk
+            {
+                int startFrame = 0;
+                int frameCount = 0;
+                std::vector<VtValue> values; // values[iPath * frameCount + iFrame]
+            };
+
+            // Copies the static specs of a procedural layer and computes its animated attributes by chunks
+            class Baker
+            {
+            public:
+                Baker(const SdfLayerHandle& srcLayer, const BakeSettings& settings)
+                    : _srcLayer(srcLayer)
+                    , _settings(settings)
+                {
+                }
+
+                // Copies the layer metadata (time codes, frame rate, default prim...)
+                void copyLayerMetadata(const SdfLayerHandle& dstLayer) const;
+
+                // Copies the specs of the selected entities and their non animated values, then lists the animated attributes
+                bool copyStaticData(const SdfLayerHandle& dstLayer);
+
+                // Creates the specs of the animated attributes with no value, variant selections are stripped from the paths
+                // (clip layers and clip manifests only hold namespace paths)
+                void createClipAttributeSpecs(const SdfLayerHandle& clipLayer) const;
+
+                // Computes the animated values of the frames [startFrame, startFrame + frameCount)
+                void computeChunk(int startFrame, int frameCount, BakeChunk& chunk) const;
+
+                // Writes the chunk values as time samples of dstLayer, at the clip paths if clipLayer is true
+                void writeChunk(const BakeChunk& chunk, const SdfLayerHandle& dstLayer, bool clipLayer) const;
+
+                size_t getAnimatedAttributeCount() const { return _animatedPaths.size(); }
+
+            private:
+                bool _isEntityExcluded(const TfToken& primName) const;
+                static bool _isRuntimeStatsProperty(const TfToken& propertyName);
+
+                SdfLayerHandle _srcLayer;
+                const BakeSettings& _settings;
+
+                // animated attributes sorted by entity, an entity group is a range of _animatedPaths
+                std::vector<SdfPath> _animatedPaths;
+                std::vector<SdfPath> _clipPaths;
+                std::vector<TfToken> _animatedTypeNames;
+                std::vector<std::pair<size_t, size_t>> _entityGroups;
+            };
+
+            //-----------------------------------------------------------------------------
+            bool Baker::_isEntityExcluded(const TfToken& primName) const
+            {
+                if (_settings.entityIds.empty())
+                {
+                    return false;
+                }
+                int64_t entityId = getEntityIdFromPrimName(primName.GetString());
+                return entityId >= 0 && !isEntityIdInRanges(_settings.entityIds, entityId);
+            }
+
+            /*static*/
+            //-----------------------------------------------------------------------------
+            bool Baker::_isRuntimeStatsProperty(const TfToken& propertyName)
+            {
+                // memory and performance counters of the baking process: they would differ between bakes of the same input
+                return TfStringStartsWith(propertyName.GetString(), "glmMemory:") || TfStringStartsWith(propertyName.GetString(), "glmStats:");
+            }
+
+            //-----------------------------------------------------------------------------
+            void Baker::copyLayerMetadata(const SdfLayerHandle& dstLayer) const
+            {
+                const SdfPath& rootPath = SdfPath::AbsoluteRootPath();
+                for (const TfToken& field : _srcLayer->ListFields(rootPath))
+                {
+                    if (field != SdfChildrenKeys->PrimChildren)
+                    {
+                        dstLayer->SetField(rootPath, field, _srcLayer->GetField(rootPath, field));
+                    }
+                }
+            }
+
+            //-----------------------------------------------------------------------------
+            bool Baker::copyStaticData(const SdfLayerHandle& dstLayer)
+            {
+                copyLayerMetadata(dstLayer);
+
+                // generic lambdas: the optional type of the copy callbacks depends on the USD version
+                auto shouldCopyValue = [](SdfSpecType, const TfToken& field, const SdfLayerHandle&, const SdfPath&, bool, const SdfLayerHandle&, const SdfPath&, bool, auto*) {
+                    // time samples are written by chunks, querying them here would compute every frame serially
+                    return field != SdfFieldKeys->TimeSamples;
+                };
+                auto shouldCopyChildren = [this](const TfToken& childrenField, const SdfLayerHandle& srcLayer, const SdfPath& srcPath, bool fieldInSrc, const SdfLayerHandle&, const SdfPath&, bool, auto* srcChildren, auto* dstChildren) {
+                    if (!fieldInSrc)
+                    {
+                        return true;
+                    }
+                    if (childrenField == SdfChildrenKeys->PropertyChildren)
+                    {
+                        std::vector<TfToken> propertyChildren = srcLayer->GetFieldAs<std::vector<TfToken>>(srcPath, childrenField);
+                        if (std::any_of(propertyChildren.begin(), propertyChildren.end(), _isRuntimeStatsProperty))
+                        {
+                            // not even read: the memory attributes compute a report of the process
+                            propertyChildren.erase(std::remove_if(propertyChildren.begin(), propertyChildren.end(), _isRuntimeStatsProperty), propertyChildren.end());
+                            *srcChildren = VtValue(propertyChildren);
+                            *dstChildren = VtValue(propertyChildren);
+                        }
+                        return true;
+                    }
+                    if (childrenField != SdfChildrenKeys->PrimChildren || _settings.entityIds.empty())
+                    {
+                        return true;
+                    }
+                    std::vector<TfToken> primChildren = srcLayer->GetFieldAs<std::vector<TfToken>>(srcPath, childrenField);
+                    primChildren.erase(std::remove_if(primChildren.begin(), primChildren.end(), [this](const TfToken& primName) { return _isEntityExcluded(primName); }), primChildren.end());
+                    *srcChildren = VtValue(primChildren);
+                    *dstChildren = VtValue(primChildren);
+                    return true;
+                };
+                for (const SdfPrimSpecHandle& rootPrim : _srcLayer->GetRootPrims())
+                {
+                    if (!SdfCopySpec(_srcLayer, rootPrim->GetPath(), dstLayer, rootPrim->GetPath(), shouldCopyValue, shouldCopyChildren))
+                    {
+                        std::cerr << "Could not copy '" << rootPrim->GetPath() << "'\n";
+                        return false;
+                    }
+                }
+
+                // list the animated attributes of the copied specs, grouped by entity so that each entity is computed by one thread
+                _animatedPaths.clear();
+                _clipPaths.clear();
+                _animatedTypeNames.clear();
+                _entityGroups.clear();
+                SdfPath groupEntityPath;
+                _srcLayer->Traverse(SdfPath::AbsoluteRootPath(), [&](const SdfPath& path) {
+                    if (!path.IsPropertyPath() || !dstLayer->HasSpec(path) || _srcLayer->GetNumTimeSamplesForPath(path) == 0)
+                    {
+                        return;
+                    }
+                    SdfPath entityPath;
+                    for (SdfPath prefix = path.GetPrimPath(); !prefix.IsAbsoluteRootPath() && !prefix.IsEmpty(); prefix = prefix.GetParentPath())
+                    {
+                        if (getEntityIdFromPrimName(prefix.GetName()) >= 0)
+                        {
+                            entityPath = prefix;
+                            break;
+                        }
+                    }
+                    if (_entityGroups.empty() || entityPath.IsEmpty() || entityPath != groupEntityPath)
+                    {
+                        _entityGroups.push_back({_animatedPaths.size(), _animatedPaths.size()});
+                        groupEntityPath = entityPath;
+                    }
+                    _animatedPaths.push_back(path);
+                    _clipPaths.push_back(path.StripAllVariantSelections());
+                    _animatedTypeNames.push_back(_srcLayer->GetFieldAs<TfToken>(path, SdfFieldKeys->TypeName));
+                    _entityGroups.back().second = _animatedPaths.size();
+                });
+                return true;
+            }
+
+            //-----------------------------------------------------------------------------
+            void Baker::createClipAttributeSpecs(const SdfLayerHandle& clipLayer) const
+            {
+                for (size_t iPath = 0, pathCount = _clipPaths.size(); iPath < pathCount; ++iPath)
+                {
+                    const SdfPath& clipPath = _clipPaths[iPath];
+                    SdfPrimSpecHandle primSpec = SdfCreatePrimInLayer(clipLayer, clipPath.GetPrimPath());
+                    if (primSpec && !clipLayer->HasSpec(clipPath))
+                    {
+                        SdfAttributeSpec::New(primSpec, clipPath.GetName(), SdfSchema::GetInstance().FindType(_animatedTypeNames[iPath]), SdfVariabilityVarying);
+                    }
+                }
+            }
+
+            //-----------------------------------------------------------------------------
+            void Baker::computeChunk(int startFrame, int frameCount, BakeChunk& chunk) const
+            {
+                chunk.startFrame = startFrame;
+                chunk.frameCount = frameCount;
+                chunk.values.clear();
+                chunk.values.resize(_animatedPaths.size() * frameCount);
+
+                // entities only keep their last computed frame: each task computes all the frames of one entity
+                std::atomic<size_t> nextGroup(0);
+                auto computeGroups = [this, &nextGroup, &chunk]() {
+                    for (size_t iGroup = nextGroup++; iGroup < _entityGroups.size(); iGroup = nextGroup++)
+                    {
+                        const std::pair<size_t, size_t>& group = _entityGroups[iGroup];
+                        for (int iFrame = 0; iFrame < chunk.frameCount; ++iFrame)
+                        {
+                            double frame = chunk.startFrame + iFrame;
+                            for (size_t iPath = group.first; iPath < group.second; ++iPath)
+                            {
+                                _srcLayer->QueryTimeSample(_animatedPaths[iPath], frame, &chunk.values[iPath * chunk.frameCount + iFrame]);
+                            }
+                        }
+                    }
+                };
+                std::vector<std::thread> threads;
+                for (int iThread = 1; iThread < _settings.threadCount; ++iThread)
+                {
+                    threads.emplace_back(computeGroups);
+                }
+                computeGroups();
+                for (std::thread& thread : threads)
+                {
+                    thread.join();
+                }
+            }
+
+            //-----------------------------------------------------------------------------
+            void Baker::writeChunk(const BakeChunk& chunk, const SdfLayerHandle& dstLayer, bool clipLayer) const
+            {
+                const std::vector<SdfPath>& dstPaths = clipLayer ? _clipPaths : _animatedPaths;
+                for (size_t iPath = 0, pathCount = dstPaths.size(); iPath < pathCount; ++iPath)
+                {
+                    for (int iFrame = 0; iFrame < chunk.frameCount; ++iFrame)
+                    {
+                        const VtValue& value = chunk.values[iPath * chunk.frameCount + iFrame];
+                        if (!value.IsEmpty())
+                        {
+                            dstLayer->SetTimeSample(dstPaths[iPath], chunk.startFrame + iFrame, value);
+                        }
+                    }
+                }
+            }
+
+            //-----------------------------------------------------------------------------
+            static SdfLayerRefPtr createOutputLayer(const std::string& filePath)
+            {
+                // .usd files default to the text format otherwise
+                SdfLayer::FileFormatArguments args;
+                if (SdfFileFormat::GetFileExtension(filePath) == "usd")
+                {
+                    args["format"] = "usdc";
+                }
+                SdfLayerRefPtr layer = SdfLayer::CreateNew(filePath, args);
+                if (!layer)
+                {
+                    std::cerr << "Could not create '" << filePath << "'\n";
+                }
+                return layer;
+            }
+
+            //-----------------------------------------------------------------------------
+            static bool saveOutputLayer(const SdfLayerRefPtr& layer)
+            {
+                if (!layer->Save())
+                {
+                    std::cerr << "Could not save '" << layer->GetRealPath() << "'\n";
+                    return false;
+                }
+                return true;
+            }
+
+            //-----------------------------------------------------------------------------
+            // All the frames stay in memory until the layer is saved
+            static bool bakeMonolithic(Baker& baker, const BakeSettings& settings, int startFrame, int endFrame)
+            {
+                SdfLayerRefPtr dstLayer = createOutputLayer(settings.outputPath);
+                if (!dstLayer || !baker.copyStaticData(dstLayer))
+                {
+                    return false;
+                }
+                dstLayer->SetStartTimeCode(startFrame);
+                dstLayer->SetEndTimeCode(endFrame);
+                std::cerr << "Baking " << baker.getAnimatedAttributeCount() << " animated attributes, frames " << startFrame << " to " << endFrame << "\n";
+
+                int chunkSize = settings.chunkSize > 0 ? settings.chunkSize : 10;
+                BakeChunk chunk;
+                for (int chunkStartFrame = startFrame; chunkStartFrame <= endFrame; chunkStartFrame += chunkSize)
+                {
+                    baker.computeChunk(chunkStartFrame, std::min(chunkSize, endFrame - chunkStartFrame + 1), chunk);
+                    baker.writeChunk(chunk, dstLayer, false);
+                    std::cerr << "Baked frames " << chunk.startFrame << " to " << chunk.startFrame + chunk.frameCount - 1 << "\n";
+                }
+                return saveOutputLayer(dstLayer);
+            }
+
+            //-----------------------------------------------------------------------------
+            // Writes <output> with the clip metadata, <output>.topology.usdc with the static data,
+            // <output>.manifest.usdc and one <output>.clip.<frame>.usdc per chunk
+            static bool bakeClips(Baker& baker, const SdfLayerHandle& srcLayer, const BakeSettings& settings, int startFrame, int endFrame)
+            {
+                std::string basePath = TfStringGetBeforeSuffix(settings.outputPath);
+                std::string topologyPath = basePath + ".topology.usdc";
+                std::string manifestPath = basePath + ".manifest.usdc";
+
+                // static data
+                SdfLayerRefPtr topologyLayer = createOutputLayer(topologyPath);
+                if (!topologyLayer || !baker.copyStaticData(topologyLayer))
+                {
+                    return false;
+                }
+                topologyLayer->SetStartTimeCode(startFrame);
+                topologyLayer->SetEndTimeCode(endFrame);
+                if (!saveOutputLayer(topologyLayer))
+                {
+                    return false;
+                }
+                topologyLayer.Reset();
+
+                // manifest: the animated attributes with no value
+                SdfLayerRefPtr manifestLayer = createOutputLayer(manifestPath);
+                if (!manifestLayer)
+                {
+                    return false;
+                }
+                baker.createClipAttributeSpecs(manifestLayer);
+                if (!saveOutputLayer(manifestLayer))
+                {
+                    return false;
+                }
+                manifestLayer.Reset();
+                std::cerr << "Baking " << baker.getAnimatedAttributeCount() << " animated attributes as clips, frames " << startFrame << " to " << endFrame << "\n";
+
+                // clips: computed chunk by chunk, written by a bounded pool of writers while the next chunks are computed
+                int chunkSize = settings.chunkSize > 0 ? settings.chunkSize : 1;
+                VtArray<SdfAssetPath> clipAssetPaths;
+                VtVec2dArray clipActive;
+                VtVec2dArray clipTimes;
+                std::deque<std::thread> writers;
+                std::atomic<bool> writeFailed(false);
+                for (int chunkStartFrame = startFrame; chunkStartFrame <= endFrame; chunkStartFrame += chunkSize)
+                {
+                    std::shared_ptr<BakeChunk> chunk = std::make_shared<BakeChunk>();
+                    baker.computeChunk(chunkStartFrame, std::min(chunkSize, endFrame - chunkStartFrame + 1), *chunk);
+
+                    std::string clipPath = basePath + TfStringPrintf(".clip.%04d.usdc", chunkStartFrame);
+                    clipActive.push_back(GfVec2d(chunkStartFrame, (double)clipAssetPaths.size()));
+                    clipAssetPaths.push_back(SdfAssetPath("./" + TfGetBaseName(clipPath)));
+                    for (int iFrame = 0; iFrame < chunk->frameCount; ++iFrame)
+                    {
+                        clipTimes.push_back(GfVec2d(chunkStartFrame + iFrame, chunkStartFrame + iFrame));
+                    }
+
+                    if (writers.size() >= (size_t)settings.writerCount)
+                    {
+                        writers.front().join();
+                        writers.pop_front();
+                    }
+                    writers.emplace_back([&baker, &writeFailed, chunk, clipPath]() {
+                        SdfLayerRefPtr clipLayer = createOutputLayer(clipPath);
+                        if (!clipLayer)
+                        {
+                            writeFailed = true;
+                            return;
+                        }
+                        baker.createClipAttributeSpecs(clipLayer);
+                        baker.writeChunk(*chunk, clipLayer, true);
+                        clipLayer->SetStartTimeCode(chunk->startFrame);
+                        clipLayer->SetEndTimeCode(chunk->startFrame + chunk->frameCount - 1);
+                        if (!saveOutputLayer(clipLayer))
+                        {
+                            writeFailed = true;
+                        }
+                    });
+                    std::cerr << "Baked frames " << chunk->startFrame << " to " << chunk->startFrame + chunk->frameCount - 1 << "\n";
+                }
+                for (std::thread& writer : writers)
+                {
+                    writer.join();
+                }
+                if (writeFailed)
+                {
+                    return false;
+                }
+
+                // root layer: sublayers the topology and adds the clips on the root prims
+                SdfLayerRefPtr rootLayer = createOutputLayer(settings.outputPath);
+                if (!rootLayer)
+                {
+                    return false;
+                }
+                baker.copyLayerMetadata(rootLayer);
+                rootLayer->SetStartTimeCode(startFrame);
+                rootLayer->SetEndTimeCode(endFrame);
+                rootLayer->SetSubLayerPaths({"./" + TfGetBaseName(topologyPath)});
+                for (const SdfPrimSpecHandle& srcRootPrim : srcLayer->GetRootPrims())
+                {
+                    SdfPrimSpecHandle rootPrim = SdfCreatePrimInLayer(rootLayer, srcRootPrim->GetPath());
+                    VtDictionary clipSet;
+                    clipSet[UsdClipsAPIInfoKeys->assetPaths] = VtValue(clipAssetPaths);
+                    clipSet[UsdClipsAPIInfoKeys->primPath] = VtValue(srcRootPrim->GetPath().GetString());
+                    clipSet[UsdClipsAPIInfoKeys->manifestAssetPath] = VtValue(SdfAssetPath("./" + TfGetBaseName(manifestPath)));
+                    clipSet[UsdClipsAPIInfoKeys->active] = VtValue(clipActive);
+                    clipSet[UsdClipsAPIInfoKeys->times] = VtValue(clipTimes);
+                    VtDictionary clips;
+                    clips[UsdClipsAPISetNames->default_] = VtValue(clipSet);
+                    rootPrim->SetInfo(UsdTokens->clips, VtValue(clips));
+                }
+                return saveOutputLayer(rootLayer);
+            }
+
+            //-----------------------------------------------------------------------------
+            static int runBake(const BakeSettings& settings)
+            {
+                if (!settings.pluginPath.empty())
+                {
+                    PlugRegistry::GetInstance().RegisterPlugins(settings.pluginPath);
+                }
+                if (!SdfFileFormat::FindByExtension("glmusd"))
+                {
+                    std::cerr << "The Golaem USD file format plugin could not be found, use --plugin-path or PXR_PLUGINPATH_NAME\n";
+                    return 1;
+                }
+
+                uint64_t bakeStartNs = nowNs();
+                SdfLayerRefPtr srcLayer = openProceduralLayer(settings.layerPath, settings.args, std::string());
+                if (!srcLayer)
+                {
+                    std::cerr << "Could not open the procedural layer '" << settings.layerPath << "'\n";
+                    return 1;
+                }
+
+                int startFrame = settings.startFrame;
+                int endFrame = settings.endFrame;
+                if (startFrame == INT_MIN)
+                {
+                    getLayerFrameRange(srcLayer, startFrame, endFrame);
+                }
+
+                bool useClips = settings.clips;
+                if (!useClips && !settings.singleFile && endFrame - startFrame + 1 > MAX_SINGLE_FILE_FRAMES)
+                {
+                    std::cerr << "More than " << MAX_SINGLE_FILE_FRAMES << " frames: baking value clips to bound the memory, use --single-file to write a single file\n";
+                    useClips = true;
+                }
+
+                Baker baker(srcLayer, settings);
+                bool baked = useClips ? bakeClips(baker, srcLayer, settings, startFrame, endFrame) : bakeMonolithic(baker, settings, startFrame, endFrame);
+                if (!baked)
+                {
+                    return 1;
+                }
+                std::cerr << "Wrote '" << settings.outputPath << "' in " << (nowNs() - bakeStartNs) * 1e-9 << "s\n";
+                return 0;
+            }
+        } // namespace tools
+    } // namespace usdplugin
+} // namespace glm
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    glm::usdplugin::tools::BakeSettings settings;
+    if (!glm::usdplugin::tools::parseArgs(argc, argv, settings))
+    {
+        glm::usdplugin::tools::printUsage();
+        return 1;
+    }
+    return glm::usdplugin::tools::runBake(settings);
+}
@@ -0,0 +1,469 @@
+/***************************************************************************
+*                                                                          *
+*  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+*                                                                          *
+***************************************************************************/
+
+// Benchmark of the Golaem procedural layer: layer init, spec queries, time sample queries,
+// playback, random seeks and thread scaling. Results are written as JSON.
+
+#include "glmUsdToolUtils.h"
+
+USD_INCLUDES_START
+#include <pxr/base/js/json.h>
+#include <pxr/base/plug/registry.h>
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/usd/sdf/fileFormat.h>
+#include <pxr/usd/sdf/schema.h>
+USD_INCLUDES_END
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        namespace tools
+        {
+            struct AttributeCategory
+            {
+                enum Value
+                {
+                    POINTS,
+                    NORMALS,
+                    XFORM,
+                    VISIBILITY,
+                    PP_ATTRIBUTES, // every other animated attribute: pp and shader attributes
+                    END
+                };
+
+                static const char* getName(Value category)
+                {
+                    switch (category)
+                    {
+                    case POINTS:
+                        return "points";
+                    case NORMALS:
+                        return "normals";
+                    case XFORM:
+                        return "xform";
+                    case VISIBILITY:
+                        return "visibility";
+                    case PP_ATTRIBUTES:
+                        return "ppAttributes";
+                    default:
+                        return "unknown";
+                    }
+                }
+            };
+
+            struct BenchSettings
+            {
+                std::string layerPath;
+                std::string pluginPath;
+                std::string outputPath;
+                SdfLayer::FileFormatArguments args;
+                int startFrame = INT_MIN; // INT_MIN: use the layer frame range
+                int endFrame = INT_MIN;
+                int seekCount = 100;
+                unsigned int seed = 0;
+                int maxThreads = (int)std::max(1u, std::thread::hardware_concurrency());
+                int scalingFrames = 10;
+            };
+
+            //-----------------------------------------------------------------------------
+            static void printUsage()
+            {
+                std::cerr << "Usage: glmUsdBench [options] [layer.glmusd]\n"
+                          << "  Without a layer file, an anonymous procedural layer is created from the --param values.\n"
+                          << "  --param name=value    Golaem USD parameter, can be repeated (e.g. --param glmCacheLibFile=/path/lib.gcl)\n"
+                          << "  --plugin-path dir     directory of the GolaemUSD plugInfo.json if not in PXR_PLUGINPATH_NAME\n"
+                          << "  --frames start:end    frame range used by the time sample benchmarks (default: layer range)\n"
+                          << "  --seeks count         random seek count (default: 100)\n"
+                          << "  --seed value          random seek seed (default: 0)\n"
+                          << "  --threads count       maximum thread count of the scaling benchmark (default: hardware threads)\n"
+                          << "  --scaling-frames n    frames computed per thread count (default: 10)\n"
+                          << "  --output file.json    result file (default: stdout)\n";
+            }
+
+            //-----------------------------------------------------------------------------
+            static bool parseArgs(int argc, char** argv, BenchSettings& settings)
+            {
+                for (int iArg = 1; iArg < argc; ++iArg)
+                {
+                    std::string arg = argv[iArg];
+                    bool hasValue = iArg + 1 < argc;
+                    if (arg == "--param" && hasValue)
+                    {
+                        if (!parseParamArg(argv[++iArg], settings.args))
+                        {
+                            std::cerr << "Invalid --param value '" << argv[iArg] << "', expected name=value\n";
+                            return false;
+                        }
+                    }
+                    else if (arg == "--plugin-path" && hasValue)
+                    {
+                        settings.pluginPath = argv[++iArg];
+                    }
+                    else if (arg == "--frames" && hasValue)
+                    {
+                        if (!parseFrameRangeArg(argv[++iArg], settings.startFrame, settings.endFrame))
+                        {
+                            std::cerr << "Invalid --frames value '" << argv[iArg] << "', expected start:end\n";
+                            return false;
+                        }
+                    }
+                    else if (arg == "--seeks" && hasValue)
+                    {
+                        settings.seekCount = std::max(0, atoi(argv[++iArg]));
+                    }
+                    else if (arg == "--seed" && hasValue)
+                    {
+                        settings.seed = (unsigned int)strtoul(argv[++iArg], NULL, 10);
+                    }
+                    else if (arg == "--threads" && hasValue)
+                    {
+                        settings.maxThreads = std::max(1, atoi(argv[++iArg]));
+                    }
+                    else if (arg == "--scaling-frames" && hasValue)
+                    {
+                        settings.scalingFrames = std::max(1, atoi(argv[++iArg]));
+                    }
+                    else if (arg == "--output" && hasValue)
+                    {
+                        settings.outputPath = argv[++iArg];
+                    }
+                    else if (!arg.empty() && arg[0] != '-' && settings.layerPath.empty())
+                    {
+                        settings.layerPath = arg;
+                    }
+                    else
+                    {
+                        std::cerr << "Unknown or incomplete argument '" << arg << "'\n";
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            //-----------------------------------------------------------------------------
+            static double nsToMs(uint64_t ns)
+            {
+                return ns * 1e-6;
+            }
+
+            //-----------------------------------------------------------------------------
+            static JsObject latencyStats(std::vector<uint64_t>& latenciesNs)
+            {
+                JsObject stats;
+                stats["count"] = JsValue((int64_t)latenciesNs.size());
+                if (latenciesNs.empty())
+                {
+                    return stats;
+                }
+                std::sort(latenciesNs.begin(), latenciesNs.end());
+                uint64_t totalNs = 0;
+                for (uint64_t latencyNs : latenciesNs)
+                {
+                    totalNs += latencyNs;
+                }
+                size_t lastIdx = latenciesNs.size() - 1;
+                stats["meanNs"] = JsValue((double)totalNs / latenciesNs.size());
+                stats["p50Ns"] = JsValue((int64_t)latenciesNs[lastIdx / 2]);
+                stats["p95Ns"] = JsValue((int64_t)latenciesNs[lastIdx * 95 / 100]);
+                stats["p99Ns"] = JsValue((int64_t)latenciesNs[lastIdx * 99 / 100]);
+                stats["maxNs"] = JsValue((int64_t)latenciesNs[lastIdx]);
+                return stats;
+            }
+
+            //-----------------------------------------------------------------------------
+            static JsObject throughputStats(size_t opCount, uint64_t durationNs)
+            {
+                JsObject stats;
+                stats["ops"] = JsValue((int64_t)opCount);
+                stats["totalMs"] = JsValue(nsToMs(durationNs));
+                stats["opsPerSecond"] = JsValue(durationNs > 0 ? opCount * 1e9 / durationNs : 0.);
+                return stats;
+            }
+
+            //-----------------------------------------------------------------------------
+            static AttributeCategory::Value categorize(const TfToken& attributeName)
+            {
+                static const TfToken pointsToken("points");
+                static const TfToken normalsToken("normals");
+                static const TfToken visibilityToken("visibility");
+                static const TfToken translationsToken("translations");
+                static const TfToken rotationsToken("rotations");
+                static const TfToken scalesToken("scales");
+                if (attributeName == pointsToken)
+                {
+                    return AttributeCategory::POINTS;
+                }
+                if (attributeName == normalsToken)
+                {
+                    return AttributeCategory::NORMALS;
+                }
+                if (attributeName == visibilityToken)
+                {
+                    return AttributeCategory::VISIBILITY;
+                }
+                if (TfStringStartsWith(attributeName.GetString(), "xformOp:") || attributeName == translationsToken || attributeName == rotationsToken || attributeName == scalesToken)
+                {
+                    return AttributeCategory::XFORM;
+                }
+                return AttributeCategory::PP_ATTRIBUTES;
+            }
+
+            //-----------------------------------------------------------------------------
+            static uint64_t queryFrame(const SdfLayerHandle& layer, const std::vector<SdfPath>& attributePaths, size_t beginIdx, size_t endIdx, double frame)
+            {
+                VtValue value;
+                uint64_t startNs = nowNs();
+                for (size_t iPath = beginIdx; iPath < endIdx; ++iPath)
+                {
+                    layer->QueryTimeSample(attributePaths[iPath], frame, &value);
+                }
+                return nowNs() - startNs;
+            }
+
+            //-----------------------------------------------------------------------------
+            static JsObject frameStats(const std::vector<uint64_t>& frameDurationsNs)
+            {
+                JsObject stats;
+                uint64_t totalNs = 0;
+                uint64_t maxNs = 0;
+                for (uint64_t durationNs : frameDurationsNs)
+                {
+                    totalNs += durationNs;
+                    maxNs = std::max(maxNs, durationNs);
+                }
+                stats["frameCount"] = JsValue((int64_t)frameDurationsNs.size());
+                stats["totalMs"] = JsValue(nsToMs(totalNs));
+                stats["meanFrameMs"] = JsValue(frameDurationsNs.empty() ? 0. : nsToMs(totalNs) / frameDurationsNs.size());
+                stats["maxFrameMs"] = JsValue(nsToMs(maxNs));
+                return stats;
+            }
+
+            //-----------------------------------------------------------------------------
+            static int runBench(const BenchSettings& settings)
+            {
+                JsObject result;
+                result["layer"] = JsValue(settings.layerPath);
+                JsObject params;
+                for (const auto& itArg : settings.args)
+                {
+                    params[itArg.first] = JsValue(itArg.second);
+                }
+                result["params"] = params;
+
+                // load the plugin before timing the layer init
+                if (!settings.pluginPath.empty())
+                {
+                    PlugRegistry::GetInstance().RegisterPlugins(settings.pluginPath);
+                }
+                if (!SdfFileFormat::FindByExtension("glmusd"))
+                {
+                    std::cerr << "The Golaem USD file format plugin could not be found, use --plugin-path or PXR_PLUGINPATH_NAME\n";
+                    return 1;
+                }
+
+                // layer init: dominated by _InitFromParams
+                uint64_t openStartNs = nowNs();
+                SdfLayerRefPtr layer = openProceduralLayer(settings.layerPath, settings.args, std::string());
+                uint64_t openDurationNs = nowNs() - openStartNs;
+                if (!layer)
+                {
+                    std::cerr << "Could not open the procedural layer '" << settings.layerPath << "'\n";
+                    return 1;
+                }
+                result["initFromParamsMs"] = JsValue(nsToMs(openDurationNs));
+
+                int startFrame = settings.startFrame;
+                int endFrame = settings.endFrame;
+                if (startFrame == INT_MIN)
+                {
+                    getLayerFrameRange(layer, startFrame, endFrame);
+                }
+                JsArray frameRange;
+                frameRange.push_back(JsValue(startFrame));
+                frameRange.push_back(JsValue(endFrame));
+                result["frameRange"] = frameRange;
+                int frameCount = endFrame - startFrame + 1;
+
+                // spec queries over all the paths
+                std::vector<SdfPath> allPaths;
+                layer->Traverse(SdfPath::AbsoluteRootPath(), [&allPaths](const SdfPath& path) { allPaths.push_back(path); });
+                {
+                    JsObject specs;
+                    specs["pathCount"] = JsValue((int64_t)allPaths.size());
+
+                    size_t specTypeSum = 0; // keeps the loop from being optimized away
+                    uint64_t startNs = nowNs();
+                    for (const SdfPath& path : allPaths)
+                    {
+                        specTypeSum += (size_t)layer->GetSpecType(path);
+                    }
+                    specs["getSpecType"] = throughputStats(allPaths.size(), nowNs() - startNs);
+
+                    size_t hasCount = 0;
+                    startNs = nowNs();
+                    for (const SdfPath& path : allPaths)
+                    {
+                        hasCount += layer->HasField(path, SdfFieldKeys->Default) ? 1 : 0;
+                    }
+                    specs["has"] = throughputStats(allPaths.size(), nowNs() - startNs);
+
+                    size_t fieldCount = 0;
+                    startNs = nowNs();
+                    for (const SdfPath& path : allPaths)
+                    {
+                        fieldCount += layer->ListFields(path).size();
+                    }
+                    specs["list"] = throughputStats(allPaths.size(), nowNs() - startNs);
+                    specs["fieldCount"] = JsValue((int64_t)fieldCount);
+                    specs["defaultValueCount"] = JsValue((int64_t)hasCount);
+                    (void)specTypeSum;
+                    result["specs"] = specs;
+                }
+
+                // animated attributes
+                std::vector<SdfPath> animatedPaths;
+                std::vector<std::vector<SdfPath>> animatedPathsPerCategory(AttributeCategory::END);
+                for (const SdfPath& path : allPaths)
+                {
+                    if (path.IsPropertyPath() && layer->GetNumTimeSamplesForPath(path) > 0)
+                    {
+                        animatedPaths.push_back(path);
+                        animatedPathsPerCategory[categorize(path.GetNameToken())].push_back(path);
+                    }
+                }
+                result["animatedAttributeCount"] = JsValue((int64_t)animatedPaths.size());
+
+                // each category is queried on its own frame: latencies include the entity computes
+                {
+                    JsObject latencies;
+                    VtValue value;
+                    for (int iCategory = 0; iCategory < AttributeCategory::END; ++iCategory)
+                    {
+                        double frame = startFrame + (iCategory + 1) % frameCount;
+                        const std::vector<SdfPath>& categoryPaths = animatedPathsPerCategory[iCategory];
+                        std::vector<uint64_t> latenciesNs;
+                        latenciesNs.reserve(categoryPaths.size());
+                        for (const SdfPath& path : categoryPaths)
+                        {
+                            uint64_t startNs = nowNs();
+                            layer->QueryTimeSample(path, frame, &value);
+                            latenciesNs.push_back(nowNs() - startNs);
+                        }
+                        latencies[AttributeCategory::getName((AttributeCategory::Value)iCategory)] = latencyStats(latenciesNs);
+                    }
+                    result["queryTimeSample"] = latencies;
+                }
+
+                // sequential playback
+                {
+                    std::vector<uint64_t> frameDurationsNs;
+                    for (int frame = startFrame; frame <= endFrame; ++frame)
+                    {
+                        frameDurationsNs.push_back(queryFrame(layer, animatedPaths, 0, animatedPaths.size(), frame));
+                    }
+                    result["playback"] = frameStats(frameDurationsNs);
+                }
+
+                // random seeks
+                {
+                    std::mt19937 generator(settings.seed);
+                    std::uniform_int_distribution<int> frameDistribution(startFrame, endFrame);
+                    std::vector<uint64_t> frameDurationsNs;
+                    for (int iSeek = 0; iSeek < settings.seekCount; ++iSeek)
+                    {
+                        frameDurationsNs.push_back(queryFrame(layer, animatedPaths, 0, animatedPaths.size(), frameDistribution(generator)));
+                    }
+                    result["randomSeek"] = frameStats(frameDurationsNs);
+                }
+
+                // thread scaling: the animated attributes are split in contiguous chunks so that each entity is mostly queried by one thread
+                {
+                    JsArray scaling;
+                    double singleThreadNs = 0;
+                    std::vector<int> threadCounts;
+                    for (int threadCount = 1; threadCount < settings.maxThreads; threadCount *= 2)
+                    {
+                        threadCounts.push_back(threadCount);
+                    }
+                    threadCounts.push_back(settings.maxThreads);
+                    for (int threadCount : threadCounts)
+                    {
+                        std::vector<std::thread> threads;
+                        size_t chunkSize = (animatedPaths.size() + threadCount - 1) / threadCount;
+                        uint64_t startNs = nowNs();
+                        for (int iThread = 0; iThread < threadCount; ++iThread)
+                        {
+                            size_t beginIdx = std::min(animatedPaths.size(), iThread * chunkSize);
+                            size_t endIdx = std::min(animatedPaths.size(), beginIdx + chunkSize);
+                            threads.emplace_back([&, beginIdx, endIdx]() {
+                                for (int iFrame = 0; iFrame < settings.scalingFrames; ++iFrame)
+                                {
+                                    queryFrame(layer, animatedPaths, beginIdx, endIdx, startFrame + iFrame % frameCount);
+                                }
+                            });
+                        }
+                        for (std::thread& thread : threads)
+                        {
+                            thread.join();
+                        }
+                        uint64_t durationNs = nowNs() - startNs;
+                        if (threadCount == 1)
+                        {
+                            singleThreadNs = (double)durationNs;
+                        }
+
+                        JsObject threadStats;
+                        threadStats["threads"] = JsValue(threadCount);
+                        threadStats["totalMs"] = JsValue(nsToMs(durationNs));
+                        threadStats["framesPerSecond"] = JsValue(durationNs > 0 ? settings.scalingFrames * 1e9 / durationNs : 0.);
+                        threadStats["speedup"] = JsValue(durationNs > 0 ? singleThreadNs / durationNs : 0.);
+                        scaling.push_back(threadStats);
+                    }
+                    result["threadScaling"] = scaling;
+                }
+
+                if (settings.outputPath.empty())
+                {
+                    JsWriteToStream(result, std::cout);
+                    std::cout << std::endl;
+                }
+                else
+                {
+                    std::ofstream outputStream(settings.outputPath.c_str());
+                    if (!outputStream)
+                    {
+                        std::cerr << "Could not write '" << settings.outputPath << "'\n";
+                        return 1;
+                    }
+                    JsWriteToStream(result, outputStream);
+                }
+                return 0;
+            }
+        } // namespace tools
+    } // namespace usdplugin
+} // namespace glm
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    glm::usdplugin::tools::BenchSettings settings;
+    if (!glm::usdplugin::tools::parseArgs(argc, argv, settings))
+    {
+        glm::usdplugin::tools::printUsage();
+        return 1;
+    }
+    return glm::usdplugin::tools::runBench(settings);
+}
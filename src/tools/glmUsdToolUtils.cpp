@@ -0,0 +1,139 @@
+/***************************************************************************
+*                                                                          *
+*  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+*                                                                          *
+***************************************************************************/
+
+#include "glmUsdToolUtils.h"
+
+USD_INCLUDES_START
+#include <pxr/base/plug/registry.h>
+#include <pxr/base/tf/stringUtils.h>
+USD_INCLUDES_END
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        namespace tools
+        {
+            //-----------------------------------------------------------------------------
+            bool parseParamArg(const std::string& arg, SdfLayer::FileFormatArguments& args)
+            {
+                size_t separatorPos = arg.find('=');
+                if (separatorPos == std::string::npos || separatorPos == 0)
+                {
+                    return false;
+                }
+                args[arg.substr(0, separatorPos)] = arg.substr(separatorPos + 1);
+                return true;
+            }
+
+            //-----------------------------------------------------------------------------
+            bool parseFrameRangeArg(const std::string& arg, int& startFrame, int& endFrame)
+            {
+                return sscanf(arg.c_str(), "%d:%d", &startFrame, &endFrame) == 2 && startFrame <= endFrame;
+            }
+
+            //-----------------------------------------------------------------------------
+            bool parseEntityIdsArg(const std::string& arg, EntityIdRanges& entityIdRanges)
+            {
+                for (const std::string& item : TfStringTokenize(arg, ","))
+                {
+                    long long firstId = 0;
+                    long long lastId = 0;
+                    int parsedCount = sscanf(item.c_str(), "%lld-%lld", &firstId, &lastId);
+                    if (parsedCount == 1)
+                    {
+                        lastId = firstId;
+                    }
+                    else if (parsedCount != 2 || lastId < firstId)
+                    {
+                        return false;
+                    }
+                    entityIdRanges.emplace_back(firstId, lastId);
+                }
+
+                // merged ranges: a large range is never expanded to its ids
+                std::sort(entityIdRanges.begin(), entityIdRanges.end());
+                size_t mergedCount = 0;
+                for (size_t iRange = 0; iRange < entityIdRanges.size(); ++iRange)
+                {
+                    if (mergedCount > 0 && entityIdRanges[iRange].first <= entityIdRanges[mergedCount - 1].second + 1)
+                    {
+                        entityIdRanges[mergedCount - 1].second = std::max(entityIdRanges[mergedCount - 1].second, entityIdRanges[iRange].second);
+                    }
+                    else
+                    {
+                        entityIdRanges[mergedCount++] = entityIdRanges[iRange];
+                    }
+                }
+                entityIdRanges.resize(mergedCount);
+                return true;
+            }
+
+            //-----------------------------------------------------------------------------
+            bool isEntityIdInRanges(const EntityIdRanges& entityIdRanges, int64_t entityId)
+            {
+                // first range starting after the id, the previous one is the only one which can contain it
+                auto itRange = std::upper_bound(entityIdRanges.begin(), entityIdRanges.end(), EntityIdRanges::value_type(entityId, INT64_MAX));
+                return itRange != entityIdRanges.begin() && entityId <= (itRange - 1)->second;
+            }
+
+            //-----------------------------------------------------------------------------
+            int64_t getEntityIdFromPrimName(const std::string& primName)
+            {
+                static const std::string entityPrefix = "Entity_";
+                if (!TfStringStartsWith(primName, entityPrefix))
+                {
+                    return -1;
+                }
+                char* idEnd = NULL;
+                long long entityId = strtoll(primName.c_str() + entityPrefix.size(), &idEnd, 10);
+                if (idEnd == primName.c_str() + entityPrefix.size() || *idEnd != '\0')
+                {
+                    return -1;
+                }
+                return entityId;
+            }
+
+            //-----------------------------------------------------------------------------
+            SdfLayerRefPtr openProceduralLayer(const std::string& layerPath, const SdfLayer::FileFormatArguments& args, const std::string& pluginPath)
+            {
+                if (!pluginPath.empty())
+                {
+                    PlugRegistry::GetInstance().RegisterPlugins(pluginPath);
+                }
+                if (layerPath.empty())
+                {
+                    // the tag extension selects the Golaem file format, the layer data is created from the args only
+                    return SdfLayer::CreateAnonymous("glmUsdTool.glmusd", args);
+                }
+                return SdfLayer::FindOrOpen(layerPath, args);
+            }
+
+            //-----------------------------------------------------------------------------
+            void getLayerFrameRange(const SdfLayerHandle& layer, int& startFrame, int& endFrame)
+            {
+                startFrame = (int)floor(layer->GetStartTimeCode());
+                endFrame = (int)ceil(layer->GetEndTimeCode());
+                if (endFrame < startFrame)
+                {
+                    endFrame = startFrame;
+                }
+            }
+
+            //-----------------------------------------------------------------------------
+            uint64_t nowNs()
+            {
+                return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            }
+        } // namespace tools
+    } // namespace usdplugin
+} // namespace glm
@@ -0,0 +1,57 @@
+/***************************************************************************
+*                                                                          *
+*  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+*                                                                          *
+***************************************************************************/
+
+#pragma once
+
+#include "glmUSD.h"
+
+USD_INCLUDES_START
+#include <pxr/pxr.h>
+#include <pxr/usd/sdf/layer.h>
+USD_INCLUDES_END
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        namespace tools
+        {
+            using namespace PXR_INTERNAL_NS;
+
+            // Parses a "name=value" pair given with --param, the value is forwarded as a file format argument
+            bool parseParamArg(const std::string& arg, SdfLayer::FileFormatArguments& args);
+
+            // Parses "start:end"
+            bool parseFrameRangeArg(const std::string& arg, int& startFrame, int& endFrame);
+
+            // Sorted and merged [first, last] entity id ranges
+            typedef std::vector<std::pair<int64_t, int64_t>> EntityIdRanges;
+
+            // Parses a list of entity ids and id ranges: "1,4,10-20"
+            bool parseEntityIdsArg(const std::string& arg, EntityIdRanges& entityIdRanges);
+
+            // Whether the entity id is in one of the ranges given by parseEntityIdsArg
+            bool isEntityIdInRanges(const EntityIdRanges& entityIdRanges, int64_t entityId);
+
+            // Returns the entity id of an "Entity_<id>" prim name, -1 for other names
+            int64_t getEntityIdFromPrimName(const std::string& primName);
+
+            // Registers the plugin directory if given, then opens the layer file with the args,
+            // or creates an anonymous procedural layer from the args only when layerPath is empty
+            SdfLayerRefPtr openProceduralLayer(const std::string& layerPath, const SdfLayer::FileFormatArguments& args, const std::string& pluginPath);
+
+            // Frame range of the generated time samples
+            void getLayerFrameRange(const SdfLayerHandle& layer, int& startFrame, int& endFrame);
+
+            uint64_t nowNs();
+        } // namespace tools
+    } // namespace usdplugin
+} // namespace glm
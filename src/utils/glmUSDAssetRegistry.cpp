@@ -0,0 +1,107 @@
+/***************************************************************************
+*                                                                          *
+*  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+*                                                                          *
+***************************************************************************/
+
+#include "glmUSDAssetRegistry.h"
+#include "glmUSD.h"
+#include "glmUSDTrace.h"
+
+USD_INCLUDES_START
+#include <pxr/pxr.h>
+#include <pxr/base/arch/fileSystem.h>
+#include <pxr/base/tf/stringUtils.h>
+USD_INCLUDES_END
+
+#include <glmScopedLock.h>
+
+#include <map>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        using namespace PXR_INTERNAL_NS;
+
+        namespace
+        {
+            struct RegisteredAsset
+            {
+                std::string fileStamp;
+                std::weak_ptr<const void> asset; // the asset is released with the last layer using it
+            };
+
+            //-----------------------------------------------------------------------------
+            TraceMutex& _GetAssetsLock()
+            {
+                // never destroyed: assets can be queried after the static destructors
+                static TraceMutex* assetsLock = new TraceMutex{GLMUSD_MUTEX_DESC("AssetRegistry::assetsLock")};
+                return *assetsLock;
+            }
+
+            //-----------------------------------------------------------------------------
+            std::map<std::string, RegisteredAsset>& _GetAssets()
+            {
+                static std::map<std::string, RegisteredAsset>* assets = new std::map<std::string, RegisteredAsset>();
+                return *assets;
+            }
+        } // namespace
+
+        /*static*/
+        //-----------------------------------------------------------------------------
+        std::string AssetRegistry::getFileStamp(const std::string& filePath)
+        {
+            double modificationTime = 0;
+            if (filePath.empty() || !ArchGetModificationTime(filePath.c_str(), &modificationTime))
+            {
+                return std::string();
+            }
+            return TfStringPrintf("%.6f:%lld", modificationTime, (long long)ArchGetFileLength(filePath.c_str()));
+        }
+
+        /*static*/
+        //-----------------------------------------------------------------------------
+        std::shared_ptr<const void> AssetRegistry::_get(const std::string& assetKey, const std::string& filePath, const std::function<std::shared_ptr<const void>()>& loadFunction)
+        {
+            std::string fileStamp = getFileStamp(filePath);
+            {
+                glm::ScopedLock<TraceMutex> assetsLock(_GetAssetsLock());
+                auto itAsset = _GetAssets().find(assetKey);
+                if (itAsset != _GetAssets().end())
+                {
+                    if (itAsset->second.fileStamp == fileStamp)
+                    {
+                        if (std::shared_ptr<const void> asset = itAsset->second.asset.lock())
+                        {
+                            return asset;
+                        }
+                    }
+                    // released or stale: a stale asset is only kept alive by the layers still using it
+                    _GetAssets().erase(itAsset);
+                }
+            }
+
+            // loaded out of the lock: the other assets stay available meanwhile
+            std::shared_ptr<const void> asset;
+            {
+                GLMUSD_ZONE("AssetRegistry::Load");
+                asset = loadFunction();
+            }
+
+            glm::ScopedLock<TraceMutex> assetsLock(_GetAssetsLock());
+            RegisteredAsset& registeredAsset = _GetAssets()[assetKey];
+            if (registeredAsset.fileStamp == fileStamp)
+            {
+                if (std::shared_ptr<const void> registeredAssetRef = registeredAsset.asset.lock())
+                {
+                    // loaded meanwhile by another layer: keep a single copy, the loaded one is released out of the lock
+                    return registeredAssetRef;
+                }
+            }
+            registeredAsset.fileStamp = fileStamp;
+            registeredAsset.asset = asset;
+            return asset;
+        }
+    } // namespace usdplugin
+} // namespace glm
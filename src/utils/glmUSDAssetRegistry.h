@@ -0,0 +1,43 @@
+/***************************************************************************
+*                                                                          *
+*  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+*                                                                          *
+***************************************************************************/
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <typeinfo>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        /// Process-wide registry of the assets loaded from files (cache library items, terrains...), so that layers
+        /// referencing the same files parse them once. An asset is loaded again when the modification time or the
+        /// size of its file changes. Assets are shared between layers, must not be modified and are released with the last layer using them.
+        class AssetRegistry
+        {
+        public:
+            /// Returns the asset registered for the key and the file, loaded with loadFunction if the file changed
+            template <typename T>
+            static std::shared_ptr<const T> get(const std::string& assetKey, const std::string& filePath, const std::function<std::shared_ptr<const T>()>& loadFunction);
+
+            /// Modification time and size of the file, empty if the file does not exist
+            static std::string getFileStamp(const std::string& filePath);
+
+        private:
+            static std::shared_ptr<const void> _get(const std::string& assetKey, const std::string& filePath, const std::function<std::shared_ptr<const void>()>& loadFunction);
+        };
+
+        //-----------------------------------------------------------------------------
+        template <typename T>
+        std::shared_ptr<const T> AssetRegistry::get(const std::string& assetKey, const std::string& filePath, const std::function<std::shared_ptr<const T>()>& loadFunction)
+        {
+            // the asset type is part of the key: the same file can be registered as different assets
+            return std::static_pointer_cast<const T>(_get(std::string(typeid(T).name()) + "|" + assetKey, filePath, [&loadFunction]() -> std::shared_ptr<const void> { return loadFunction(); }));
+        }
+    } // namespace usdplugin
+} // namespace glm
@@ -0,0 +1,87 @@
+/***************************************************************************
+*                                                                          *
+*  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+*                                                                          *
+***************************************************************************/
+
+#include "glmUSDCachedGeometry.h"
+
+#include <cstring>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        //-----------------------------------------------------------------------------
+        bool CachedGeometry::readMesh(size_t meshIdx, VtVec3fArray& points, VtVec3fArray& normals) const
+        {
+            if (meshIdx >= meshCount)
+            {
+                return false;
+            }
+            const MeshSize* meshSizes = reinterpret_cast<const MeshSize*>(data);
+            const char* meshData = data + meshCount * sizeof(MeshSize);
+            for (size_t iMesh = 0; iMesh < meshIdx; ++iMesh)
+            {
+                meshData += (size_t(meshSizes[iMesh].pointCount) + meshSizes[iMesh].normalCount) * sizeof(GfVec3f);
+            }
+            const MeshSize& meshSize = meshSizes[meshIdx];
+            if (meshSize.pointCount != points.size() || meshSize.normalCount != normals.size())
+            {
+                return false;
+            }
+            memcpy(points.data(), meshData, meshSize.pointCount * sizeof(GfVec3f));
+            memcpy(normals.data(), meshData + meshSize.pointCount * sizeof(GfVec3f), meshSize.normalCount * sizeof(GfVec3f));
+            return true;
+        }
+
+        //-----------------------------------------------------------------------------
+        bool CachedGeometry::isBlockInside(const char* data, uint32_t meshCount, size_t availableSize)
+        {
+            uint64_t blockSize = meshCount * sizeof(MeshSize);
+            if (blockSize > availableSize)
+            {
+                return false;
+            }
+            const MeshSize* meshSizes = reinterpret_cast<const MeshSize*>(data);
+            for (uint32_t iMesh = 0; iMesh < meshCount; ++iMesh)
+            {
+                blockSize += (uint64_t(meshSizes[iMesh].pointCount) + meshSizes[iMesh].normalCount) * sizeof(GfVec3f);
+            }
+            return blockSize <= availableSize;
+        }
+
+        //-----------------------------------------------------------------------------
+        size_t CachedGeometry::computeBlockSize(const glm::PODArray<const VtVec3fArray*>& points, const glm::PODArray<const VtVec3fArray*>& normals)
+        {
+            GLM_DEBUG_ASSERT(points.size() == normals.size());
+            size_t blockSize = points.size() * sizeof(MeshSize);
+            for (size_t iMesh = 0, meshCount = points.size(); iMesh < meshCount; ++iMesh)
+            {
+                blockSize += (points[iMesh]->size() + normals[iMesh]->size()) * sizeof(GfVec3f);
+            }
+            return blockSize;
+        }
+
+        //-----------------------------------------------------------------------------
+        void CachedGeometry::writeBlock(char* data, const glm::PODArray<const VtVec3fArray*>& points, const glm::PODArray<const VtVec3fArray*>& normals)
+        {
+            size_t meshCount = points.size();
+            for (size_t iMesh = 0; iMesh < meshCount; ++iMesh)
+            {
+                MeshSize meshSize{(uint32_t)points[iMesh]->size(), (uint32_t)normals[iMesh]->size()};
+                memcpy(data, &meshSize, sizeof(MeshSize));
+                data += sizeof(MeshSize);
+            }
+            for (size_t iMesh = 0; iMesh < meshCount; ++iMesh)
+            {
+                size_t pointsSize = points[iMesh]->size() * sizeof(GfVec3f);
+                memcpy(data, points[iMesh]->cdata(), pointsSize);
+                data += pointsSize;
+                size_t normalsSize = normals[iMesh]->size() * sizeof(GfVec3f);
+                memcpy(data, normals[iMesh]->cdata(), normalsSize);
+                data += normalsSize;
+            }
+        }
+    } // namespace usdplugin
+} // namespace glm
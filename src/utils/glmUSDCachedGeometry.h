@@ -0,0 +1,49 @@
+/***************************************************************************
+*                                                                          *
+*  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+*                                                                          *
+***************************************************************************/
+
+#pragma once
+
+#include "glmUSD.h"
+
+USD_INCLUDES_START
+#include <pxr/pxr.h>
+#include <pxr/base/vt/types.h>
+USD_INCLUDES_END
+
+#include <glmCore.h>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        using namespace PXR_INTERNAL_NS;
+
+        /// Deformed geometry of one entity as stored by the geometry caches (disk and shared memory):
+        /// a block made of MeshSize[meshCount] followed by the points then the normals of each mesh.
+        /// Points to the cache memory, valid as long as the cache is alive.
+        struct CachedGeometry
+        {
+            struct MeshSize
+            {
+                uint32_t pointCount;
+                uint32_t normalCount;
+            };
+
+            uint32_t geometryFileIdx = 0;
+            uint32_t meshCount = 0;
+            const char* data = NULL;
+
+            /// Copies the points and normals of a mesh, returns false if the cached sizes do not match the arrays
+            bool readMesh(size_t meshIdx, VtVec3fArray& points, VtVec3fArray& normals) const;
+
+            /// True if the block of meshCount meshes at data fits in availableSize bytes
+            static bool isBlockInside(const char* data, uint32_t meshCount, size_t availableSize);
+
+            static size_t computeBlockSize(const glm::PODArray<const VtVec3fArray*>& points, const glm::PODArray<const VtVec3fArray*>& normals);
+            static void writeBlock(char* data, const glm::PODArray<const VtVec3fArray*>& points, const glm::PODArray<const VtVec3fArray*>& normals);
+        };
+    } // namespace usdplugin
+} // namespace glm
@@ -0,0 +1,21 @@
+/***************************************************************************
+*                                                                          *
+*  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+*                                                                          *
+***************************************************************************/
+
+#include "glmUSDDebugCodes.h"
+
+USD_INCLUDES_START
+#include <pxr/base/tf/registryManager.h>
+USD_INCLUDES_END
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+TF_REGISTRY_FUNCTION(TfDebug)
+{
+    TF_DEBUG_ENVIRONMENT_SYMBOL(GLMUSD_MEMORY, "Golaem USD: memory report per category, per layer and process-wide");
+    TF_DEBUG_ENVIRONMENT_SYMBOL(GLMUSD_PERF, "Golaem USD: performance counters (queries, computes, lock waits, skinning) per layer");
+}
+
+PXR_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,26 @@
+/***************************************************************************
+*                                                                          *
+*  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+*                                                                          *
+***************************************************************************/
+
+#pragma once
+
+#include "glmUSD.h"
+
+USD_INCLUDES_START
+#include <pxr/pxr.h>
+#include <pxr/base/tf/debug.h>
+USD_INCLUDES_END
+
+// TfDebug codes must be declared in the USD namespace (TfDebug specializes its traits on the enum type)
+PXR_NAMESPACE_OPEN_SCOPE
+
+// clang-format off
+TF_DEBUG_CODES(
+    GLMUSD_MEMORY, // dump the memory report of each Golaem layer after loading and when it closes
+    GLMUSD_PERF    // dump the performance counters of each Golaem layer when it closes
+);
+// clang-format on
+
+PXR_NAMESPACE_CLOSE_SCOPE
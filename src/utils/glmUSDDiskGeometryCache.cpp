@@ -0,0 +1,378 @@
+/***************************************************************************
+*                                                                          *
+*  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+*                                                                          *
+***************************************************************************/
+
+#include "glmUSDDiskGeometryCache.h"
+
+USD_INCLUDES_START
+#include <pxr/base/arch/systemInfo.h>
+#include <pxr/base/tf/fileUtils.h>
+#include <pxr/base/tf/stringUtils.h>
+USD_INCLUDES_END
+
+#include <glmLog.h>
+#include <glmScopedLock.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        namespace
+        {
+            const char FILE_MAGIC[8] = {'G', 'L', 'M', 'G', 'E', 'O', 'C', 'H'};
+            const uint32_t FILE_FORMAT_VERSION = 1;
+
+            // frames kept in memory until all their entities are computed, the oldest one is written as a segment when there are more
+            const size_t MAX_PENDING_FRAMES = 2;
+            // segments of a frame, reached when the entities are never all computed in the same pass
+            const uint32_t MAX_SEGMENT_COUNT = 1024;
+
+            struct FileHeader
+            {
+                char magic[8];
+                uint32_t formatVersion;
+                uint32_t entityCount;
+                uint64_t key;
+                double frame;
+            };
+
+            struct EntityIndex
+            {
+                int64_t entityId;
+                uint64_t offset; // from the beginning of the file
+                uint32_t geometryFileIdx;
+                uint32_t meshCount;
+            };
+
+            //-----------------------------------------------------------------------------
+            bool _IsEntityIdLess(const EntityIndex& entityIndex, int64_t entityId)
+            {
+                return entityIndex.entityId < entityId;
+            }
+
+            //-----------------------------------------------------------------------------
+            // Gives the file the new path, false if a file already exists at this path
+            bool _CreateFile(const std::string& filePath, const std::string& newPath)
+            {
+#ifdef _WIN32
+                // does not replace an existing file on Windows
+                return rename(filePath.c_str(), newPath.c_str()) == 0;
+#else
+                return link(filePath.c_str(), newPath.c_str()) == 0;
+#endif
+            }
+        } // namespace
+
+        //-----------------------------------------------------------------------------
+        DiskGeometryCache::DiskGeometryCache(const std::string& rootDir, uint64_t key, size_t entityCount)
+            : _dir(TfStringPrintf("%s/%016llx", TfStringTrimRight(rootDir, "/\\").c_str(), (unsigned long long)key))
+            , _key(key)
+            , _entityCount(entityCount)
+        {
+        }
+
+        //-----------------------------------------------------------------------------
+        DiskGeometryCache::~DiskGeometryCache()
+        {
+            flush();
+            for (const auto& itMappedFrame : _mappedFrames)
+            {
+                for (MappedSegment* mappedSegment : itMappedFrame.second.segments)
+                {
+                    delete mappedSegment;
+                }
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        uint64_t DiskGeometryCache::hash(const void* data, size_t size, uint64_t seed)
+        {
+            const unsigned char* bytes = static_cast<const unsigned char*>(data);
+            uint64_t result = seed;
+            for (size_t iByte = 0; iByte < size; ++iByte)
+            {
+                result ^= bytes[iByte];
+                result *= 1099511628211ULL;
+            }
+            return result;
+        }
+
+        //-----------------------------------------------------------------------------
+        uint64_t DiskGeometryCache::hash(const std::string& data, uint64_t seed)
+        {
+            // include the size so that consecutive strings cannot be confused
+            uint64_t size = data.size();
+            return hash(data.data(), data.size(), hash(&size, sizeof(size), seed));
+        }
+
+        //-----------------------------------------------------------------------------
+        std::string DiskGeometryCache::_getSegmentPath(double frame, uint32_t segmentIdx) const
+        {
+            if (segmentIdx == 0)
+            {
+                return TfStringPrintf("%s/frame.%.4f.glmgeo", _dir.c_str(), frame);
+            }
+            return TfStringPrintf("%s/frame.%.4f.%u.glmgeo", _dir.c_str(), frame, segmentIdx);
+        }
+
+        //-----------------------------------------------------------------------------
+        DiskGeometryCache::MappedSegment* DiskGeometryCache::_mapSegment(double frame, const std::string& segmentPath) const
+        {
+            GLMUSD_ZONE("DiskGeometryCache::MapSegment");
+            std::string errorMessage;
+            ArchConstFileMapping mapping = ArchMapFileReadOnly(segmentPath, &errorMessage);
+            if (!mapping)
+            {
+                GLM_CROWD_TRACE_WARNING("Could not map geometry cache file '" << segmentPath << "': " << errorMessage);
+                return NULL;
+            }
+
+            // validate the header and the index, the entity blocks are checked when they are read
+            size_t fileSize = ArchGetFileMappingLength(mapping);
+            const FileHeader* header = reinterpret_cast<const FileHeader*>(mapping.get());
+            if (fileSize < sizeof(FileHeader) ||
+                memcmp(header->magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 ||
+                header->formatVersion != FILE_FORMAT_VERSION ||
+                header->key != _key ||
+                header->frame != frame ||
+                fileSize < sizeof(FileHeader) + header->entityCount * sizeof(EntityIndex))
+            {
+                GLM_CROWD_TRACE_WARNING("Ignoring invalid geometry cache file '" << segmentPath << "'");
+                return NULL;
+            }
+
+            MappedSegment* mappedSegment = new MappedSegment();
+            mappedSegment->entityCount = header->entityCount;
+            mappedSegment->mapping = std::move(mapping);
+            return mappedSegment;
+        }
+
+        //-----------------------------------------------------------------------------
+        DiskGeometryCache::MappedFrame& DiskGeometryCache::_getMappedFrame(double frame)
+        {
+            auto itMappedFrame = _mappedFrames.find(frame);
+            if (itMappedFrame != _mappedFrames.end())
+            {
+                return itMappedFrame->second;
+            }
+
+            // segments written by the other processes later on are only found when this process writes the frame
+            MappedFrame& mappedFrame = _mappedFrames[frame];
+            for (; mappedFrame.nextSegmentIdx < MAX_SEGMENT_COUNT; ++mappedFrame.nextSegmentIdx)
+            {
+                std::string segmentPath = _getSegmentPath(frame, mappedFrame.nextSegmentIdx);
+                if (!TfIsFile(segmentPath))
+                {
+                    break;
+                }
+                if (MappedSegment* mappedSegment = _mapSegment(frame, segmentPath))
+                {
+                    mappedFrame.segments.push_back(mappedSegment);
+                    mappedFrame.entityCount += mappedSegment->entityCount;
+                }
+            }
+            return mappedFrame;
+        }
+
+        //-----------------------------------------------------------------------------
+        bool DiskGeometryCache::_findEntity(const MappedFrame& mappedFrame, int64_t entityId, CachedGeometry& cachedGeometry) const
+        {
+            for (const MappedSegment* mappedSegment : mappedFrame.segments)
+            {
+                const char* fileData = mappedSegment->mapping.get();
+                size_t fileSize = ArchGetFileMappingLength(mappedSegment->mapping);
+                const EntityIndex* indexBegin = reinterpret_cast<const EntityIndex*>(fileData + sizeof(FileHeader));
+                const EntityIndex* indexEnd = indexBegin + mappedSegment->entityCount;
+                const EntityIndex* entityIndex = std::lower_bound(indexBegin, indexEnd, entityId, _IsEntityIdLess);
+                if (entityIndex == indexEnd || entityIndex->entityId != entityId)
+                {
+                    continue;
+                }
+
+                // check that the entity block is inside the file
+                if (entityIndex->offset > fileSize || !CachedGeometry::isBlockInside(fileData + entityIndex->offset, entityIndex->meshCount, fileSize - entityIndex->offset))
+                {
+                    continue;
+                }
+
+                cachedGeometry.geometryFileIdx = entityIndex->geometryFileIdx;
+                cachedGeometry.meshCount = entityIndex->meshCount;
+                cachedGeometry.data = fileData + entityIndex->offset;
+                return true;
+            }
+            return false;
+        }
+
+        //-----------------------------------------------------------------------------
+        bool DiskGeometryCache::findEntity(double frame, int64_t entityId, CachedGeometry& cachedGeometry)
+        {
+            // the mapped segments are never modified nor released before the destructor, the block is read outside of the lock
+            glm::ScopedLock<TraceMutex> lock(_lock);
+            return _findEntity(_getMappedFrame(frame), entityId, cachedGeometry);
+        }
+
+        //-----------------------------------------------------------------------------
+        void DiskGeometryCache::storeEntity(double frame, int64_t entityId, uint32_t geometryFileIdx, const glm::PODArray<const VtVec3fArray*>& points, const glm::PODArray<const VtVec3fArray*>& normals)
+        {
+            GLM_DEBUG_ASSERT(points.size() == normals.size());
+
+            // serialize outside of the lock
+            size_t meshCount = points.size();
+            std::string block(CachedGeometry::computeBlockSize(points, normals), '\0');
+            CachedGeometry::writeBlock(&block[0], points, normals);
+
+            std::map<double, PendingFrame> framesToWrite;
+            {
+                glm::ScopedLock<TraceMutex> lock(_lock);
+                const MappedFrame& mappedFrame = _getMappedFrame(frame);
+                CachedGeometry cachedGeometry;
+                if (_findEntity(mappedFrame, entityId, cachedGeometry))
+                {
+                    // already written by a previous pass
+                    return;
+                }
+
+                auto itPendingFrame = _pendingFrames.find(frame);
+                if (itPendingFrame == _pendingFrames.end())
+                {
+                    itPendingFrame = _pendingFrames.insert(std::make_pair(frame, PendingFrame())).first;
+                    itPendingFrame->second.sequence = _nextSequence++;
+                }
+                PendingFrame& pendingFrame = itPendingFrame->second;
+                PendingEntity& entity = pendingFrame.entities[entityId];
+                entity.geometryFileIdx = geometryFileIdx;
+                entity.meshCount = (uint32_t)meshCount;
+                entity.block.swap(block);
+
+                if (pendingFrame.entities.size() + mappedFrame.entityCount >= _entityCount)
+                {
+                    framesToWrite[frame].entities.swap(pendingFrame.entities);
+                    _pendingFrames.erase(itPendingFrame);
+                }
+                while (_pendingFrames.size() > MAX_PENDING_FRAMES)
+                {
+                    // incomplete frame: written as a segment, the entities which are never queried (culled, disabled) are added by the next passes
+                    auto itOldestFrame = _pendingFrames.begin();
+                    for (auto itFrame = _pendingFrames.begin(); itFrame != _pendingFrames.end(); ++itFrame)
+                    {
+                        if (itFrame->second.sequence < itOldestFrame->second.sequence)
+                        {
+                            itOldestFrame = itFrame;
+                        }
+                    }
+                    framesToWrite[itOldestFrame->first].entities.swap(itOldestFrame->second.entities);
+                    _pendingFrames.erase(itOldestFrame);
+                }
+            }
+
+            for (const auto& itFrame : framesToWrite)
+            {
+                _writeFrame(itFrame.first, itFrame.second);
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        void DiskGeometryCache::flush()
+        {
+            std::map<double, PendingFrame> framesToWrite;
+            {
+                glm::ScopedLock<TraceMutex> lock(_lock);
+                framesToWrite.swap(_pendingFrames);
+            }
+            for (const auto& itFrame : framesToWrite)
+            {
+                _writeFrame(itFrame.first, itFrame.second);
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        void DiskGeometryCache::_writeFrame(double frame, const PendingFrame& pendingFrame)
+        {
+            if (pendingFrame.entities.empty())
+            {
+                return;
+            }
+            GLMUSD_ZONE("DiskGeometryCache::WriteFrame");
+
+            if (!TfIsDir(_dir) && !TfMakeDirs(_dir) && !TfIsDir(_dir))
+            {
+                GLM_CROWD_TRACE_WARNING("Could not create geometry cache directory '" << _dir << "'");
+                return;
+            }
+
+            FileHeader header;
+            memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+            header.formatVersion = FILE_FORMAT_VERSION;
+            header.entityCount = (uint32_t)pendingFrame.entities.size();
+            header.key = _key;
+            header.frame = frame;
+
+            std::vector<EntityIndex> entityIndices;
+            entityIndices.reserve(pendingFrame.entities.size());
+            uint64_t offset = sizeof(FileHeader) + pendingFrame.entities.size() * sizeof(EntityIndex);
+            for (const auto& itEntity : pendingFrame.entities)
+            {
+                const PendingEntity& entity = itEntity.second;
+                entityIndices.push_back({itEntity.first, offset, entity.geometryFileIdx, entity.meshCount});
+                offset += entity.block.size();
+            }
+
+            // write to a temporary file then give it the path of the next segment so that other processes never map a partial file
+            static std::atomic<uint32_t> s_tempFileCounter(0);
+            std::string tempPath = TfStringPrintf("%s.%d.%u.tmp", _getSegmentPath(frame, 0).c_str(), ArchGetProcessId(), s_tempFileCounter.fetch_add(1));
+            {
+                std::ofstream outFile(tempPath.c_str(), std::ios::binary | std::ios::trunc);
+                outFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                outFile.write(reinterpret_cast<const char*>(entityIndices.data()), entityIndices.size() * sizeof(EntityIndex));
+                for (const auto& itEntity : pendingFrame.entities)
+                {
+                    outFile.write(itEntity.second.block.data(), itEntity.second.block.size());
+                }
+                if (!outFile.good())
+                {
+                    outFile.close();
+                    remove(tempPath.c_str());
+                    GLM_CROWD_TRACE_WARNING("Could not write geometry cache file '" << tempPath << "'");
+                    return;
+                }
+            }
+
+            // segments created meanwhile by the other processes or threads are mapped on the way
+            glm::ScopedLock<TraceMutex> lock(_lock);
+            MappedFrame& mappedFrame = _getMappedFrame(frame);
+            for (; mappedFrame.nextSegmentIdx < MAX_SEGMENT_COUNT; ++mappedFrame.nextSegmentIdx)
+            {
+                std::string segmentPath = _getSegmentPath(frame, mappedFrame.nextSegmentIdx);
+                bool isCreated = _CreateFile(tempPath, segmentPath);
+                if (!isCreated && !TfIsFile(segmentPath))
+                {
+                    GLM_CROWD_TRACE_WARNING("Could not create geometry cache file '" << segmentPath << "'");
+                    break;
+                }
+                if (MappedSegment* mappedSegment = _mapSegment(frame, segmentPath))
+                {
+                    mappedFrame.segments.push_back(mappedSegment);
+                    mappedFrame.entityCount += mappedSegment->entityCount;
+                }
+                if (isCreated)
+                {
+                    ++mappedFrame.nextSegmentIdx;
+                    break;
+                }
+            }
+            remove(tempPath.c_str());
+        }
+    } // namespace usdplugin
+} // namespace glm
@@ -0,0 +1,99 @@
+/***************************************************************************
+*                                                                          *
+*  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+*                                                                          *
+***************************************************************************/
+
+#pragma once
+
+#include "glmUSD.h"
+#include "glmUSDCachedGeometry.h"
+#include "glmUSDTrace.h"
+
+USD_INCLUDES_START
+#include <pxr/pxr.h>
+#include <pxr/base/arch/fileSystem.h>
+USD_INCLUDES_END
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        using namespace PXR_INTERNAL_NS;
+
+        /// Persistent cache of the deformed points and normals, shared by all the processes opening a layer with the same key.
+        /// Each frame is made of segment files in <rootDir>/<key>/ (frame.<frame>.glmgeo, then frame.<frame>.<n>.glmgeo),
+        /// mapped read only when they exist:
+        ///   FileHeader, EntityIndex[entityCount] sorted by entity id,
+        ///   then the CachedGeometry block of each entity.
+        /// The entities missing from the segments are filled in memory while they are computed and written as a new segment
+        /// when all the entities of the frame are stored, when too many frames are pending or when the cache is destroyed.
+        class DiskGeometryCache
+        {
+        public:
+            DiskGeometryCache(const std::string& rootDir, uint64_t key, size_t entityCount);
+            ~DiskGeometryCache();
+
+            const std::string& getDirectory() const { return _dir; }
+
+            /// Returns false if no segment of the frame contains the entity
+            bool findEntity(double frame, int64_t entityId, CachedGeometry& cachedGeometry);
+
+            /// Adds the entity to the pending frame, ignored if a segment of the frame already contains it
+            void storeEntity(double frame, int64_t entityId, uint32_t geometryFileIdx, const glm::PODArray<const VtVec3fArray*>& points, const glm::PODArray<const VtVec3fArray*>& normals);
+
+            /// Writes all the pending frames
+            void flush();
+
+            /// FNV-1a, stable across processes and platforms
+            static uint64_t hash(const void* data, size_t size, uint64_t seed = 14695981039346656037ULL);
+            static uint64_t hash(const std::string& data, uint64_t seed = 14695981039346656037ULL);
+
+        private:
+            struct PendingEntity
+            {
+                uint32_t geometryFileIdx = 0;
+                uint32_t meshCount = 0;
+                std::string block; // CachedGeometry block
+            };
+
+            struct PendingFrame
+            {
+                std::map<int64_t, PendingEntity> entities; // sorted by entity id
+                uint64_t sequence = 0;                     // order of creation, the oldest frame is written first
+            };
+
+            struct MappedSegment
+            {
+                ArchConstFileMapping mapping;
+                size_t entityCount = 0;
+            };
+
+            struct MappedFrame
+            {
+                std::vector<MappedSegment*> segments; // never released before the destructor
+                size_t entityCount = 0;               // in all the segments
+                uint32_t nextSegmentIdx = 0;          // first segment which was not found on disk
+            };
+
+            std::string _getSegmentPath(double frame, uint32_t segmentIdx) const;
+            MappedSegment* _mapSegment(double frame, const std::string& segmentPath) const;
+            MappedFrame& _getMappedFrame(double frame); // _lock must be held
+            bool _findEntity(const MappedFrame& mappedFrame, int64_t entityId, CachedGeometry& cachedGeometry) const; // _lock must be held
+            void _writeFrame(double frame, const PendingFrame& pendingFrame);
+
+            std::string _dir;
+            uint64_t _key;
+            size_t _entityCount; // number of entities in a complete frame
+
+            TraceMutex _lock{GLMUSD_MUTEX_DESC("DiskGeometryCache::_lock")};
+            std::map<double, MappedFrame> _mappedFrames; // segments found on disk or written by this process
+            std::map<double, PendingFrame> _pendingFrames;
+            uint64_t _nextSequence = 0;
+        };
+    } // namespace usdplugin
+} // namespace glm
@@ -0,0 +1,91 @@
+/***************************************************************************
+*                                                                          *
+*  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+*                                                                          *
+***************************************************************************/
+
+#include "glmUSDMemoryReport.h"
+
+#include <glmStringOperators.h>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        //-----------------------------------------------------------------------------
+        const char* MemoryCategory::getName(Value category)
+        {
+            switch (category)
+            {
+            case TEMPLATE_TOPOLOGY:
+                return "templateTopology";
+            case TEMPLATE_UVS:
+                return "templateUVs";
+            case ENTITY_CACHES:
+                return "entityCaches";
+            case DEFORMED_POINTS:
+                return "deformedPoints";
+            case DEFORMED_NORMALS:
+                return "deformedNormals";
+            case SKEL_ANIM:
+                return "skelAnim";
+            case PATH_TABLES:
+                return "pathTables";
+            case ATTRIBUTE_INDEXES:
+                return "attributeIndexes";
+            case FRAME_DATA:
+                return "frameData";
+            default:
+                break;
+            }
+            return "total";
+        }
+
+        //-----------------------------------------------------------------------------
+        MemoryReport::MemoryReport()
+        {
+            memset(bytes, 0, sizeof(bytes));
+        }
+
+        //-----------------------------------------------------------------------------
+        void MemoryReport::add(MemoryCategory::Value category, size_t byteCount)
+        {
+            bytes[category] += byteCount;
+        }
+
+        //-----------------------------------------------------------------------------
+        size_t MemoryReport::getTotal() const
+        {
+            size_t total = 0;
+            for (int iCategory = 0; iCategory < MemoryCategory::END; ++iCategory)
+            {
+                total += bytes[iCategory];
+            }
+            return total;
+        }
+
+        //-----------------------------------------------------------------------------
+        MemoryReport& MemoryReport::operator+=(const MemoryReport& other)
+        {
+            for (int iCategory = 0; iCategory < MemoryCategory::END; ++iCategory)
+            {
+                bytes[iCategory] += other.bytes[iCategory];
+            }
+            return *this;
+        }
+
+        //-----------------------------------------------------------------------------
+        GlmString MemoryReport::toString(const GlmString& title) const
+        {
+            GlmString report = title + "\n";
+            char line[128];
+            for (int iCategory = 0; iCategory <= MemoryCategory::END; ++iCategory)
+            {
+                size_t byteCount = iCategory < MemoryCategory::END ? bytes[iCategory] : getTotal();
+                snprintf(line, sizeof(line), "    %-18s %12.3f MB\n", MemoryCategory::getName((MemoryCategory::Value)iCategory), byteCount / (1024. * 1024.));
+                report += line;
+            }
+            return report;
+        }
+    } // namespace usdplugin
+} // namespace glm
@@ -0,0 +1,50 @@
+/***************************************************************************
+*                                                                          *
+*  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+*                                                                          *
+***************************************************************************/
+
+#pragma once
+
+#include <glmCore.h>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        struct MemoryCategory
+        {
+            enum Value
+            {
+                TEMPLATE_TOPOLOGY, // faceVertexCounts, faceVertexIndices of the skin mesh templates
+                TEMPLATE_UVS,      // uv sets of the skin mesh templates
+                ENTITY_CACHES,     // per entity data (shader and pp attribute values, geometry inputs)
+                DEFORMED_POINTS,   // skinned points of each mesh
+                DEFORMED_NORMALS,  // skinned normals of each mesh
+                SKEL_ANIM,         // joints, rotations, scales and translations of the SkelAnimation prims
+                PATH_TABLES,       // prim spec paths, child names and path to data maps
+                ATTRIBUTE_INDEXES, // pp and shader attribute name to index maps
+                FRAME_DATA,        // devkit frame data, estimated for one decoded frame per crowd field
+                END
+            };
+
+            /// Short name of the category, used in reports and attribute names
+            static const char* getName(Value category);
+        };
+
+        struct MemoryReport
+        {
+            size_t bytes[MemoryCategory::END];
+
+            MemoryReport();
+
+            void add(MemoryCategory::Value category, size_t byteCount);
+            size_t getTotal() const;
+
+            MemoryReport& operator+=(const MemoryReport& other);
+
+            /// Human readable report, one line per category
+            GlmString toString(const GlmString& title) const;
+        };
+    } // namespace usdplugin
+} // namespace glm
@@ -0,0 +1,214 @@
+/***************************************************************************
+*                                                                          *
+*  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+*                                                                          *
+***************************************************************************/
+
+#include "glmUSDPerfCounters.h"
+
+#include <chrono>
+#include <cmath>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        //-----------------------------------------------------------------------------
+        static size_t _GetThreadShardIndex(size_t shardCount)
+        {
+            static std::atomic<size_t> s_nextThreadIndex(0);
+            static thread_local size_t s_threadIndex = s_nextThreadIndex.fetch_add(1, std::memory_order_relaxed);
+            return s_threadIndex % shardCount;
+        }
+
+        //-----------------------------------------------------------------------------
+        static void _AtomicMax(std::atomic<uint64_t>& target, uint64_t value)
+        {
+            uint64_t current = target.load(std::memory_order_relaxed);
+            while (current < value && !target.compare_exchange_weak(current, value, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        const char* PerfCounter::getName(Value counter)
+        {
+            switch (counter)
+            {
+            case QUERY_TIME_SAMPLE_CALLS:
+                return "queryTimeSampleCalls";
+            case QUERY_TIME_SAMPLE_NS:
+                return "queryTimeSampleNs";
+            case ENTITY_COMPUTES:
+                return "entityComputes";
+            case ENTITY_CACHE_HITS:
+                return "entityCacheHits";
+            case ENTITY_COMPUTE_LOCK_WAIT_NS:
+                return "entityComputeLockWaitNs";
+            case CACHED_SIMULATION_LOCK_WAIT_NS:
+                return "cachedSimulationLockWaitNs";
+            case UPDATE_LOCK_WAIT_NS:
+                return "updateLockWaitNs";
+            case SKINNING_NS:
+                return "skinningNs";
+            case DISK_CACHE_HITS:
+                return "diskCacheHits";
+            case DISK_CACHE_MISSES:
+                return "diskCacheMisses";
+            case SHM_CACHE_HITS:
+                return "shmCacheHits";
+            case SHM_CACHE_MISSES:
+                return "shmCacheMisses";
+            case SHM_CACHE_WAIT_NS:
+                return "shmCacheWaitNs";
+            default:
+                break;
+            }
+            return "unknown";
+        }
+
+        //-----------------------------------------------------------------------------
+        bool PerfCounter::isDuration(Value counter)
+        {
+            switch (counter)
+            {
+            case QUERY_TIME_SAMPLE_NS:
+            case ENTITY_COMPUTE_LOCK_WAIT_NS:
+            case CACHED_SIMULATION_LOCK_WAIT_NS:
+            case UPDATE_LOCK_WAIT_NS:
+            case SKINNING_NS:
+            case SHM_CACHE_WAIT_NS:
+                return true;
+            default:
+                break;
+            }
+            return false;
+        }
+
+        //-----------------------------------------------------------------------------
+        PerfCounters::PerfCounters()
+            : _slowestQuery(0)
+            , _startFrame(0)
+            , _frameCount(0)
+        {
+            for (size_t iShard = 0; iShard < SHARD_COUNT; ++iShard)
+            {
+                for (int iCounter = 0; iCounter < PerfCounter::END; ++iCounter)
+                {
+                    _shards[iShard].values[iCounter].store(0, std::memory_order_relaxed);
+                }
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        void PerfCounters::setFrameRange(int startFrame, int endFrame)
+        {
+            _startFrame = startFrame;
+            _frameCount = endFrame >= startFrame ? endFrame - startFrame + 1 : 0;
+            _slowestQueryPerFrame.reset(_frameCount > 0 ? new std::atomic<uint64_t>[_frameCount] : nullptr);
+            for (size_t iFrame = 0; iFrame < _frameCount; ++iFrame)
+            {
+                _slowestQueryPerFrame[iFrame].store(0, std::memory_order_relaxed);
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        void PerfCounters::add(PerfCounter::Value counter, uint64_t value)
+        {
+            _shards[_GetThreadShardIndex(SHARD_COUNT)].values[counter].fetch_add(value, std::memory_order_relaxed);
+        }
+
+        //-----------------------------------------------------------------------------
+        uint64_t PerfCounters::get(PerfCounter::Value counter) const
+        {
+            uint64_t total = 0;
+            for (size_t iShard = 0; iShard < SHARD_COUNT; ++iShard)
+            {
+                total += _shards[iShard].values[counter].load(std::memory_order_relaxed);
+            }
+            return total;
+        }
+
+        //-----------------------------------------------------------------------------
+        void PerfCounters::recordQuery(double frame, uint64_t durationNs)
+        {
+            Shard& shard = _shards[_GetThreadShardIndex(SHARD_COUNT)];
+            shard.values[PerfCounter::QUERY_TIME_SAMPLE_CALLS].fetch_add(1, std::memory_order_relaxed);
+            shard.values[PerfCounter::QUERY_TIME_SAMPLE_NS].fetch_add(durationNs, std::memory_order_relaxed);
+
+            _AtomicMax(_slowestQuery, durationNs);
+            // subframes are accounted on their frame
+            double frameOffset = floor(frame) - _startFrame;
+            if (frameOffset >= 0 && frameOffset < _frameCount)
+            {
+                _AtomicMax(_slowestQueryPerFrame[(size_t)frameOffset], durationNs);
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        double PerfCounters::getCacheHitRatio() const
+        {
+            uint64_t hits = get(PerfCounter::ENTITY_CACHE_HITS);
+            uint64_t total = hits + get(PerfCounter::ENTITY_COMPUTES);
+            return total > 0 ? double(hits) / double(total) : 0.;
+        }
+
+        //-----------------------------------------------------------------------------
+        uint64_t PerfCounters::getSlowestQuery() const
+        {
+            return _slowestQuery.load(std::memory_order_relaxed);
+        }
+
+        //-----------------------------------------------------------------------------
+        uint64_t PerfCounters::getSlowestQuery(size_t frameIndex) const
+        {
+            return frameIndex < _frameCount ? _slowestQueryPerFrame[frameIndex].load(std::memory_order_relaxed) : 0;
+        }
+
+        //-----------------------------------------------------------------------------
+        GlmString PerfCounters::toString(const GlmString& title) const
+        {
+            GlmString report = title + "\n";
+            char line[128];
+            for (int iCounter = 0; iCounter < PerfCounter::END; ++iCounter)
+            {
+                PerfCounter::Value counter = (PerfCounter::Value)iCounter;
+                if (PerfCounter::isDuration(counter))
+                {
+                    snprintf(line, sizeof(line), "    %-28s %12.3f ms\n", PerfCounter::getName(counter), get(counter) * 1e-6);
+                }
+                else
+                {
+                    snprintf(line, sizeof(line), "    %-28s %12llu\n", PerfCounter::getName(counter), (unsigned long long)get(counter));
+                }
+                report += line;
+            }
+            snprintf(line, sizeof(line), "    %-28s %12.3f %%\n", "cacheHitRatio", getCacheHitRatio() * 100.);
+            report += line;
+
+            size_t slowestFrameIndex = 0;
+            for (size_t iFrame = 1; iFrame < _frameCount; ++iFrame)
+            {
+                if (getSlowestQuery(iFrame) > getSlowestQuery(slowestFrameIndex))
+                {
+                    slowestFrameIndex = iFrame;
+                }
+            }
+            snprintf(line, sizeof(line), "    %-28s %12.3f ms\n", "slowestQuery", getSlowestQuery() * 1e-6);
+            report += line;
+            if (_frameCount > 0)
+            {
+                snprintf(line, sizeof(line), "    %-28s %12.3f ms (frame %d)\n", "slowestFrameQuery", getSlowestQuery(slowestFrameIndex) * 1e-6, _startFrame + (int)slowestFrameIndex);
+                report += line;
+            }
+            return report;
+        }
+
+        /*static*/
+        //-----------------------------------------------------------------------------
+        uint64_t PerfCounters::now()
+        {
+            return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+    } // namespace usdplugin
+} // namespace glm
@@ -0,0 +1,109 @@
+/***************************************************************************
+*                                                                          *
+*  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+*                                                                          *
+***************************************************************************/
+
+#pragma once
+
+#include <glmCore.h>
+
+#include <atomic>
+#include <memory>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        struct PerfCounter
+        {
+            enum Value
+            {
+                QUERY_TIME_SAMPLE_CALLS,        // number of QueryTimeSample calls
+                QUERY_TIME_SAMPLE_NS,           // total time spent in QueryTimeSample
+                ENTITY_COMPUTES,                // entity computes (frame changed since last query)
+                ENTITY_CACHE_HITS,              // entity queries served from the already computed frame
+                ENTITY_COMPUTE_LOCK_WAIT_NS,    // time waiting on the entityComputeLock
+                CACHED_SIMULATION_LOCK_WAIT_NS, // time waiting on the crowd field source lock
+                UPDATE_LOCK_WAIT_NS,            // time waiting on the usd wrapper _updateLock
+                SKINNING_NS,                    // time spent in glmPrepareEntityGeometry and the points/normals extraction
+                DISK_CACHE_HITS,                // entity geometries read from the disk geometry cache
+                DISK_CACHE_MISSES,              // entity geometries missing from the disk geometry cache
+                SHM_CACHE_HITS,                 // entity geometries read from the shared memory geometry cache
+                SHM_CACHE_MISSES,               // entity geometries claimed or unavailable in the shared memory geometry cache
+                SHM_CACHE_WAIT_NS,              // time waiting for other processes to publish entity geometries
+                END
+            };
+
+            /// Short name of the counter, used in reports and attribute names
+            static const char* getName(Value counter);
+
+            /// True if the counter holds a duration in nanoseconds
+            static bool isDuration(Value counter);
+        };
+
+        /// Lock-free counters: each thread adds to its own cache line with relaxed atomics, reads sum all shards
+        class PerfCounters
+        {
+        public:
+            PerfCounters();
+
+            /// Allocates the per frame slowest query latencies, must be called before any query
+            void setFrameRange(int startFrame, int endFrame);
+
+            void add(PerfCounter::Value counter, uint64_t value);
+            uint64_t get(PerfCounter::Value counter) const;
+
+            /// Counts a QueryTimeSample call and keeps the slowest one per frame
+            void recordQuery(double frame, uint64_t durationNs);
+
+            /// entityCacheHits / (entityCacheHits + entityComputes)
+            double getCacheHitRatio() const;
+
+            int getStartFrame() const { return _startFrame; }
+            size_t getFrameCount() const { return _frameCount; }
+            uint64_t getSlowestQuery() const;
+            uint64_t getSlowestQuery(size_t frameIndex) const;
+
+            GlmString toString(const GlmString& title) const;
+
+            /// Monotonic clock in nanoseconds
+            static uint64_t now();
+
+        private:
+            static const size_t SHARD_COUNT = 16;
+
+            struct alignas(64) Shard
+            {
+                std::atomic<uint64_t> values[PerfCounter::END];
+            };
+
+            Shard _shards[SHARD_COUNT];
+            std::atomic<uint64_t> _slowestQuery;
+            std::unique_ptr<std::atomic<uint64_t>[]> _slowestQueryPerFrame;
+            int _startFrame;
+            size_t _frameCount;
+        };
+
+        /// Adds the elapsed time of its scope to a duration counter
+        class PerfScopedTimer
+        {
+        public:
+            PerfScopedTimer(PerfCounters& counters, PerfCounter::Value counter)
+                : _counters(counters)
+                , _counter(counter)
+                , _start(PerfCounters::now())
+            {
+            }
+            ~PerfScopedTimer()
+            {
+                _counters.add(_counter, PerfCounters::now() - _start);
+            }
+
+        private:
+            PerfCounters& _counters;
+            PerfCounter::Value _counter;
+            uint64_t _start;
+        };
+    } // namespace usdplugin
+} // namespace glm
@@ -0,0 +1,538 @@
+/***************************************************************************
+*                                                                          *
+*  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+*                                                                          *
+***************************************************************************/
+
+#include "glmUSDSharedGeometryCache.h"
+
+USD_INCLUDES_START
+#include <pxr/base/tf/stringUtils.h>
+USD_INCLUDES_END
+
+#include <glmLog.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// the index lives in memory shared between processes: its atomics must not rely on a process local lock
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2, "the shared geometry cache needs lock-free atomics");
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        namespace
+        {
+            const uint64_t SEGMENT_MAGIC = 0x32304d474d4c47ULL; // "GLMGM02", set last by the creator
+            const uint64_t MIN_SLOT_COUNT = 1024;
+            const uint64_t BYTES_PER_SLOT = 16384; // expected average entity block size
+            const uint64_t MAX_PROBES = 64;
+            const uint64_t DATA_ALIGNMENT = 16;
+            const size_t MAX_ATTACHED_PROCESSES = 256; // processes tracked to remove the segment when they all exited or crashed
+
+            // a process waiting for another one to publish gives up after this delay, the writer is checked meanwhile in case it crashed
+            const std::chrono::milliseconds WRITER_TIMEOUT(30000);
+            const std::chrono::milliseconds WRITER_CHECK_PERIOD(100);
+            const std::chrono::milliseconds OPEN_TIMEOUT(5000);
+
+            //-----------------------------------------------------------------------------
+            uint64_t _Mix(uint64_t value)
+            {
+                // splitmix64 finalizer
+                value ^= value >> 30;
+                value *= 0xbf58476d1ce4e5b9ULL;
+                value ^= value >> 27;
+                value *= 0x94d049bb133111ebULL;
+                value ^= value >> 31;
+                return value;
+            }
+
+            //-----------------------------------------------------------------------------
+            uint64_t _MakeTag(double frame, int64_t entityId)
+            {
+                uint64_t frameBits = 0;
+                memcpy(&frameBits, &frame, sizeof(frameBits));
+                return _Mix(frameBits ^ _Mix((uint64_t)entityId)) | 1; // 0 marks empty slots
+            }
+
+            //-----------------------------------------------------------------------------
+            int32_t _GetProcessId()
+            {
+#ifdef _WIN32
+                return 0;
+#else
+                return (int32_t)getpid();
+#endif
+            }
+
+            //-----------------------------------------------------------------------------
+            bool _IsProcessAlive(int32_t processId)
+            {
+#ifdef _WIN32
+                return true;
+#else
+                // EPERM: the process exists but belongs to another user
+                return processId <= 0 || kill((pid_t)processId, 0) == 0 || errno != ESRCH;
+#endif
+            }
+
+#ifndef _WIN32
+            //-----------------------------------------------------------------------------
+            void _UnlinkSegment(const std::string& name, int fileDescriptor)
+            {
+                // another process may have replaced the segment meanwhile: only remove this one
+                int namedFileDescriptor = shm_open(name.c_str(), O_RDONLY, 0600);
+                if (namedFileDescriptor < 0)
+                {
+                    return;
+                }
+                struct stat segmentStat;
+                struct stat namedSegmentStat;
+                bool isSameSegment = fstat(fileDescriptor, &segmentStat) == 0 && fstat(namedFileDescriptor, &namedSegmentStat) == 0 && segmentStat.st_dev == namedSegmentStat.st_dev && segmentStat.st_ino == namedSegmentStat.st_ino;
+                close(namedFileDescriptor);
+                if (isSameSegment)
+                {
+                    shm_unlink(name.c_str());
+                }
+            }
+#endif
+
+            //-----------------------------------------------------------------------------
+            uint64_t _NextPowerOfTwo(uint64_t value)
+            {
+                uint64_t result = 1;
+                while (result < value)
+                {
+                    result <<= 1;
+                }
+                return result;
+            }
+        } // namespace
+
+        struct SharedGeometryCache::SegmentHeader
+        {
+            std::atomic<uint64_t> magic;
+            uint64_t segmentSize;
+            uint64_t slotCount; // power of two
+            uint64_t dataOffset;
+            std::atomic<uint64_t> dataUsed;
+            std::atomic<int32_t> attachedProcessIds[MAX_ATTACHED_PROCESSES]; // 0 for the free entries
+        };
+
+        struct SharedGeometryCache::Slot
+        {
+            enum State
+            {
+                CLAIMING,  // abandoned slot claimed again, its new owner being written
+                COMPUTING, // the owner process is computing the entity
+                READY,     // the block can be read
+                ABANDONED  // the owner process failed or died, can be claimed again
+            };
+
+            std::atomic<uint64_t> tag; // 0 when the slot is empty, set last when a slot is claimed
+            std::atomic<uint32_t> state;
+            uint32_t meshCount;
+            double frame;
+            int64_t entityId;
+            uint64_t dataOffset; // from the beginning of the segment
+            uint32_t geometryFileIdx;
+            std::atomic<int32_t> ownerProcessId; // process computing the entity, set before the tag: 0 when the slot is free
+        };
+
+        //-----------------------------------------------------------------------------
+        SharedGeometryCache::Claim::~Claim()
+        {
+            if (_cache != NULL)
+            {
+                _cache->_abandon(_slotIdx);
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        void SharedGeometryCache::Claim::publish(uint32_t geometryFileIdx, const glm::PODArray<const VtVec3fArray*>& points, const glm::PODArray<const VtVec3fArray*>& normals)
+        {
+            GLM_DEBUG_ASSERT(_cache != NULL);
+            _cache->_publish(_slotIdx, geometryFileIdx, points, normals);
+            _cache = NULL;
+        }
+
+        //-----------------------------------------------------------------------------
+        SharedGeometryCache::SharedGeometryCache(const std::string& name, char* segment, size_t segmentSize, int fileDescriptor)
+            : _name(name)
+            , _segment(segment)
+            , _segmentSize(segmentSize)
+            , _fileDescriptor(fileDescriptor)
+        {
+        }
+
+        /*static*/
+        //-----------------------------------------------------------------------------
+        bool SharedGeometryCache::_attachProcess(SegmentHeader* header, int32_t processId)
+        {
+            // the entries of the crashed processes are reused
+            for (size_t iProcess = 0; iProcess < MAX_ATTACHED_PROCESSES; ++iProcess)
+            {
+                int32_t attachedProcessId = header->attachedProcessIds[iProcess].load(std::memory_order_acquire);
+                if ((attachedProcessId == 0 || !_IsProcessAlive(attachedProcessId)) && header->attachedProcessIds[iProcess].compare_exchange_strong(attachedProcessId, processId, std::memory_order_acq_rel))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /*static*/
+        //-----------------------------------------------------------------------------
+        void SharedGeometryCache::_detachProcess(SegmentHeader* header, int32_t processId)
+        {
+            for (size_t iProcess = 0; iProcess < MAX_ATTACHED_PROCESSES; ++iProcess)
+            {
+                int32_t attachedProcessId = processId;
+                if (header->attachedProcessIds[iProcess].compare_exchange_strong(attachedProcessId, 0, std::memory_order_acq_rel))
+                {
+                    return;
+                }
+            }
+        }
+
+        /*static*/
+        //-----------------------------------------------------------------------------
+        bool SharedGeometryCache::_hasAttachedProcesses(const SegmentHeader* header)
+        {
+            // the crashed processes never detach: only the live ones keep the segment
+            for (size_t iProcess = 0; iProcess < MAX_ATTACHED_PROCESSES; ++iProcess)
+            {
+                int32_t attachedProcessId = header->attachedProcessIds[iProcess].load(std::memory_order_acquire);
+                if (attachedProcessId != 0 && _IsProcessAlive(attachedProcessId))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+#ifdef _WIN32
+
+        //-----------------------------------------------------------------------------
+        SharedGeometryCache* SharedGeometryCache::open(uint64_t, size_t)
+        {
+            GLM_CROWD_TRACE_WARNING("The shared memory geometry cache is not available on Windows");
+            return NULL;
+        }
+
+        //-----------------------------------------------------------------------------
+        SharedGeometryCache::~SharedGeometryCache()
+        {
+        }
+
+#else
+
+        //-----------------------------------------------------------------------------
+        SharedGeometryCache* SharedGeometryCache::open(uint64_t key, size_t segmentSize)
+        {
+            size_t requestedSegmentSize = segmentSize; // the size of a segment created by another process is used instead
+            uint64_t slotCount = _NextPowerOfTwo(std::max<uint64_t>(MIN_SLOT_COUNT, segmentSize / BYTES_PER_SLOT));
+            uint64_t dataOffset = sizeof(SegmentHeader) + slotCount * sizeof(Slot);
+            dataOffset = (dataOffset + DATA_ALIGNMENT - 1) / DATA_ALIGNMENT * DATA_ALIGNMENT;
+            if (segmentSize <= dataOffset)
+            {
+                GLM_CROWD_TRACE_WARNING("The shared memory geometry cache size is too small: " << segmentSize << " bytes");
+                return NULL;
+            }
+
+            // the render processes of a node share the cache as long as they run as the same user
+            std::string name = TfStringPrintf("/glmusd.%016llx", (unsigned long long)key);
+            int fileDescriptor = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+            bool isCreator = fileDescriptor >= 0;
+            if (!isCreator && errno == EEXIST)
+            {
+                fileDescriptor = shm_open(name.c_str(), O_RDWR, 0600);
+            }
+            if (fileDescriptor < 0)
+            {
+                GLM_CROWD_TRACE_WARNING("Could not open the shared memory geometry cache '" << name << "': " << strerror(errno));
+                return NULL;
+            }
+
+            auto openStart = std::chrono::steady_clock::now();
+            if (isCreator)
+            {
+                // the segment is zero filled: all the slots are empty
+                if (ftruncate(fileDescriptor, (off_t)segmentSize) != 0)
+                {
+                    GLM_CROWD_TRACE_WARNING("Could not allocate the shared memory geometry cache '" << name << "': " << strerror(errno));
+                    close(fileDescriptor);
+                    shm_unlink(name.c_str());
+                    return NULL;
+                }
+            }
+            else
+            {
+                // the segment created by another process has its own size
+                struct stat segmentStat;
+                while (fstat(fileDescriptor, &segmentStat) == 0 && segmentStat.st_size == 0 && std::chrono::steady_clock::now() - openStart < OPEN_TIMEOUT)
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+                segmentSize = fstat(fileDescriptor, &segmentStat) == 0 ? (size_t)segmentStat.st_size : 0;
+                if (segmentSize < sizeof(SegmentHeader))
+                {
+                    GLM_CROWD_TRACE_WARNING("Invalid shared memory geometry cache '" << name << "'");
+                    close(fileDescriptor);
+                    return NULL;
+                }
+            }
+
+            void* segment = mmap(NULL, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+            if (segment == MAP_FAILED)
+            {
+                GLM_CROWD_TRACE_WARNING("Could not map the shared memory geometry cache '" << name << "': " << strerror(errno));
+                close(fileDescriptor);
+                if (isCreator)
+                {
+                    shm_unlink(name.c_str());
+                }
+                return NULL;
+            }
+
+            SegmentHeader* header = reinterpret_cast<SegmentHeader*>(segment);
+            if (isCreator)
+            {
+                header->segmentSize = segmentSize;
+                header->slotCount = slotCount;
+                header->dataOffset = dataOffset;
+                header->dataUsed.store(dataOffset, std::memory_order_relaxed);
+                // attached before the magic is set: the processes attaching meanwhile do not take the segment for a stale one
+                _attachProcess(header, _GetProcessId());
+                header->magic.store(SEGMENT_MAGIC, std::memory_order_release);
+            }
+            else
+            {
+                while (header->magic.load(std::memory_order_acquire) != SEGMENT_MAGIC && std::chrono::steady_clock::now() - openStart < OPEN_TIMEOUT)
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+                // the index must fit in the segment: the slots are addressed with its slot count
+                bool isValid = header->magic.load(std::memory_order_acquire) == SEGMENT_MAGIC && header->segmentSize == segmentSize;
+                isValid = isValid && header->slotCount > 0 && (header->slotCount & (header->slotCount - 1)) == 0 && header->slotCount <= (segmentSize - sizeof(SegmentHeader)) / sizeof(Slot);
+                if (!isValid)
+                {
+                    GLM_CROWD_TRACE_WARNING("Invalid shared memory geometry cache '" << name << "'");
+                    if (!_hasAttachedProcesses(header))
+                    {
+                        // its creator crashed before initializing it: the next processes create a new one
+                        _UnlinkSegment(name, fileDescriptor);
+                    }
+                    munmap(segment, segmentSize);
+                    close(fileDescriptor);
+                    return NULL;
+                }
+                if (!_hasAttachedProcesses(header))
+                {
+                    // left by crashed processes, possibly full: replaced by a new segment, which has a live creator
+                    _UnlinkSegment(name, fileDescriptor);
+                    munmap(segment, segmentSize);
+                    close(fileDescriptor);
+                    return open(key, requestedSegmentSize);
+                }
+                if (!_attachProcess(header, _GetProcessId()))
+                {
+                    // the segment may be removed while this process uses it, its mapping stays valid
+                    GLM_CROWD_TRACE_WARNING_LIMIT("Too many processes attached to the shared memory geometry cache '" << name << "'");
+                }
+            }
+
+            return new SharedGeometryCache(name, static_cast<char*>(segment), segmentSize, fileDescriptor);
+        }
+
+        //-----------------------------------------------------------------------------
+        SharedGeometryCache::~SharedGeometryCache()
+        {
+            SegmentHeader* header = reinterpret_cast<SegmentHeader*>(_segment);
+            _detachProcess(header, _GetProcessId());
+            if (!_hasAttachedProcesses(header))
+            {
+                // last live process: processes which attach later create a new segment
+                _UnlinkSegment(_name, _fileDescriptor);
+            }
+            munmap(_segment, _segmentSize);
+            close(_fileDescriptor);
+        }
+
+#endif
+
+        //-----------------------------------------------------------------------------
+        SharedGeometryCache::Slot* SharedGeometryCache::_getSlot(uint64_t slotIdx) const
+        {
+            return reinterpret_cast<Slot*>(_segment + sizeof(SegmentHeader)) + slotIdx;
+        }
+
+        //-----------------------------------------------------------------------------
+        SharedGeometryCache::LookupResult::Value SharedGeometryCache::findOrClaim(double frame, int64_t entityId, CachedGeometry& cachedGeometry, Claim& claim, uint64_t& waitNs)
+        {
+            waitNs = 0;
+            const SegmentHeader* header = reinterpret_cast<const SegmentHeader*>(_segment);
+            uint64_t tag = _MakeTag(frame, entityId);
+            uint64_t slotMask = header->slotCount - 1;
+            // when the data area is full, computed entities cannot be published anymore: do not make other processes wait for them
+            bool isFull = header->dataUsed.load(std::memory_order_relaxed) >= header->segmentSize;
+            int32_t processId = _GetProcessId();
+            auto waitStart = std::chrono::steady_clock::now();
+            auto getWaitNs = [&waitStart]() { return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - waitStart).count(); };
+            for (uint64_t iProbe = 0; iProbe < MAX_PROBES; ++iProbe)
+            {
+                uint64_t slotIdx = (tag + iProbe) & slotMask;
+                Slot* slot = _getSlot(slotIdx);
+                uint64_t slotTag = slot->tag.load(std::memory_order_acquire);
+                if (slotTag == 0)
+                {
+                    if (isFull)
+                    {
+                        return LookupResult::UNAVAILABLE;
+                    }
+                    // the owner is set before the tag: a process which dies while it claims the slot is detected
+                    int32_t slotOwnerId = 0;
+                    bool isClaimed = slot->ownerProcessId.compare_exchange_strong(slotOwnerId, processId, std::memory_order_acq_rel);
+                    auto lastCheck = std::chrono::steady_clock::now();
+                    while (!isClaimed)
+                    {
+                        // claimed by another process: wait for its tag
+                        std::this_thread::sleep_for(std::chrono::microseconds(200));
+                        slotTag = slot->tag.load(std::memory_order_acquire);
+                        if (slotTag != 0)
+                        {
+                            break;
+                        }
+                        if (std::chrono::steady_clock::now() - waitStart >= WRITER_TIMEOUT)
+                        {
+                            waitNs = getWaitNs();
+                            return LookupResult::UNAVAILABLE;
+                        }
+                        if (std::chrono::steady_clock::now() - lastCheck >= WRITER_CHECK_PERIOD)
+                        {
+                            // slotOwnerId is updated to the new owner when another process took the slot of the dead one
+                            lastCheck = std::chrono::steady_clock::now();
+                            isClaimed = !_IsProcessAlive(slotOwnerId) && slot->ownerProcessId.compare_exchange_strong(slotOwnerId, processId, std::memory_order_acq_rel);
+                        }
+                    }
+                    if (isClaimed)
+                    {
+                        slot->frame = frame;
+                        slot->entityId = entityId;
+                        slot->state.store(Slot::COMPUTING, std::memory_order_relaxed);
+                        slot->tag.store(tag, std::memory_order_release);
+                        claim._cache = this;
+                        claim._slotIdx = slotIdx;
+                        waitNs = getWaitNs();
+                        return LookupResult::CLAIMED;
+                    }
+                }
+                if (slotTag != tag)
+                {
+                    continue;
+                }
+                // the frame and entity id are written before the tag
+                if (slot->frame != frame || slot->entityId != entityId)
+                {
+                    // tag collision
+                    continue;
+                }
+
+                uint32_t state = slot->state.load(std::memory_order_acquire);
+                auto lastCheck = std::chrono::steady_clock::now();
+                while ((state == Slot::CLAIMING || state == Slot::COMPUTING) && std::chrono::steady_clock::now() - waitStart < WRITER_TIMEOUT)
+                {
+                    std::this_thread::sleep_for(std::chrono::microseconds(200));
+                    state = slot->state.load(std::memory_order_acquire);
+                    if ((state == Slot::CLAIMING || state == Slot::COMPUTING) && std::chrono::steady_clock::now() - lastCheck >= WRITER_CHECK_PERIOD)
+                    {
+                        // an owner which died while claiming or computing never publishes: the slot is abandoned for it.
+                        // While an abandoned slot is claimed again the owner may still be the dead one: the new owner then computes locally
+                        lastCheck = std::chrono::steady_clock::now();
+                        uint32_t ownedState = state;
+                        if (!_IsProcessAlive(slot->ownerProcessId.load(std::memory_order_acquire)) && slot->state.compare_exchange_strong(ownedState, Slot::ABANDONED, std::memory_order_acq_rel))
+                        {
+                            GLM_CROWD_TRACE_WARNING_LIMIT("The process computing the entity '" << entityId << "' at frame " << frame << " died, computing it again");
+                            ownedState = Slot::ABANDONED;
+                        }
+                        state = ownedState;
+                    }
+                }
+                waitNs = getWaitNs();
+
+                if (state == Slot::READY)
+                {
+                    // the segment may be corrupted by a crashed process: never read outside of its data area
+                    uint64_t dataOffset = slot->dataOffset;
+                    uint32_t meshCount = slot->meshCount;
+                    if (dataOffset < header->dataOffset || dataOffset >= _segmentSize || !CachedGeometry::isBlockInside(_segment + dataOffset, meshCount, _segmentSize - dataOffset))
+                    {
+                        GLM_CROWD_TRACE_ERROR_LIMIT("Invalid block of the entity '" << entityId << "' at frame " << frame << " in the shared memory geometry cache '" << _name << "'");
+                        return LookupResult::UNAVAILABLE;
+                    }
+                    cachedGeometry.geometryFileIdx = slot->geometryFileIdx;
+                    cachedGeometry.meshCount = meshCount;
+                    cachedGeometry.data = _segment + dataOffset;
+                    return LookupResult::FOUND;
+                }
+                uint32_t abandonedState = Slot::ABANDONED;
+                if (state == Slot::ABANDONED && !isFull && slot->state.compare_exchange_strong(abandonedState, Slot::CLAIMING, std::memory_order_acq_rel))
+                {
+                    slot->ownerProcessId.store(processId, std::memory_order_release);
+                    uint32_t claimingState = Slot::CLAIMING;
+                    if (slot->state.compare_exchange_strong(claimingState, Slot::COMPUTING, std::memory_order_acq_rel))
+                    {
+                        claim._cache = this;
+                        claim._slotIdx = slotIdx;
+                        return LookupResult::CLAIMED;
+                    }
+                    // abandoned meanwhile by a process which saw the previous owner
+                }
+                return LookupResult::UNAVAILABLE;
+            }
+            return LookupResult::UNAVAILABLE;
+        }
+
+        //-----------------------------------------------------------------------------
+        void SharedGeometryCache::_publish(uint64_t slotIdx, uint32_t geometryFileIdx, const glm::PODArray<const VtVec3fArray*>& points, const glm::PODArray<const VtVec3fArray*>& normals)
+        {
+            SegmentHeader* header = reinterpret_cast<SegmentHeader*>(_segment);
+            Slot* slot = _getSlot(slotIdx);
+
+            uint64_t blockSize = CachedGeometry::computeBlockSize(points, normals);
+            uint64_t allocatedSize = (blockSize + DATA_ALIGNMENT - 1) / DATA_ALIGNMENT * DATA_ALIGNMENT;
+            uint64_t dataOffset = header->dataUsed.fetch_add(allocatedSize, std::memory_order_relaxed);
+            if (dataOffset + blockSize > header->segmentSize)
+            {
+                // full, the processes waiting for this entity will compute it locally
+                slot->state.store(Slot::ABANDONED, std::memory_order_release);
+                return;
+            }
+
+            CachedGeometry::writeBlock(_segment + dataOffset, points, normals);
+            slot->geometryFileIdx = geometryFileIdx;
+            slot->meshCount = (uint32_t)points.size();
+            slot->dataOffset = dataOffset;
+            slot->state.store(Slot::READY, std::memory_order_release);
+        }
+
+        //-----------------------------------------------------------------------------
+        void SharedGeometryCache::_abandon(uint64_t slotIdx)
+        {
+            _getSlot(slotIdx)->state.store(Slot::ABANDONED, std::memory_order_release);
+        }
+    } // namespace usdplugin
+} // namespace glm
@@ -0,0 +1,85 @@
+/***************************************************************************
+*                                                                          *
+*  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+*                                                                          *
+***************************************************************************/
+
+#pragma once
+
+#include "glmUSDCachedGeometry.h"
+
+#include <string>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        /// Node-local cache of the deformed geometry, shared by the render processes opening a layer with the same key.
+        /// A POSIX shared memory segment "/glmusd.<key>" holds a lock-free open addressing index of (frame, entity id)
+        /// and a bump allocated data area of CachedGeometry blocks. The process which claims an entity frame computes
+        /// and publishes it, the other processes wait for it and read the block in place, or claim it again if the process died.
+        /// Nothing is evicted: when the segment is full, entities are computed locally. The segment is only accessible to its
+        /// user and is removed when the last live process detaches, or by the next process opening it if they all crashed.
+        class SharedGeometryCache
+        {
+        public:
+            struct LookupResult
+            {
+                enum Value
+                {
+                    FOUND,      // cachedGeometry points to the shared block
+                    CLAIMED,    // the caller must compute the entity and publish it with the claim
+                    UNAVAILABLE // index full, writer timed out: compute locally
+                };
+            };
+
+            // Entity frame claimed by this process, abandoned by the destructor if it is not published
+            class Claim
+            {
+            public:
+                Claim() {}
+                ~Claim();
+
+                bool isValid() const { return _cache != NULL; }
+                void publish(uint32_t geometryFileIdx, const glm::PODArray<const VtVec3fArray*>& points, const glm::PODArray<const VtVec3fArray*>& normals);
+
+            private:
+                Claim(const Claim&) = delete;
+                Claim& operator=(const Claim&) = delete;
+
+                friend class SharedGeometryCache;
+                SharedGeometryCache* _cache = NULL;
+                uint64_t _slotIdx = 0;
+            };
+
+            /// Creates or attaches the segment of the key, returns NULL on failure
+            static SharedGeometryCache* open(uint64_t key, size_t segmentSize);
+            ~SharedGeometryCache();
+
+            const std::string& getName() const { return _name; }
+
+            /// Waits for other processes computing the same entity frame, waitNs is the time spent waiting
+            LookupResult::Value findOrClaim(double frame, int64_t entityId, CachedGeometry& cachedGeometry, Claim& claim, uint64_t& waitNs);
+
+        private:
+            struct SegmentHeader;
+            struct Slot;
+
+            SharedGeometryCache(const std::string& name, char* segment, size_t segmentSize, int fileDescriptor);
+
+            // attached processes of the segment, by process id
+            static bool _attachProcess(SegmentHeader* header, int32_t processId);
+            static void _detachProcess(SegmentHeader* header, int32_t processId);
+            static bool _hasAttachedProcesses(const SegmentHeader* header);
+
+            Slot* _getSlot(uint64_t slotIdx) const;
+            void _publish(uint64_t slotIdx, uint32_t geometryFileIdx, const glm::PODArray<const VtVec3fArray*>& points, const glm::PODArray<const VtVec3fArray*>& normals);
+            void _abandon(uint64_t slotIdx);
+
+            std::string _name;
+            char* _segment;
+            size_t _segmentSize;
+            int _fileDescriptor;
+        };
+    } // namespace usdplugin
+} // namespace glm
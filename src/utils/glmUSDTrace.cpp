@@ -0,0 +1,173 @@
+/***************************************************************************
+*                                                                          *
+*  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+*                                                                          *
+***************************************************************************/
+
+#include "glmUSDTrace.h"
+
+#ifndef TRACY_ENABLE
+
+#include "glmUSD.h"
+
+#include <glmLog.h>
+#include <glmScopedLock.h>
+
+USD_INCLUDES_START
+
+#include <pxr/pxr.h>
+#include <pxr/base/tf/envSetting.h>
+
+USD_INCLUDES_END
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        using namespace PXR_INTERNAL_NS;
+
+        TF_DEFINE_ENV_SETTING(GLMUSD_CHROME_TRACE, "", "Record the Golaem USD profiling zones to this Chrome trace file (chrome://tracing, Perfetto).");
+
+        struct ChromeTraceEvent
+        {
+            const char* name;
+            uint64_t startNs;
+            uint64_t endNs; // 0 for a frame mark
+            double frame;
+        };
+
+        // Events are recorded per thread to avoid contention, each buffer lock is only contended during a flush
+        struct ChromeTraceThreadBuffer
+        {
+            glm::Mutex lock;
+            std::vector<ChromeTraceEvent> events;
+            uint32_t threadId = 0;
+        };
+
+        struct ChromeTraceRegistry
+        {
+            glm::Mutex lock;
+            std::vector<std::shared_ptr<ChromeTraceThreadBuffer>> threadBuffers;
+            uint64_t startNs = 0;
+        };
+
+        //-----------------------------------------------------------------------------
+        static ChromeTraceRegistry& _GetRegistry()
+        {
+            static ChromeTraceRegistry s_registry;
+            return s_registry;
+        }
+
+        //-----------------------------------------------------------------------------
+        static void _FlushAtExit()
+        {
+            ChromeTrace::flush();
+        }
+
+        //-----------------------------------------------------------------------------
+        static ChromeTraceThreadBuffer& _GetThreadBuffer()
+        {
+            static thread_local std::shared_ptr<ChromeTraceThreadBuffer> s_threadBuffer;
+            if (s_threadBuffer == nullptr)
+            {
+                s_threadBuffer = std::make_shared<ChromeTraceThreadBuffer>();
+                ChromeTraceRegistry& registry = _GetRegistry();
+                glm::ScopedLock<glm::Mutex> registryLock(registry.lock);
+                s_threadBuffer->threadId = (uint32_t)registry.threadBuffers.size() + 1;
+                registry.threadBuffers.push_back(s_threadBuffer);
+            }
+            return *s_threadBuffer;
+        }
+
+        //-----------------------------------------------------------------------------
+        bool ChromeTrace::isEnabled()
+        {
+            static const bool s_enabled = []() {
+                if (TfGetEnvSetting(GLMUSD_CHROME_TRACE).empty())
+                {
+                    return false;
+                }
+                // the registry must outlive the exit flush: construct it before registering
+                _GetRegistry().startNs = now();
+                std::atexit(_FlushAtExit);
+                return true;
+            }();
+            return s_enabled;
+        }
+
+        //-----------------------------------------------------------------------------
+        uint64_t ChromeTrace::now()
+        {
+            return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        //-----------------------------------------------------------------------------
+        void ChromeTrace::addZone(const char* name, uint64_t startNs, uint64_t endNs)
+        {
+            ChromeTraceThreadBuffer& threadBuffer = _GetThreadBuffer();
+            glm::ScopedLock<glm::Mutex> bufferLock(threadBuffer.lock);
+            threadBuffer.events.push_back({name, startNs, endNs, 0.});
+        }
+
+        //-----------------------------------------------------------------------------
+        void ChromeTrace::addFrameMark(double frame)
+        {
+            if (!isEnabled())
+            {
+                return;
+            }
+            ChromeTraceThreadBuffer& threadBuffer = _GetThreadBuffer();
+            glm::ScopedLock<glm::Mutex> bufferLock(threadBuffer.lock);
+            threadBuffer.events.push_back({"Frame", now(), 0, frame});
+        }
+
+        //-----------------------------------------------------------------------------
+        void ChromeTrace::flush()
+        {
+            if (!isEnabled())
+            {
+                return;
+            }
+            const std::string tracePath = TfGetEnvSetting(GLMUSD_CHROME_TRACE);
+            FILE* traceFile = fopen(tracePath.c_str(), "w");
+            if (traceFile == NULL)
+            {
+                GLM_CROWD_TRACE_ERROR("Failed to write the Chrome trace file '" << tracePath.c_str() << "'");
+                return;
+            }
+
+            ChromeTraceRegistry& registry = _GetRegistry();
+            glm::ScopedLock<glm::Mutex> registryLock(registry.lock);
+            fprintf(traceFile, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+            fprintf(traceFile, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"GolaemUSD\"}}");
+            for (const std::shared_ptr<ChromeTraceThreadBuffer>& threadBuffer : registry.threadBuffers)
+            {
+                glm::ScopedLock<glm::Mutex> bufferLock(threadBuffer->lock);
+                for (const ChromeTraceEvent& event : threadBuffer->events)
+                {
+                    // timestamps are in microseconds
+                    double ts = (event.startNs - registry.startNs) * 1e-3;
+                    if (event.endNs != 0)
+                    {
+                        fprintf(traceFile, ",\n{\"name\":\"%s\",\"cat\":\"GolaemUSD\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", event.name, threadBuffer->threadId, ts, (event.endNs - event.startNs) * 1e-3);
+                    }
+                    else
+                    {
+                        fprintf(traceFile, ",\n{\"name\":\"%s\",\"cat\":\"GolaemUSD\",\"ph\":\"i\",\"s\":\"p\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"frame\":%g}}", event.name, threadBuffer->threadId, ts, event.frame);
+                    }
+                }
+            }
+            fprintf(traceFile, "\n]}\n");
+            fclose(traceFile);
+        }
+    } // namespace usdplugin
+} // namespace glm
+
+#endif
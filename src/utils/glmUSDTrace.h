@@ -0,0 +1,93 @@
+/***************************************************************************
+*                                                                          *
+*  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+*                                                                          *
+***************************************************************************/
+
+#pragma once
+
+// Profiling zones, lock and allocation tracking for the USD plugin.
+// With TRACY_ENABLE the macros map to Tracy. Otherwise zones and frame marks can be recorded to a
+// Chrome trace file (chrome://tracing, Perfetto) by setting GLMUSD_CHROME_TRACE=<file.json>.
+
+#include <glmCore.h>
+#include <glmMutex.h>
+
+#define GLMUSD_TRACE_CONCAT_IMPL(a, b) a##b
+#define GLMUSD_TRACE_CONCAT(a, b) GLMUSD_TRACE_CONCAT_IMPL(a, b)
+
+#ifdef TRACY_ENABLE
+
+#include <glmTracy.h>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        typedef tracy::Lockable<glm::Mutex> TraceMutex;
+    } // namespace usdplugin
+} // namespace glm
+
+// name must be a string literal
+#define GLMUSD_ZONE(name) ZoneScopedNC(name, GLM_COLOR_CACHE)
+#define GLMUSD_FRAME_MARK(frame) FrameMark
+#define GLMUSD_ALLOC(ptr, size, name) TracyAllocN(ptr, size, name)
+#define GLMUSD_FREE(ptr, name) TracyFreeN(ptr, name)
+// constructor arguments of a TraceMutex: TraceMutex lock{GLMUSD_MUTEX_DESC("name")}; or new TraceMutex(GLMUSD_MUTEX_DESC("name"))
+#define GLMUSD_MUTEX_DESC(name) [] () -> const tracy::SourceLocationData* { static constexpr tracy::SourceLocationData srcloc{nullptr, name, __FILE__, __LINE__, 0}; return &srcloc; }()
+
+#else
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        typedef glm::Mutex TraceMutex;
+
+        class ChromeTrace
+        {
+        public:
+            /// True if GLMUSD_CHROME_TRACE is set
+            static bool isEnabled();
+
+            /// Monotonic clock in nanoseconds
+            static uint64_t now();
+
+            // name must have a static storage duration
+            static void addZone(const char* name, uint64_t startNs, uint64_t endNs);
+            static void addFrameMark(double frame);
+
+            /// Writes all the events recorded so far to the GLMUSD_CHROME_TRACE file
+            static void flush();
+        };
+
+        class ChromeTraceZone
+        {
+        public:
+            ChromeTraceZone(const char* name)
+                : _name(name)
+                , _start(ChromeTrace::isEnabled() ? ChromeTrace::now() : 0)
+            {
+            }
+            ~ChromeTraceZone()
+            {
+                if (_start != 0)
+                {
+                    ChromeTrace::addZone(_name, _start, ChromeTrace::now());
+                }
+            }
+
+        private:
+            const char* _name;
+            uint64_t _start;
+        };
+    } // namespace usdplugin
+} // namespace glm
+
+#define GLMUSD_ZONE(name) glm::usdplugin::ChromeTraceZone GLMUSD_TRACE_CONCAT(__glmUsdZone, __LINE__)(name)
+#define GLMUSD_FRAME_MARK(frame) glm::usdplugin::ChromeTrace::addFrameMark(frame)
+#define GLMUSD_ALLOC(ptr, size, name)
+#define GLMUSD_FREE(ptr, name)
+#define GLMUSD_MUTEX_DESC(name)
+
+#endif